@@ -0,0 +1,126 @@
+#ifndef ISOMON_ATOMIC_MONEY_HPP
+#define ISOMON_ATOMIC_MONEY_HPP
+
+/** @file atomic_money.hpp
+    @brief Lock-free money shared between threads, needs C++11
+
+    atomic_money::fetch_add gives exactly the result of money::operator +=,
+    including saturation to infinity and XXX on currency mismatch, without
+    locking. Every add is a compare-and-swap loop around money +=.
+
+    There is no fast path using a hardware fetch_add of the bits. It would
+    only be correct while no other thread stores a balance of another
+    currency or adds one, and excluding those would take more than the
+    one compare-and-swap it saves. Checking for small adds to skip the
+    checks of money += was measured to make no difference in time-atomic,
+    so it is not done either.
+*/
+
+#include "money.hpp"
+
+#include <atomic>
+
+namespace isomon {
+
+/// Atomic money with the same arithmetic as money
+/** Any add is one compare-and-swap from the balance it was computed from,
+    retried if another thread changed the balance meanwhile, so other
+    threads only ever see balances which are the result of whole
+    operations.
+*/
+class atomic_money
+{
+public:
+  atomic_money() : _data(money()._data) {}
+  atomic_money(money m) : _data(m._data) {}
+
+  bool is_lock_free() const { return _data.is_lock_free(); }
+
+  money load(std::memory_order order = std::memory_order_seq_cst) const {
+    return from_bits(_data.load(order));
+  }
+
+  void store(money m, std::memory_order order = std::memory_order_seq_cst) {
+    _data.store(m._data, order);
+  }
+
+  money exchange(money m,
+                 std::memory_order order = std::memory_order_seq_cst) {
+    return from_bits(_data.exchange(m._data, order));
+  }
+
+  bool compare_exchange_strong(
+      money & expected, money desired,
+      std::memory_order order = std::memory_order_seq_cst);
+
+  /// Add rhs like money::operator +=, returns the previous value
+  money fetch_add(money rhs,
+                  std::memory_order order = std::memory_order_seq_cst) {
+    money updated;
+    return add(rhs, order, updated);
+  }
+
+  /// Subtract rhs like money::operator -=, returns the previous value
+  money fetch_sub(money rhs,
+                  std::memory_order order = std::memory_order_seq_cst) {
+    return fetch_add(-rhs, order);
+  }
+
+  /// Returns the new value, like std::atomic
+  money operator += (money rhs) {
+    money updated;
+    add(rhs, std::memory_order_seq_cst, updated);
+    return updated;
+  }
+
+  money operator -= (money rhs) { return *this += -rhs; }
+
+  operator money () const { return load(); }
+
+private:
+  atomic_money(atomic_money const&);
+  void operator = (atomic_money const&);
+
+  money add(money rhs, std::memory_order order, money & updated);
+
+  static money from_bits(int64_t bits) {
+    money ret;
+    ret._data = bits;
+    return ret;
+  }
+
+  std::atomic<int64_t> _data;
+};
+
+/////////////////////////////////////////////////////////////////////
+
+inline bool atomic_money::compare_exchange_strong(
+    money & expected, money desired, std::memory_order order)
+{
+  int64_t bits = _data.load(std::memory_order_relaxed);
+  while (from_bits(bits) == expected) {
+    if (_data.compare_exchange_weak(bits, desired._data, order,
+                                    std::memory_order_relaxed)) {
+      return true;
+    }
+  }
+  expected = from_bits(bits);
+  return false;
+}
+
+inline money atomic_money::add(money rhs, std::memory_order order,
+                               money & updated)
+{
+  int64_t bits = _data.load(std::memory_order_relaxed);
+  for (;;) {
+    updated = from_bits(bits) + rhs;
+    if (_data.compare_exchange_weak(bits, updated._data, order,
+                                    std::memory_order_relaxed)) {
+      return from_bits(bits);
+    }
+  }
+}
+
+} // namespace isomon
+
+#endif
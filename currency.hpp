@@ -6,10 +6,14 @@
 */
 
 #include "currency_data.h"
+#include "instrument.hpp"
 
 #include <string>
 #include <ostream>
 #include <istream>
+#if __cplusplus >= 201103L
+#include <functional>
+#endif
 
 namespace isomon {
 
@@ -75,7 +79,10 @@ public:
 private:
   #ifndef DOXYGEN_SHOULD_SKIP_THIS
   void init(char const* code) {
-    if (!data::code2isonum(code, &num_)) { num_ = ISO_XXX; }
+    if (!data::code2isonum(code, &num_)) {
+      ISOMON_COUNT(unknown_code);
+      num_ = ISO_XXX;
+    }
   }
   #endif
 
@@ -92,13 +99,56 @@ inline std::istream & operator >> (std::istream & is, currency & rhs) {
   char code[4];
   is >> std::ws >> code[0] >> code[1] >> code[2];
   code[3] = '\0';
-  if (!is || !data::code2isonum(code, &rhs.num_)) {
+  if (!is) return is;
+  if (!data::code2isonum(code, &rhs.num_)) {
+    ISOMON_COUNT(unknown_code);
     is.setstate(std::ios_base::failbit);
   }
   return is;
 }
 
+namespace detail {
+
+// Hash of money bits, minors << 10 | ISO numeric. Rotating puts the
+// minors, which vary most, in the low bits that the multiplications spread
+// furthest, then the finalizer of SplitMix64 mixes every bit into every
+// other. Each step is invertible, so distinct money never collide in 64
+// bits, and tables indexed by the low bits, like those sized by powers of
+// 2, see amounts of a few currencies spread evenly.
+inline size_t hash_money_bits(uint64_t bits)
+{
+  uint64_t x = (bits >> 10) | (bits << 54);
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return size_t(x ^ (x >> 31));
+}
+
+} // namespace isomon::detail
+
+/// Hash for boost::hash and std::hash, from the ISO number of c alone.
+/** Equals hash_value(money(0, 0, c)) only if c has minor units; money
+    in a currency without them, like XAU, is no currency (XXX).
+*/
+inline size_t hash_value(currency c)
+{
+  return detail::hash_money_bits(uint64_t(c.isonum()));
+}
+
 } // namespace isomon
 
+#if __cplusplus >= 201103L
+namespace std {
+
+template <>
+struct hash<isomon::currency>
+{
+  size_t operator () (isomon::currency c) const noexcept {
+    return isomon::hash_value(c);
+  }
+};
+
+} // namespace std
+#endif
+
 #endif // ISOMON_CURRENCY_HPP
 
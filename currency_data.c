@@ -1,2 +1,3 @@
 #define ISOMON_INCLUDE_DEFINITIONS
 #include "currency_data.h"
+#include "money_arrow.h"
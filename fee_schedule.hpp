@@ -0,0 +1,242 @@
+#ifndef ISOMON_FEE_SCHEDULE_HPP
+#define ISOMON_FEE_SCHEDULE_HPP
+
+/** @file fee_schedule.hpp
+    @brief Tiered fees and taxes on money, with exact fixed point rates
+
+    A fee_schedule holds brackets of rates starting at thresholds, and a
+    minimum and maximum fee, separately for every currency. Fees are
+    computed exactly in integer arithmetic and rounded once to minor units
+    with a rounding policy, rather than through a chain of money_calc
+    operations in double. Needs a compiler with __int128.
+*/
+
+#include "fixed_decimal.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#ifndef __SIZEOF_INT128__
+#error "fee_schedule.hpp needs a compiler with __int128"
+#endif
+
+namespace isomon {
+
+/// Brackets of fee rates per currency, rates with _Digits decimal digits
+/** Fees are charged on the magnitude of amounts, so sales and purchases
+    pay the same, and are never negative. Amounts below the lowest
+    threshold of their currency pay no fee but the minimum.
+    Example: fee_schedule<4> tax;
+             fee_schedule<4>::rate_type ten = { 1000 }, twenty = { 2000 };
+             tax.add_bracket(money(1000, 0, "EUR"), ten);
+             tax.add_bracket(money(5000, 0, "EUR"), twenty);
+             tax.fee<rounding::half_even>(money(6000, 0, "EUR")) is EUR 600
+*/
+template <int _Digits>
+class fee_schedule
+{
+public:
+  typedef fixed_decimal<_Digits> rate_type;
+
+  enum method {
+    marginal,    ///< each bracket charges its rate on the part in it
+    whole_amount ///< the bracket of the amount charges all of it
+  };
+
+  explicit fee_schedule(method how = marginal);
+
+  /// Charge rate on amounts from threshold up, in its currency
+  /** Replaces the rate of an equal threshold.
+      @return False iff threshold is negative, infinite or of no currency,
+              or rate is negative, in which case nothing changes.
+  */
+  bool add_bracket(money threshold, rate_type rate);
+
+  /// Least fee of non-zero amounts in the currency of fee
+  /** @return False iff fee is negative or of no currency */
+  bool set_minimum(money fee);
+
+  /// Greatest fee of amounts in the currency of fee
+  /** @return False iff fee is negative or of no currency */
+  bool set_maximum(money fee);
+
+  /// Fee of amount rounded with _Rounding, XXX if its currency has no
+  /// brackets nor minimum, infinity up to the maximum if it is infinite
+  template <class _Rounding>
+  money fee(money amount) const;
+
+  /// Fees of count amounts, like fee<_Rounding> of each
+  /** @param out NON-NULL pointer to count values to write.
+  */
+  template <class _Rounding>
+  void fees(money const* amounts, size_t count, money * out) const;
+
+private:
+  // brackets of one currency, below[i] the unrounded fee of thresholds[i]
+  // in 10^-_Digits minor units
+  struct table
+  {
+    currency unit;
+    std::vector<int64_t> thresholds;
+    std::vector<uint64_t> rates;
+    std::vector<detail::uint128_t> below;
+    int64_t minimum;
+    int64_t maximum;
+  };
+
+  table * find_or_add(currency unit);
+  table const* find(currency unit) const;
+  void compile(table & t);
+
+  template <class _Rounding>
+  int64_t table_fee(table const& t, int64_t minors) const;
+
+  method _method;
+  std::vector<table> _tables;
+  detail::currency_slots _slots; // of _tables
+};
+
+/////////////////////////////////////////////////////////////////////
+
+template <int _Digits>
+fee_schedule<_Digits>::fee_schedule(method how)
+  : _method(how)
+{
+  static_assert(_Digits >= 0 && _Digits <= 19, "rate digits not in [0, 19]");
+}
+
+template <int _Digits>
+typename fee_schedule<_Digits>::table *
+fee_schedule<_Digits>::find_or_add(currency unit)
+{
+  int16_t & i = _slots[unit.isonum()];
+  if (i < 0) {
+    table t;
+    t.unit = unit;
+    t.minimum = 0;
+    t.maximum = detail::POS_INF_MINORS;
+    i = int16_t(_tables.size());
+    _tables.push_back(t);
+  }
+  return &_tables[i];
+}
+
+template <int _Digits>
+typename fee_schedule<_Digits>::table const*
+fee_schedule<_Digits>::find(currency unit) const
+{
+  int16_t i = _slots.find(unit.isonum());
+  return (i < 0 ? 0 : &_tables[i]);
+}
+
+template <int _Digits>
+bool fee_schedule<_Digits>::add_bracket(money threshold, rate_type rate)
+{
+  int64_t minors = threshold.total_minors();
+  if (threshold.unit().num_minors() < 1 || minors < 0
+      || minors == detail::POS_INF_MINORS || rate.mantissa < 0) {
+    return false;
+  }
+  table & t = *find_or_add(threshold.unit());
+  std::vector<int64_t>::iterator it;
+  it = std::lower_bound(t.thresholds.begin(), t.thresholds.end(), minors);
+  size_t i = it - t.thresholds.begin();
+  if (it == t.thresholds.end() || *it != minors) {
+    t.thresholds.insert(it, minors);
+    t.rates.insert(t.rates.begin() + i, uint64_t(rate.mantissa));
+  } else {
+    t.rates[i] = uint64_t(rate.mantissa);
+  }
+  compile(t);
+  return true;
+}
+
+template <int _Digits>
+bool fee_schedule<_Digits>::set_minimum(money fee)
+{
+  if (fee.unit().num_minors() < 1 || fee.total_minors() < 0) return false;
+  find_or_add(fee.unit())->minimum = fee.total_minors();
+  return true;
+}
+
+template <int _Digits>
+bool fee_schedule<_Digits>::set_maximum(money fee)
+{
+  if (fee.unit().num_minors() < 1 || fee.total_minors() < 0) return false;
+  find_or_add(fee.unit())->maximum = fee.total_minors();
+  return true;
+}
+
+// full brackets below a threshold are less than 2^53 minors wide in all
+// and rates are below 2^63, so their fees add up to less than 2^116
+template <int _Digits>
+void fee_schedule<_Digits>::compile(table & t)
+{
+  t.below.assign(t.thresholds.size(), 0);
+  if (_method != marginal) return;
+  for (size_t i = 1; i < t.thresholds.size(); ++i) {
+    uint64_t width = uint64_t(t.thresholds[i] - t.thresholds[i - 1]);
+    t.below[i] = t.below[i - 1] + detail::uint128_t(width) * t.rates[i - 1];
+  }
+}
+
+// The bracket is found by counting thresholds not above the amount, without
+// branches, which for the few brackets of a schedule beats a binary search.
+template <int _Digits>
+template <class _Rounding>
+int64_t fee_schedule<_Digits>::table_fee(table const& t, int64_t minors) const
+{
+  if (minors == 0) return 0;
+  uint64_t mag = (minors < 0 ? -uint64_t(minors) : uint64_t(minors));
+  int64_t fee;
+  if (minors == detail::POS_INF_MINORS || minors == detail::NEG_INF_MINORS) {
+    fee = detail::POS_INF_MINORS;
+  } else {
+    size_t k = 0;
+    size_t n = t.thresholds.size();
+    int64_t const* thresholds = n ? &t.thresholds[0] : 0;
+    for (size_t i = 0; i < n; ++i) k += (uint64_t(thresholds[i]) <= mag);
+    detail::uint128_t raw = 0;
+    if (k > 0 && _method == marginal) {
+      uint64_t over = mag - uint64_t(t.thresholds[k - 1]);
+      raw = t.below[k - 1] + detail::uint128_t(over) * t.rates[k - 1];
+    } else if (k > 0) {
+      raw = detail::uint128_t(mag) * t.rates[k - 1];
+    }
+    fee = detail::scale_magnitude<_Rounding>(raw, false, _Digits);
+  }
+  return std::min(t.maximum, std::max(t.minimum, fee));
+}
+
+template <int _Digits>
+template <class _Rounding>
+money fee_schedule<_Digits>::fee(money amount) const
+{
+  table const* t = find(amount.unit());
+  if (!t) return money();
+  return money(0, table_fee<_Rounding>(*t, amount.total_minors()), t->unit);
+}
+
+template <int _Digits>
+template <class _Rounding>
+void fee_schedule<_Digits>::fees(money const* amounts, size_t count,
+                                 money * out) const
+{
+  // amounts mostly come in runs of one currency, looked up once per run
+  // from their bits, and fees are made from bits
+  table const* t = 0;
+  int64_t isonum = ISO_XXX;
+  for (size_t i = 0; i < count; ++i) {
+    int64_t bits = detail::money_bits(amounts[i]);
+    if ((bits & detail::CURRENCY_BITS) != isonum) {
+      isonum = bits & detail::CURRENCY_BITS;
+      t = find(currency(int16_t(isonum)));
+    }
+    int64_t fee = (t ? table_fee<_Rounding>(*t, bits >> 10) : 0);
+    out[i] = detail::money_from_bits(t ? (fee << 10) | isonum : ISO_XXX);
+  }
+}
+
+} // namespace isomon
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef ISOMON_FIXED_DECIMAL_HPP
+#define ISOMON_FIXED_DECIMAL_HPP
+
+/** @file fixed_decimal.hpp
+    @brief Fixed point decimal number type that converts exactly to money
+
+    Amounts stored as scaled integers, like SQL DECIMAL(18, 4), can be
+    wrapped in fixed_decimal and passed to floor, ceil, trunc, round, rounde
+    and convert without a detour through double. Conversion only uses
+    integer arithmetic and saturates to infinity like other construction.
+*/
+
+#include "money.hpp"
+
+namespace isomon {
+
+/// Number mantissa * 10^-_Digits
+/** An aggregate, so initialize like fixed_decimal<4> x = { 12345 };
+    for 1.2345
+*/
+template <int _Digits>
+struct fixed_decimal
+{
+  static const int digits = _Digits;
+
+  int64_t mantissa;
+
+  bool operator == (fixed_decimal rhs) const {
+    return mantissa == rhs.mantissa;
+  }
+  bool operator != (fixed_decimal rhs) const {
+    return mantissa != rhs.mantissa;
+  }
+  bool operator < (fixed_decimal rhs) const {
+    return mantissa < rhs.mantissa;
+  }
+};
+
+/// Exact conversion of fixed_decimal major units with rounding policy
+/** Chosen over the generic convert by every rounding function of money.hpp.
+    Example: given fixed_decimal<3> x = { 123455 },
+    convert<rounding::half_even>(x, "USD") is USD 123.46
+*/
+template <class _Rounding, int _Digits>
+money convert(fixed_decimal<_Digits> value, currency unit);
+
+// numbers of minor units rounded with integer arithmetic, like
+// convert_decimal, exact for every mantissa
+
+template <int _Digits>
+struct number_traits<fixed_decimal<_Digits> >
+{
+  typedef fixed_decimal<_Digits> number;
+
+  static bool isnan(number) { return false; }
+  static bool isinf(number) { return false; }
+
+  static int64_t trunc(number x) { return round<rounding::trunc>(x); }
+  static int64_t floor(number x) { return round<rounding::floor>(x); }
+  static int64_t ceil(number x) { return round<rounding::ceil>(x); }
+
+  static int64_t roundhalfout(number x) {
+    return round<rounding::half_away>(x);
+  }
+
+  static int64_t roundhalfeven(number x) {
+    return round<rounding::half_even>(x);
+  }
+
+  static int64_t roundhalfup(number x) {
+    return round<rounding::half_up>(x);
+  }
+
+  static int64_t roundhalfdown(number x) {
+    return round<rounding::half_down>(x);
+  }
+
+  static int64_t roundhalfin(number x) {
+    return round<rounding::half_toward_zero>(x);
+  }
+
+private:
+  template <class _Rounding>
+  static int64_t round(number x) {
+    return detail::scale_decimal<_Rounding>(x.mantissa, -_Digits);
+  }
+};
+
+/////////////////////////////////////////////////////////////////////
+
+template <int _Digits>
+const int fixed_decimal<_Digits>::digits;
+
+template <class _Rounding, int _Digits>
+money convert(fixed_decimal<_Digits> value, currency unit)
+{
+  return convert_decimal<_Rounding>(value.mantissa, -_Digits, unit);
+}
+
+} // namespace isomon
+
+#endif
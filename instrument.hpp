@@ -0,0 +1,162 @@
+#ifndef ISOMON_INSTRUMENT_HPP
+#define ISOMON_INSTRUMENT_HPP
+
+/** @file instrument.hpp
+    @brief Opt-in counters of silent saturation and currency mismatch events
+
+    Define ISOMON_INSTRUMENT (needs C++11) in every translation unit of a
+    program to count how often its money values silently become infinity,
+    XXX or NaN. Without the macro, ISOMON_COUNT expands to nothing and
+    instrument::snapshot() returns zeros.
+*/
+
+#include <tr1/cstdint>
+
+#ifdef ISOMON_INSTRUMENT
+#include <atomic>
+#include <mutex>
+#include <vector>
+#endif
+
+namespace isomon {
+namespace instrument {
+
+/// Events counted when ISOMON_INSTRUMENT is defined
+enum event {
+  saturation,         ///< money += or *= overflowed to +/- infinity
+  currency_mismatch,  ///< money += of different currencies gave XXX
+  calc_nan,           ///< money_calc += of different currencies gave NaN
+  cast_nan,           ///< NaN converted to money gave XXX
+  cast_inf,           ///< infinity converted to money
+  unknown_code,       ///< currency alphabetic code not found
+  num_events
+};
+
+/// Name of event, like "currency_mismatch"
+inline char const* name(event e)
+{
+  static char const* const names[num_events] = {
+    "saturation", "currency_mismatch", "calc_nan", "cast_nan", "cast_inf",
+    "unknown_code"
+  };
+  return names[e];
+}
+
+/// Event counts summed across all threads, including ones that exited
+struct counts
+{
+  uint64_t n[num_events];
+
+  uint64_t operator [] (event e) const { return n[e]; }
+};
+
+#ifdef ISOMON_INSTRUMENT
+
+const bool enabled = true;
+
+namespace detail {
+
+// Each thread increments its own block without locking or atomic
+// read-modify-write; snapshots read all registered blocks under the lock.
+struct thread_block
+{
+  std::atomic<uint64_t> n[num_events];
+
+  thread_block();
+  ~thread_block();
+};
+
+struct registry
+{
+  std::mutex lock;
+  std::vector<thread_block *> blocks;
+  uint64_t retired[num_events]; // from threads that exited
+
+  registry() { for (int e = 0; e < num_events; ++e) retired[e] = 0; }
+};
+
+inline registry & global_registry()
+{
+  static registry * r = new registry; // never destroyed, threads may outlive
+  return *r;
+}
+
+inline thread_block::thread_block()
+{
+  for (int e = 0; e < num_events; ++e) n[e].store(0);
+  registry & r = global_registry();
+  std::lock_guard<std::mutex> guard(r.lock);
+  r.blocks.push_back(this);
+}
+
+inline thread_block::~thread_block()
+{
+  registry & r = global_registry();
+  std::lock_guard<std::mutex> guard(r.lock);
+  for (int e = 0; e < num_events; ++e) r.retired[e] += n[e].load();
+  for (size_t i = 0; i < r.blocks.size(); ++i) {
+    if (r.blocks[i] == this) {
+      r.blocks[i] = r.blocks.back();
+      r.blocks.pop_back();
+      break;
+    }
+  }
+}
+
+inline thread_block & local_block()
+{
+  thread_local thread_block block;
+  return block;
+}
+
+} // namespace isomon::instrument::detail
+
+/// Count one event in the calling thread.
+/** Kept out of line so the rare event branches do not bloat inlined code.
+*/
+#if defined(__GNUC__)
+__attribute__((noinline, cold))
+#endif
+inline void count(event e)
+{
+  std::atomic<uint64_t> & c = detail::local_block().n[e];
+  c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+/// Totals of all threads so far
+inline counts snapshot()
+{
+  detail::registry & r = detail::global_registry();
+  std::lock_guard<std::mutex> guard(r.lock);
+  counts ret;
+  for (int e = 0; e < num_events; ++e) {
+    ret.n[e] = r.retired[e];
+    for (size_t i = 0; i < r.blocks.size(); ++i) {
+      ret.n[e] += r.blocks[i]->n[e].load(std::memory_order_relaxed);
+    }
+  }
+  return ret;
+}
+
+#define ISOMON_COUNT(e) \
+  ::isomon::instrument::count(::isomon::instrument::e)
+
+#else // not ISOMON_INSTRUMENT
+
+const bool enabled = false;
+
+inline counts snapshot()
+{
+  counts ret;
+  for (int e = 0; e < num_events; ++e) ret.n[e] = 0;
+  return ret;
+}
+
+#define ISOMON_COUNT(e) ((void)0)
+
+#endif
+
+} // namespace isomon::instrument
+} // namespace isomon
+
+#endif
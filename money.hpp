@@ -11,6 +11,14 @@
 
 namespace isomon {
 
+class money;
+
+namespace detail {
+
+int64_t money_bits(money m);
+money money_from_bits(int64_t bits);
+
+} // namespace isomon::detail
 
 class money
 {
@@ -37,6 +45,10 @@ public:
   bool operator != (money rhs) const { return _data != rhs._data; }
 
   friend money nextafter(money m);
+  friend size_t hash_value(money m);
+  friend int64_t detail::money_bits(money m);
+  friend money detail::money_from_bits(int64_t bits);
+  friend class atomic_money;
 
 private:
   #ifndef DOXYGEN_SHOULD_SKIP_THIS
@@ -55,10 +67,33 @@ private:
   int64_t _data;
 };
 
+namespace detail {
+
+// The representation of money, (total_minors() << 10) | unit().isonum(),
+// for code working on it as an int64_t. A zero of an ISO numeric code is
+// just the code, even for a currency not added to the data tables yet.
+
+inline int64_t money_bits(money m) { return m._data; }
+
+inline money money_from_bits(int64_t bits)
+{
+  money ret;
+  ret._data = bits;
+  return ret;
+}
+
+} // namespace isomon::detail
+
 inline bool isfinite(money m) { return std::isfinite(m.value()); }
 
 inline money operator * (int32_t i, money m) { return m * i; }
 
+/// Hash for boost::hash and std::hash, well spread in the low bits
+inline size_t hash_value(money m)
+{
+  return detail::hash_money_bits(uint64_t(m._data));
+}
+
 // Construction from floating point numbers
 
 template <class _Number>
@@ -93,19 +128,60 @@ inline std::ostream & operator << (std::ostream & os, money m)
   return os;
 }
 
+// Rounding of double to nearest integer with ties broken various ways.
+// These truncate and then step by comparing the exact fraction, without
+// calls into libm. Truncating NaN, infinity or |x| >= 2^63 to int64_t is
+// undefined, so those take the std::llround path as llrounde used to.
+
+namespace detail {
+
+inline bool truncates_to_int64(double x)
+{
+  return std::fabs(x) < 9223372036854775808.0; // 2^63, false for NaN
+}
+
+} // namespace detail
+
 // round half (towards) even, "banker's rounding"
 
-inline long int llrounde(double x)
+inline int64_t llrounde(double x)
 {
-  int64_t halfout = std::llround(x);
-  if (halfout % 2) { // if odd, might need to adjust
-    // x is exactly halfway between two integers
-    // and was rounded OUT (away from zero) to an odd number
-    // we want to round IN (toward zero) to an even number instead
-    if (halfout - x == 0.5) return halfout - 1;
-    if (halfout - x == -0.5) return halfout + 1;
-  }
-  return halfout;
+  if (!detail::truncates_to_int64(x)) return std::llround(x);
+  int64_t t = int64_t(x);
+  double frac = x - double(t); // exact
+  int64_t odd = t & 1;
+  return t + ((frac > 0.5) | ((frac == 0.5) & odd))
+           - ((frac < -0.5) | ((frac == -0.5) & odd));
+}
+
+// round half toward zero
+
+inline int64_t llroundhalfin(double x)
+{
+  if (!detail::truncates_to_int64(x)) return std::llround(x);
+  int64_t t = int64_t(x);
+  double frac = x - double(t);
+  return t + (frac > 0.5) - (frac < -0.5);
+}
+
+// round half toward negative infinity
+
+inline int64_t llroundhalfdown(double x)
+{
+  if (!detail::truncates_to_int64(x)) return std::llround(x);
+  int64_t t = int64_t(x);
+  double frac = x - double(t);
+  return t + (frac > 0.5) - (frac <= -0.5);
+}
+
+// round half toward positive infinity
+
+inline int64_t llroundhalfup(double x)
+{
+  if (!detail::truncates_to_int64(x)) return std::llround(x);
+  int64_t t = int64_t(x);
+  double frac = x - double(t);
+  return t + (frac >= 0.5) - (frac < -0.5);
 }
 
 /// Number traits
@@ -113,8 +189,10 @@ inline long int llrounde(double x)
 template <class _Number>
 struct number_traits {};
 
-// number traits are pre-defined for type double
-// define similar struct in isomon namespace for other float types
+// number traits are pre-defined for double, float, long double, int64_t
+// and __int128 where the compiler has it; define similar struct in isomon
+// namespace for other number types
+// rounding functions need only work for values within +/- 2^53
 
 template<>
 struct number_traits<double>
@@ -123,17 +201,239 @@ struct number_traits<double>
 
   static bool isinf(double x) { return std::isinf(x); }
 
-  static int64_t floor(double x) { return std::floor(x); }
+  // conversion to int64_t truncates without a call into libm
 
-  static int64_t ceil(double x) { return std::ceil(x); }
+  static int64_t trunc(double x) { return int64_t(x); }
 
-  static int64_t trunc(double x) { return std::tr1::trunc(x); }
+  static int64_t floor(double x) {
+    int64_t t = int64_t(x);
+    return t - (x < double(t));
+  }
 
-  static int64_t roundhalfout(double x) { return std::llround(x); }
+  static int64_t ceil(double x) {
+    int64_t t = int64_t(x);
+    return t + (x > double(t));
+  }
+
+  static int64_t roundhalfout(double x) {
+    int64_t t = int64_t(x);
+    double frac = x - double(t); // exact
+    return t + (frac >= 0.5) - (frac <= -0.5);
+  }
 
   static int64_t roundhalfeven(double x) { return llrounde(x); }
+
+  static int64_t roundhalfup(double x) { return llroundhalfup(x); }
+
+  static int64_t roundhalfdown(double x) { return llroundhalfdown(x); }
+
+  static int64_t roundhalfin(double x) { return llroundhalfin(x); }
+};
+
+namespace detail {
+
+// the same branch-free rounding as for double, for other floating types
+template <class _Float>
+struct floating_number_traits
+{
+  static bool isnan(_Float x) { return std::isnan(x); }
+
+  static bool isinf(_Float x) { return std::isinf(x); }
+
+  static int64_t trunc(_Float x) { return int64_t(x); }
+
+  static int64_t floor(_Float x) {
+    int64_t t = int64_t(x);
+    return t - (x < _Float(t));
+  }
+
+  static int64_t ceil(_Float x) {
+    int64_t t = int64_t(x);
+    return t + (x > _Float(t));
+  }
+
+  static int64_t roundhalfout(_Float x) {
+    int64_t t = int64_t(x);
+    _Float frac = x - _Float(t); // exact
+    return t + (frac >= _Float(0.5)) - (frac <= _Float(-0.5));
+  }
+
+  static int64_t roundhalfeven(_Float x) {
+    int64_t t = int64_t(x);
+    _Float frac = x - _Float(t);
+    int64_t odd = t & 1;
+    return t + ((frac > _Float(0.5)) | ((frac == _Float(0.5)) & odd))
+             - ((frac < _Float(-0.5)) | ((frac == _Float(-0.5)) & odd));
+  }
+
+  static int64_t roundhalfup(_Float x) {
+    int64_t t = int64_t(x);
+    _Float frac = x - _Float(t);
+    return t + (frac >= _Float(0.5)) - (frac < _Float(-0.5));
+  }
+
+  static int64_t roundhalfdown(_Float x) {
+    int64_t t = int64_t(x);
+    _Float frac = x - _Float(t);
+    return t + (frac > _Float(0.5)) - (frac <= _Float(-0.5));
+  }
+
+  static int64_t roundhalfin(_Float x) {
+    int64_t t = int64_t(x);
+    _Float frac = x - _Float(t);
+    return t + (frac > _Float(0.5)) - (frac < _Float(-0.5));
+  }
+};
+
+// integers are already whole, every rounding only narrows to int64_t
+template <class _Int>
+struct integer_number_traits
+{
+  static bool isnan(_Int) { return false; }
+  static bool isinf(_Int) { return false; }
+  static int64_t trunc(_Int x) { return int64_t(x); }
+  static int64_t floor(_Int x) { return int64_t(x); }
+  static int64_t ceil(_Int x) { return int64_t(x); }
+  static int64_t roundhalfout(_Int x) { return int64_t(x); }
+  static int64_t roundhalfeven(_Int x) { return int64_t(x); }
+  static int64_t roundhalfup(_Int x) { return int64_t(x); }
+  static int64_t roundhalfdown(_Int x) { return int64_t(x); }
+  static int64_t roundhalfin(_Int x) { return int64_t(x); }
+};
+
+#ifdef __SIZEOF_INT128__
+__extension__ typedef __int128 int128_t;
+#endif
+
+} // namespace isomon::detail
+
+// float is converted with its product by the number of minor units in
+// double, where it is exact, so compact float inputs round like double
+
+template<>
+struct number_traits<float> : detail::floating_number_traits<float> {};
+
+template<>
+struct number_traits<long double>
+  : detail::floating_number_traits<long double> {};
+
+// integer numbers of major units convert exactly, saturating to infinity
+
+template<>
+struct number_traits<int64_t> : detail::integer_number_traits<int64_t> {};
+
+#ifdef __SIZEOF_INT128__
+template<>
+struct number_traits<detail::int128_t>
+  : detail::integer_number_traits<detail::int128_t> {};
+#endif
+
+/// Rounding policies for convert
+/** Each has a static function round taking a number of minor units and
+    returning it rounded to int64_t with number_traits. Being types rather
+    than function pointers, the rounding is always inlined.
+    For exact integer paths, round_quarters(q) returns q / 4 rounded, since
+    a fraction known to be 0, below, at or above one half decides every
+    policy. The >> of negative numbers is assumed to be arithmetic.
+*/
+namespace rounding {
+
+/// Round toward negative infinity
+struct floor {
+  template <class _Number>
+  static int64_t round(_Number x) { return number_traits<_Number>::floor(x); }
+
+  static int64_t round_quarters(int64_t q) { return q >> 2; }
+};
+
+/// Round toward positive infinity
+struct ceil {
+  template <class _Number>
+  static int64_t round(_Number x) { return number_traits<_Number>::ceil(x); }
+
+  static int64_t round_quarters(int64_t q) { return (q + 3) >> 2; }
+};
+
+/// Round toward zero
+struct trunc {
+  template <class _Number>
+  static int64_t round(_Number x) { return number_traits<_Number>::trunc(x); }
+
+  static int64_t round_quarters(int64_t q) {
+    return (q + (3 & (q >> 63))) >> 2;
+  }
 };
 
+/// Round to nearest, half away from zero
+struct half_away {
+  template <class _Number>
+  static int64_t round(_Number x) {
+    return number_traits<_Number>::roundhalfout(x);
+  }
+
+  static int64_t round_quarters(int64_t q) { return (q + 2 - (q < 0)) >> 2; }
+};
+
+/// Round to nearest, half to even ("banker's rounding")
+struct half_even {
+  template <class _Number>
+  static int64_t round(_Number x) {
+    return number_traits<_Number>::roundhalfeven(x);
+  }
+
+  static int64_t round_quarters(int64_t q) {
+    return (q + 1 + ((q >> 2) & 1)) >> 2;
+  }
+};
+
+/// Round to nearest, half toward positive infinity
+struct half_up {
+  template <class _Number>
+  static int64_t round(_Number x) {
+    return number_traits<_Number>::roundhalfup(x);
+  }
+
+  static int64_t round_quarters(int64_t q) { return (q + 2) >> 2; }
+};
+
+/// Round to nearest, half toward negative infinity
+struct half_down {
+  template <class _Number>
+  static int64_t round(_Number x) {
+    return number_traits<_Number>::roundhalfdown(x);
+  }
+
+  static int64_t round_quarters(int64_t q) { return (q + 1) >> 2; }
+};
+
+/// Round to nearest, half toward zero
+struct half_toward_zero {
+  template <class _Number>
+  static int64_t round(_Number x) {
+    return number_traits<_Number>::roundhalfin(x);
+  }
+
+  static int64_t round_quarters(int64_t q) { return (q + 1 + (q < 0)) >> 2; }
+};
+
+} // namespace isomon::rounding
+
+/// Construct from number of major units with rounding policy
+/** Example: convert<rounding::half_even>(1.125, "USD") is USD 1.12
+*/
+template <class _Rounding, class _Number>
+money convert(_Number value, currency unit);
+
+/// Construct from mantissa * 10^exponent major units with rounding policy
+/** Exact, using only integer arithmetic, for currencies whose number of
+    minor units is 10^num_digits() (all ISO currencies).
+    Saturates to infinity like other construction.
+    Example: convert_decimal<rounding::half_even>(123455, -3, "USD")
+    is USD 123.46
+*/
+template <class _Rounding>
+money convert_decimal(int64_t mantissa, int exponent, currency unit);
+
 /////////////////////////////////////////////////////////////////////
 
 namespace detail {
@@ -142,16 +442,86 @@ const int64_t CURRENCY_BITS = 0x3ffLL; // low 10 bits
 const int64_t POS_INF_MINORS = (1LL << 53) - 1; // 2^53 - 1
 const int64_t NEG_INF_MINORS = -(POS_INF_MINORS + 1); // - 2^53
 
+// Numbers of the slots of per-currency state, by ISO numeric code, for
+// classes which only keep state for the currencies they are given
+class currency_slots
+{
+public:
+  currency_slots() { clear(); }
+
+  /// slot of isonum, -1 if none
+  int16_t find(int64_t isonum) const { return _slots[isonum & CURRENCY_BITS]; }
+
+  /// slot of isonum to set, -1 if none yet
+  int16_t & operator [] (int64_t isonum) {
+    return _slots[isonum & CURRENCY_BITS];
+  }
+
+  void clear() {
+    for (size_t i = 0; i <= size_t(CURRENCY_BITS); ++i) _slots[i] = -1;
+  }
+
+private:
+  int16_t _slots[CURRENCY_BITS + 1];
+};
+
+// value * num_minors as a number of minor units. Float widens to double,
+// where the product is exact, and integers saturate instead of overflowing
+// so that money_cast saturates them to infinity.
 template <class _Number>
-money money_cast(_Number minors, currency unit, int64_t (*rounder)(_Number) )
+inline _Number scale_to_minors(_Number value, int32_t num_minors)
+{
+  return value * num_minors;
+}
+
+inline double scale_to_minors(float value, int32_t num_minors)
+{
+  return double(value) * num_minors;
+}
+
+template <class _Int>
+inline _Int saturating_scale(_Int value, _Int max, int32_t num_minors)
+{
+  if (num_minors < 1) return 0; // no minor units, no money either
+  _Int limit = max / num_minors;
+  if (value > limit) return max;
+  if (value < -limit) return -max;
+  return value * num_minors;
+}
+
+inline int64_t scale_to_minors(int64_t value, int32_t num_minors)
+{
+  return saturating_scale(value, std::numeric_limits<int64_t>::max(),
+                          num_minors);
+}
+
+#ifdef __SIZEOF_INT128__
+inline int128_t scale_to_minors(int128_t value, int32_t num_minors)
+{
+  __extension__ typedef unsigned __int128 uint128_t;
+  int128_t max = int128_t(~uint128_t(0) >> 1);
+  return saturating_scale(value, max, num_minors);
+}
+#endif
+
+template <class _Rounding, class _Number>
+money money_cast(_Number minors, currency unit)
 {
   typedef number_traits<_Number> nt;
-  if (nt::isnan(minors) || unit.num_minors() < 1) return money();
+  if (nt::isnan(minors)) {
+    ISOMON_COUNT(cast_nan);
+    return money();
+  }
+  if (unit.num_minors() < 1) return money();
   if (nt::isinf(minors)) {
+    ISOMON_COUNT(cast_inf);
     if (minors > 0) return money::pos_infinity(unit);
     else return money::neg_infinity(unit);
   }
-  return money(0, rounder(minors), unit); 
+  // saturate before rounding, beyond 2^63 conversion to int64_t is undefined
+  if (minors > _Number(POS_INF_MINORS)) return money::pos_infinity(unit);
+  if (minors < _Number(NEG_INF_MINORS)) return money::neg_infinity(unit);
+  return money(0, _Rounding::round(minors), unit);
 }
 
 inline
@@ -165,6 +535,129 @@ std::pair<int64_t, uint32_t> safe_multiply(int64_t a, int32_t b)
   return std::pair<int64_t, uint32_t>(hi, lo & 0xFFFFFFFFLL);
 }
 
+// 10^i for i in [0, 19], all that fit in uint64_t
+inline uint64_t pow10_u64(int i)
+{
+  static const uint64_t table[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+    10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+    100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+  };
+  return table[i];
+}
+
+// floor(n / 10^k) for k in [1, 19], as (n / 2^k) / 5^k with the second
+// division done by multiplying with a magic number (Granlund & Montgomery),
+// exact for all dividends below 2^63, which n / 2^k always is
+inline uint64_t divide_pow10(uint64_t n, int k)
+{
+#ifdef __SIZEOF_INT128__
+  __extension__ typedef unsigned __int128 uint128_t;
+  static const uint64_t magic[20] = {
+    0x8000000000000000ULL, 0xcccccccccccccccdULL, 0xa3d70a3d70a3d70bULL,
+    0x83126e978d4fdf3cULL, 0xd1b71758e219652cULL, 0xa7c5ac471b478424ULL,
+    0x8637bd05af6c69b6ULL, 0xd6bf94d5e57a42bdULL, 0xabcc77118461cefdULL,
+    0x89705f4136b4a598ULL, 0xdbe6fecebdedd5bfULL, 0xafebff0bcb24aaffULL,
+    0x8cbccc096f5088ccULL, 0xe12e13424bb40e14ULL, 0xb424dc35095cd810ULL,
+    0x901d7cf73ab0acdaULL, 0xe69594bec44de15cULL, 0xb877aa3236a4b44aULL,
+    0x9392ee8e921d5d08ULL, 0xec1e4a7db69561a6ULL
+  };
+  static const unsigned char shift[20] = {
+    0, 3, 5, 7, 10, 12, 14, 17, 19, 21, 24, 26, 28, 31, 33, 35, 38, 40, 42, 45
+  };
+  return uint64_t((uint128_t(n >> k) * magic[k]) >> (63 + shift[k]));
+#else
+  return n / pow10_u64(k);
+#endif
+}
+
+// POS_INF_MINORS / 10^i for i in [0, 15], largest mantissas not saturating
+inline int64_t scale_limit(int i)
+{
+  static const int64_t table[16] = {
+    POS_INF_MINORS, POS_INF_MINORS / 10, POS_INF_MINORS / 100,
+    POS_INF_MINORS / 1000, POS_INF_MINORS / 10000, POS_INF_MINORS / 100000,
+    POS_INF_MINORS / 1000000, POS_INF_MINORS / 10000000,
+    POS_INF_MINORS / 100000000, POS_INF_MINORS / 1000000000,
+    POS_INF_MINORS / 10000000000LL, POS_INF_MINORS / 100000000000LL,
+    POS_INF_MINORS / 1000000000000LL, POS_INF_MINORS / 10000000000000LL,
+    POS_INF_MINORS / 100000000000000LL, POS_INF_MINORS / 1000000000000000LL
+  };
+  return table[i];
+}
+
+// mantissa * 10^shift rounded to integer, clamped to [NEG_INF_MINORS,
+// POS_INF_MINORS]. Division leaves an integer quotient and the fraction is
+// classified as 0, below, at or above one half, as whole quarters for the
+// rounding policy. Signs are applied without branches since they are often
+// unpredictable.
+template <class _Rounding>
+inline int64_t scale_decimal(int64_t mantissa, int64_t shift)
+{
+  if (shift >= 0) {
+    if (mantissa == 0) return 0;
+    if (shift > 15) return mantissa > 0 ? POS_INF_MINORS : NEG_INF_MINORS;
+    int64_t limit = scale_limit(int(shift));
+    if (mantissa > limit) return POS_INF_MINORS;
+    if (mantissa < -limit) return NEG_INF_MINORS;
+    return mantissa * int64_t(pow10_u64(int(shift)));
+  }
+  uint64_t neg = mantissa < 0;
+  uint64_t mag = (uint64_t(mantissa) ^ -neg) + neg;
+  uint64_t quot = 0;
+  int quarters = 0; // fraction: 0, 1 below half, 2 at half, 3 above half
+  if (shift < -19) {
+    quarters = (mag != 0); // |mantissa| < 2^63 is below half of 10^20
+  } else {
+    uint64_t divisor = pow10_u64(int(-shift));
+    quot = divide_pow10(mag, int(-shift));
+    uint64_t rem = mag - quot * divisor;
+    uint64_t other = divisor - rem;
+    quarters = (rem != 0) + (rem >= other) + (rem > other);
+  }
+  uint64_t total = quot * 4 + quarters; // quot < 2^63 / 10, no overflow
+  int64_t minors = _Rounding::round_quarters(int64_t((total ^ -neg) + neg));
+  return std::max(NEG_INF_MINORS, std::min(POS_INF_MINORS, minors));
+}
+
+#ifdef __SIZEOF_INT128__
+
+__extension__ typedef unsigned __int128 uint128_t;
+
+// +/- mag * 10^-digits rounded, for digits in [0, 19], clamped to
+// [NEG_INF_MINORS, POS_INF_MINORS]. Like scale_decimal but for magnitudes
+// of products of int64_t, which mostly still fit in 64 bits.
+template <class _Rounding>
+inline int64_t scale_magnitude(uint128_t mag, bool negative, int digits)
+{
+  uint64_t neg = negative;
+  uint64_t divisor = pow10_u64(digits);
+  uint128_t quot;
+  uint64_t rem;
+  if (digits == 0) {
+    quot = mag;
+    rem = 0;
+  } else if (mag >> 64 == 0) {
+    quot = divide_pow10(uint64_t(mag), digits);
+    rem = uint64_t(mag) - uint64_t(quot) * divisor;
+  } else {
+    quot = mag / divisor;
+    rem = uint64_t(mag - quot * divisor);
+  }
+  if (quot > uint128_t(POS_INF_MINORS)) {
+    return negative ? NEG_INF_MINORS : POS_INF_MINORS;
+  }
+  uint64_t other = divisor - rem;
+  int quarters = (rem != 0) + (rem >= other) + (rem > other);
+  uint64_t total = uint64_t(quot) * 4 + quarters;
+  int64_t minors = _Rounding::round_quarters(int64_t((total ^ -neg) + neg));
+  return std::max(NEG_INF_MINORS, std::min(POS_INF_MINORS, minors));
+}
+
+#endif
+
 } // namespace isomon::detail
 
 inline void money::init(int64_t minors, currency unit) {
@@ -207,7 +700,8 @@ inline double money::value() const {
   } else if (minors == detail::POS_INF_MINORS) {
     return std::numeric_limits<double>::infinity();
   }
-  return double(minors)/unit().num_minors();
+  isonum_t num = 0x3FF & _data; // always valid, unlike currency(int16_t)
+  return double(minors) / data::num_minors(num);
 }
 
 inline currency money::unit() const {
@@ -221,9 +715,13 @@ inline int64_t money::total_minors() const {
 inline money & money::operator += (money rhs) {
   int64_t diff_bits = (_data ^ rhs._data);
   if (detail::CURRENCY_BITS & diff_bits) {
+    ISOMON_COUNT(currency_mismatch);
     _data = ISO_XXX;
   } else {
-    _data += ~detail::CURRENCY_BITS & rhs._data;
+    // wraps around on overflow, which is detected below; signed overflow
+    // would be undefined and optimized on that assumption
+    uint64_t minors_bits = uint64_t(~detail::CURRENCY_BITS & rhs._data);
+    _data = int64_t(uint64_t(_data) + minors_bits);
     int64_t neg_if_sign_changed = (_data ^ rhs._data);
     int64_t neg_if_overflow = neg_if_sign_changed & ~diff_bits;
     if (neg_if_overflow < 0) fix_overflow();
@@ -239,12 +737,15 @@ inline money & money::operator *= (int32_t rhs) {
   std::pair<int64_t, uint32_t> p = detail::safe_multiply(total_minors(), rhs);
   int64_t minors;
   if (p.first < -(1LL << 31)) {
-    minors = detail::NEG_INF_MINORS;
+    minors = std::numeric_limits<int64_t>::min();
   } else if (p.first >= (1LL << 31)) {
-    minors = detail::POS_INF_MINORS;
+    minors = std::numeric_limits<int64_t>::max();
   } else {
     minors = (p.first << 32) + p.second;
   }
+  if (minors < detail::NEG_INF_MINORS || minors > detail::POS_INF_MINORS) {
+    ISOMON_COUNT(saturation);
+  }
   minors = std::max( detail::NEG_INF_MINORS,
                      std::min(detail::POS_INF_MINORS, minors) );
   _data = (minors << 10) | (0x3FF & _data);
@@ -272,6 +773,7 @@ inline money money::operator * (int rhs) const {
 
 inline void money::fix_overflow()
 {
+  ISOMON_COUNT(saturation);
   int64_t minors = (_data < 0 ? detail::POS_INF_MINORS
                            : detail::NEG_INF_MINORS);
   _data &= detail::CURRENCY_BITS; // clear the minors bits
@@ -290,45 +792,67 @@ inline money nextafter(money m)
   return ret;
 }
 
+template <class _Rounding, class _Number>
+money convert(_Number value, currency unit)
+{
+  return detail::money_cast<_Rounding>(
+      detail::scale_to_minors(value, unit.num_minors()), unit);
+}
+
+template <class _Rounding>
+money convert_decimal(int64_t mantissa, int exponent, currency unit)
+{
+  if (unit.num_minors() < 1) return money();
+  int64_t shift = int64_t(exponent) + unit.num_digits();
+  return money(0, detail::scale_decimal<_Rounding>(mantissa, shift), unit);
+}
+
 template <class _Number>
 money floor(_Number value, currency unit)
 {
-  _Number minors = value * unit.num_minors();
-  return detail::money_cast(minors, unit, number_traits<_Number>::floor);
+  return convert<rounding::floor>(value, unit);
 }
 
 template <class _Number>
 money ceil(_Number value, currency unit)
 {
-  _Number minors = value * unit.num_minors();
-  return detail::money_cast(minors, unit, number_traits<_Number>::ceil);
+  return convert<rounding::ceil>(value, unit);
 }
 
 template <class _Number>
 money trunc(_Number value, currency unit)
 {
-  _Number minors = value * unit.num_minors();
-  return detail::money_cast(minors, unit, number_traits<_Number>::trunc);
+  return convert<rounding::trunc>(value, unit);
 }
 
 template <class _Number>
 money round(_Number value, currency unit)
 {
-  typedef number_traits<_Number> nt;
-  _Number minors = value * unit.num_minors();
-  return detail::money_cast(minors, unit, nt::roundhalfout);
+  return convert<rounding::half_away>(value, unit);
 }
 
 template <class _Number>
 money rounde(_Number value, currency unit)
 {
-  typedef number_traits<_Number> nt;
-  _Number minors = value * unit.num_minors();
-  return detail::money_cast(minors, unit, nt::roundhalfeven);
+  return convert<rounding::half_even>(value, unit);
 }
 
 
 } // namespace isomon
 
+#if __cplusplus >= 201103L
+namespace std {
+
+template <>
+struct hash<isomon::money>
+{
+  size_t operator () (isomon::money m) const noexcept {
+    return isomon::hash_value(m);
+  }
+};
+
+} // namespace std
+#endif
+
 #endif
 
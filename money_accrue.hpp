@@ -0,0 +1,286 @@
+#ifndef ISOMON_MONEY_ACCRUE_HPP
+#define ISOMON_MONEY_ACCRUE_HPP
+
+/** @file money_accrue.hpp
+    @brief Compound interest on arrays of balances, needs C++11
+
+    Daily accrual of interest is a loop of m += convert<_Rounding>(m * rate)
+    for every account and day. accrue gives the same money, bit for bit,
+    while keeping a block of accounts in cache as doubles for all the days,
+    which is vectorized with AVX2 where money_batch.hpp is, and splitting
+    the accounts between threads. Rates given as fixed_decimal are applied
+    with integer arithmetic only, exact for every balance and rate.
+*/
+
+#include "money_batch.hpp"
+#include "money_calc.hpp"
+#include "fixed_decimal.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace isomon {
+
+/// Compound interest on count balances for days, each day doing
+///   balances[i] += convert<_Rounding>(balances[i] * rate)
+/** @param num_threads Threads to split the balances between, 0 for one per
+                       hardware thread.
+    Example: accrue<rounding::trunc>(accounts, n, 0.0005 / 365, 30)
+*/
+template <class _Rounding>
+void accrue(money * balances, size_t count, double rate, int days,
+            unsigned num_threads = 1);
+
+/// Same as above but balances[i] accrues at rates[i]
+template <class _Rounding>
+void accrue(money * balances, size_t count, double const* rates, int days,
+            unsigned num_threads = 1);
+
+#ifdef __SIZEOF_INT128__
+
+/// Compound interest at an exact rate, each day adding
+///   balance * rate rounded to a minor unit with _Rounding
+/** The product is rounded with integer arithmetic, like convert_decimal,
+    so results do not depend on double. Saturates like money +=.
+    Example: fixed_decimal<9> rate = { 1369863 }; // 0.001369863
+             accrue<rounding::half_even>(accounts, n, rate, 365)
+*/
+template <class _Rounding, int _Digits>
+void accrue(money * balances, size_t count, fixed_decimal<_Digits> rate,
+            int days, unsigned num_threads = 1);
+
+/// Same as above but balances[i] accrues at rates[i]
+template <class _Rounding, int _Digits>
+void accrue(money * balances, size_t count,
+            fixed_decimal<_Digits> const* rates, int days,
+            unsigned num_threads = 1);
+
+#endif
+
+/////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+// Minors of balances are exact as doubles, as are sums of two of them
+// within [NEG_INF_MINORS, POS_INF_MINORS], and a sum beyond those bounds
+// rounds to a double still beyond them. So a day of interest on minors m
+// can be done entirely in double, clamping like money_cast and money +=.
+template <class _Rounding>
+inline double accrue_day(double m, double rate)
+{
+  double const lo = double(NEG_INF_MINORS);
+  double const hi = double(POS_INF_MINORS);
+  double interest = std::max(lo, std::min(hi, m * rate));
+  return std::max(lo, std::min(hi, m + double(_Rounding::round(interest))));
+}
+
+// days of interest on n minors, rates[j * step] for minors[j]
+template <class _Rounding>
+inline void accrue_minors(double * minors, double const* rates, size_t step,
+                          size_t n, int days)
+{
+  for (int d = 0; d < days; ++d) {
+    for (size_t j = 0; j < n; ++j) {
+      minors[j] = accrue_day<_Rounding>(minors[j], rates[j * step]);
+    }
+  }
+}
+
+#ifdef ISOMON_BATCH_AVX2
+
+template <class _Rounding>
+__attribute__((target("avx2")))
+void accrue_minors_avx2(double * minors, double const* rates, size_t step,
+                        size_t n, int days)
+{
+  __m256d const lo = _mm256_set1_pd(double(NEG_INF_MINORS));
+  __m256d const hi = _mm256_set1_pd(double(POS_INF_MINORS));
+  size_t const vn = n & ~size_t(3);
+  for (int d = 0; d < days; ++d) {
+    for (size_t j = 0; j < vn; j += 4) {
+      __m256d m = _mm256_loadu_pd(minors + j);
+      __m256d r = (step ? _mm256_loadu_pd(rates + j)
+                        : _mm256_broadcast_sd(rates));
+      __m256d interest = _mm256_max_pd(lo, _mm256_min_pd(hi,
+                                                         _mm256_mul_pd(m, r)));
+      interest = round_pd(interest, _Rounding());
+      m = _mm256_max_pd(lo, _mm256_min_pd(hi, _mm256_add_pd(m, interest)));
+      _mm256_storeu_pd(minors + j, m);
+    }
+  }
+  accrue_minors<_Rounding>(minors + vn, rates + vn * step, step, n - vn, days);
+}
+
+#endif
+
+// balances accrued one at a time with money operations, for rates which are
+// not finite and so can make NaN and no currency
+template <class _Rounding>
+void accrue_money(money * balances, double const* rates, size_t step,
+                  size_t n, int days)
+{
+  for (size_t j = 0; j < n; ++j) {
+    for (int d = 0; d < days; ++d) {
+      balances[j] += convert<_Rounding>(balances[j] * rates[j * step]);
+    }
+  }
+}
+
+// Each block is unpacked to double minors, accrued for all days while in
+// L1 cache, and packed back with its currency bits. Balances with no
+// currency have 0 minors, which a finite rate leaves at 0.
+template <class _Rounding>
+void accrue_range(money * balances, size_t n, double const* rates,
+                  size_t step, int days)
+{
+  size_t const BLOCK = 512;
+  double minors[BLOCK];
+  for (size_t i = 0; i < n; i += BLOCK) {
+    size_t k = std::min(BLOCK, n - i);
+    double const* r = rates + i * step;
+    bool finite = true;
+    for (size_t j = 0; j < (step ? k : 1); ++j) {
+      finite = finite && std::isfinite(r[j]);
+    }
+    if (!finite) {
+      accrue_money<_Rounding>(balances + i, r, step, k, days);
+      continue;
+    }
+    for (size_t j = 0; j < k; ++j) {
+      minors[j] = double(money_bits(balances[i + j]) >> 10);
+    }
+    #ifdef ISOMON_BATCH_AVX2
+    if (has_avx2()) {
+      accrue_minors_avx2<_Rounding>(minors, r, step, k, days);
+    } else
+    #endif
+    {
+      accrue_minors<_Rounding>(minors, r, step, k, days);
+    }
+    for (size_t j = 0; j < k; ++j) {
+      int64_t isonum = money_bits(balances[i + j]) & CURRENCY_BITS;
+      balances[i + j] = money_from_bits((int64_t(minors[j]) << 10) | isonum);
+    }
+  }
+}
+
+// calls range(begin, end) on num_threads parts of [0, count), the last in
+// the calling thread, with at least a few thousand items per thread
+template <class _Range>
+void split_between_threads(size_t count, unsigned num_threads, _Range range)
+{
+  size_t const MIN_PER_THREAD = 4096;
+  if (num_threads == 0) num_threads = std::thread::hardware_concurrency();
+  size_t parts = std::max(size_t(1), std::min(size_t(num_threads),
+                                              count / MIN_PER_THREAD));
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t + 1 < parts; ++t) {
+    threads.push_back(std::thread(range, count * t / parts,
+                                  count * (t + 1) / parts));
+  }
+  range(count * (parts - 1) / parts, count);
+  for (size_t t = 0; t < threads.size(); ++t) threads[t].join();
+}
+
+#ifdef __SIZEOF_INT128__
+
+// minors * mantissa * 10^-digits rounded like scale_magnitude
+template <class _Rounding>
+inline int64_t scale_product(int64_t minors, int64_t mantissa, int digits)
+{
+  bool neg = (minors < 0) != (mantissa < 0);
+  uint128_t mag = uint128_t(minors < 0 ? -uint64_t(minors) : minors)
+                  * (mantissa < 0 ? -uint64_t(mantissa) : mantissa);
+  return scale_magnitude<_Rounding>(mag, neg, digits);
+}
+
+// Like accrue_range, a block of accounts goes through all the days
+// together, so that the chains of dependent multiplications of separate
+// accounts overlap.
+template <class _Rounding, int _Digits>
+void accrue_fixed_range(money * balances, size_t n,
+                        fixed_decimal<_Digits> const* rates, size_t step,
+                        int days)
+{
+  size_t const BLOCK = 256;
+  int64_t minors[BLOCK];
+  for (size_t i = 0; i < n; i += BLOCK) {
+    size_t k = std::min(BLOCK, n - i);
+    fixed_decimal<_Digits> const* r = rates + i * step;
+    for (size_t j = 0; j < k; ++j) {
+      minors[j] = money_bits(balances[i + j]) >> 10;
+    }
+    for (int d = 0; d < days; ++d) {
+      for (size_t j = 0; j < k; ++j) {
+        int64_t m = minors[j];
+        m += scale_product<_Rounding>(m, r[j * step].mantissa, _Digits);
+        minors[j] = std::max(NEG_INF_MINORS, std::min(POS_INF_MINORS, m));
+      }
+    }
+    for (size_t j = 0; j < k; ++j) {
+      int64_t isonum = money_bits(balances[i + j]) & CURRENCY_BITS;
+      balances[i + j] = money_from_bits((minors[j] << 10) | isonum);
+    }
+  }
+}
+
+#endif
+
+} // namespace isomon::detail
+
+template <class _Rounding>
+void accrue(money * balances, size_t count, double rate, int days,
+            unsigned num_threads)
+{
+  detail::split_between_threads(count, num_threads,
+                                [=](size_t begin, size_t end) {
+    detail::accrue_range<_Rounding>(balances + begin, end - begin, &rate, 0,
+                                    days);
+  });
+}
+
+template <class _Rounding>
+void accrue(money * balances, size_t count, double const* rates, int days,
+            unsigned num_threads)
+{
+  detail::split_between_threads(count, num_threads,
+                                [=](size_t begin, size_t end) {
+    detail::accrue_range<_Rounding>(balances + begin, end - begin,
+                                    rates + begin, 1, days);
+  });
+}
+
+#ifdef __SIZEOF_INT128__
+
+template <class _Rounding, int _Digits>
+void accrue(money * balances, size_t count, fixed_decimal<_Digits> rate,
+            int days, unsigned num_threads)
+{
+  static_assert(_Digits >= 0 && _Digits <= 19, "rate digits not in [0, 19]");
+  detail::split_between_threads(count, num_threads,
+                                [=](size_t begin, size_t end) {
+    detail::accrue_fixed_range<_Rounding>(balances + begin, end - begin,
+                                          &rate, 0, days);
+  });
+}
+
+template <class _Rounding, int _Digits>
+void accrue(money * balances, size_t count,
+            fixed_decimal<_Digits> const* rates, int days,
+            unsigned num_threads)
+{
+  static_assert(_Digits >= 0 && _Digits <= 19, "rate digits not in [0, 19]");
+  detail::split_between_threads(count, num_threads,
+                                [=](size_t begin, size_t end) {
+    detail::accrue_fixed_range<_Rounding>(balances + begin, end - begin,
+                                          rates + begin, 1, days);
+  });
+}
+
+#endif
+
+} // namespace isomon
+
+#endif
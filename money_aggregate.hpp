@@ -0,0 +1,312 @@
+#ifndef ISOMON_MONEY_AGGREGATE_HPP
+#define ISOMON_MONEY_AGGREGATE_HPP
+
+/** @file money_aggregate.hpp
+    @brief Count, sum, minimum, maximum and mean per currency of a stream
+
+    A money_aggregator takes amounts pushed one at a time or in arrays and
+    keeps statistics of each currency in a table indexed by ISO numeric
+    code, so its memory is bounded by the number of currencies however long
+    the stream. Sums are kept as money, saturating like money +=, and
+    exactly in 128 bits for the mean. Aggregators of the partitions of a
+    stream merge into the aggregate of the whole. Needs a compiler with
+    __int128.
+
+    A money_aggregator is used by one thread at a time. With C++11, a
+    shared_money_aggregator is pushed to by one thread while any thread
+    takes snapshots.
+*/
+
+#include "money.hpp"
+
+#include <algorithm>
+#include <vector>
+#if __cplusplus >= 201103L
+#include <mutex>
+#endif
+
+#ifndef __SIZEOF_INT128__
+#error "money_aggregate.hpp needs a compiler with __int128"
+#endif
+
+namespace isomon {
+
+/// Statistics of the amounts of one currency
+/** Infinite amounts count in exact_sum as the minor units they are stored
+    with, 2^53 - 1 and -2^53, so the mean of amounts all infinite is
+    infinite.
+*/
+struct money_stats
+{
+  currency unit;
+  uint64_t count;
+  money sum; ///< as added up with money +=, saturating to infinity
+  money min; ///< XXX if count is 0
+  money max; ///< XXX if count is 0
+  detail::int128_t exact_sum; ///< of minor units, never saturating
+
+  /// exact_sum / count rounded to minor units, XXX if count is 0
+  template <class _Rounding>
+  money mean() const;
+};
+
+/// Statistics per currency of the amounts pushed
+/** Not safe to use from more than one thread at a time, including
+    snapshot while another thread pushes; see shared_money_aggregator.
+    Example: money_aggregator agg;
+             agg.push(money(1, 0, "EUR"));
+             agg.push(money(2, 0, "EUR"));
+             agg.stats("EUR").mean<rounding::half_even>() is EUR 1.50
+*/
+class money_aggregator
+{
+public:
+  money_aggregator();
+
+  /// Add m to the statistics of its currency, XXX amounts are only counted
+  void push(money m);
+
+  /// Same as push of each of count amounts
+  void push(money const* amounts, size_t count);
+
+  /// Add the statistics of other, as if its amounts were pushed here too
+  /** Except for sum, which becomes the saturating sum with money += of
+      the sums of the partitions. Once a partition saturates this can
+      differ from the sum of the amounts in stream order, but exact_sum
+      and the mean never do.
+  */
+  void merge(money_aggregator const& other);
+
+  /// Statistics of unit, with count 0 if no amount of it was pushed
+  money_stats stats(currency unit) const;
+
+  /// Statistics of every currency pushed, in order of ISO numeric code
+  /** A copy, which stays as it is while pushing goes on later */
+  std::vector<money_stats> snapshot() const;
+
+  /// Number of amounts pushed with no currency
+  uint64_t no_currency_count() const { return _no_currency; }
+
+  /// Forget all amounts pushed
+  void clear();
+
+private:
+  // statistics of one currency as updated by push, 48 bytes
+  struct cell
+  {
+    detail::int128_t exact_sum;
+    uint64_t count;
+    money sum;
+    int64_t min;
+    int64_t max;
+  };
+
+  cell & add_cell(int64_t isonum);
+  money_stats make_stats(cell const& c, currency unit) const;
+
+  std::vector<cell> _cells;
+  std::vector<isonum_t> _isonums; // of _cells
+  detail::currency_slots _slots;  // of _cells
+  uint64_t _no_currency;
+};
+
+/////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+// num / den rounded, for quotients within [NEG_INF_MINORS, POS_INF_MINORS]
+template <class _Rounding>
+inline int64_t divide_rounded(int128_t num, uint64_t den)
+{
+  uint64_t neg = (num < 0);
+  uint128_t mag = (neg ? -uint128_t(num) : uint128_t(num));
+  uint128_t quot = mag / den;
+  uint64_t rem = uint64_t(mag - quot * den);
+  uint64_t other = den - rem;
+  int quarters = (rem != 0) + (rem >= other) + (rem > other);
+  uint64_t total = uint64_t(quot) * 4 + quarters;
+  return _Rounding::round_quarters(int64_t((total ^ -neg) + neg));
+}
+
+} // namespace isomon::detail
+
+template <class _Rounding>
+money money_stats::mean() const
+{
+  if (count == 0) return money();
+  return money(0, detail::divide_rounded<_Rounding>(exact_sum, count), unit);
+}
+
+inline money_aggregator::money_aggregator()
+  : _no_currency(0)
+{
+}
+
+inline money_aggregator::cell & money_aggregator::add_cell(int64_t isonum)
+{
+  cell c;
+  c.exact_sum = 0;
+  c.count = 0;
+  c.sum = money(0, 0, currency(isonum_t(isonum)));
+  c.min = detail::POS_INF_MINORS;
+  c.max = detail::NEG_INF_MINORS;
+  _slots[isonum] = int16_t(_cells.size());
+  _cells.push_back(c);
+  _isonums.push_back(isonum_t(isonum));
+  return _cells.back();
+}
+
+inline void money_aggregator::push(money m)
+{
+  int64_t isonum = m.unit().isonum();
+  if (isonum == ISO_XXX) {
+    ++_no_currency;
+    return;
+  }
+  int16_t i = _slots.find(isonum);
+  cell & c = (i < 0 ? add_cell(isonum) : _cells[i]);
+  int64_t minors = m.total_minors();
+  c.exact_sum += minors;
+  ++c.count;
+  c.sum += m;
+  c.min = std::min(c.min, minors);
+  c.max = std::max(c.max, minors);
+}
+
+inline void money_aggregator::push(money const* amounts, size_t count)
+{
+  for (size_t i = 0; i < count; ++i) push(amounts[i]);
+}
+
+inline void money_aggregator::merge(money_aggregator const& other)
+{
+  for (size_t j = 0; j < other._cells.size(); ++j) {
+    cell const& o = other._cells[j];
+    int64_t isonum = other._isonums[j];
+    int16_t i = _slots.find(isonum);
+    cell & c = (i < 0 ? add_cell(isonum) : _cells[i]);
+    c.exact_sum += o.exact_sum;
+    c.count += o.count;
+    c.sum += o.sum;
+    c.min = std::min(c.min, o.min);
+    c.max = std::max(c.max, o.max);
+  }
+  _no_currency += other._no_currency;
+}
+
+inline money_stats money_aggregator::make_stats(cell const& c,
+                                                currency unit) const
+{
+  money_stats s;
+  s.unit = unit;
+  s.count = c.count;
+  s.sum = c.sum;
+  s.min = (c.count ? money(0, c.min, unit) : money());
+  s.max = (c.count ? money(0, c.max, unit) : money());
+  s.exact_sum = c.exact_sum;
+  return s;
+}
+
+inline money_stats money_aggregator::stats(currency unit) const
+{
+  int16_t i = _slots.find(unit.isonum());
+  if (i >= 0) return make_stats(_cells[i], unit);
+  money_stats s;
+  s.unit = unit;
+  s.count = 0;
+  s.sum = money(0, 0, unit);
+  s.exact_sum = 0;
+  return s;
+}
+
+inline std::vector<money_stats> money_aggregator::snapshot() const
+{
+  std::vector<money_stats> ret;
+  ret.reserve(_cells.size());
+  for (size_t i = 0; i <= size_t(detail::CURRENCY_BITS); ++i) {
+    int16_t c = _slots.find(i);
+    if (c >= 0) ret.push_back(make_stats(_cells[c], currency(isonum_t(i))));
+  }
+  return ret;
+}
+
+inline void money_aggregator::clear()
+{
+  _cells.clear();
+  _isonums.clear();
+  _slots.clear();
+  _no_currency = 0;
+}
+
+#if __cplusplus >= 201103L
+
+/// money_aggregator pushed to by one thread and snapshot by any
+/** Arrays are pushed into a private money_aggregator, which is then merged
+    into the one snapshots read, under a lock. If a snapshot holds the lock
+    at that time, the merge waits for a later push or publish, so pushing
+    never waits for snapshots. A snapshot sees whole arrays only.
+    Example: shared_money_aggregator agg;
+             on the ingesting thread agg.push(batch, n);
+             on any other thread agg.snapshot()
+*/
+class shared_money_aggregator
+{
+public:
+  /// Same as money_aggregator::push, by one thread at a time
+  void push(money const* amounts, size_t count);
+
+  /// Make all amounts pushed seen by snapshots, waiting for the lock
+  /** By the pushing thread. */
+  void publish();
+
+  /// Same as money_aggregator::snapshot, by any thread
+  std::vector<money_stats> snapshot() const;
+
+  /// Same as money_aggregator::stats, by any thread
+  money_stats stats(currency unit) const;
+
+private:
+  void merge_pending(); // with _lock held
+
+  money_aggregator _pending;   // only used by the pushing thread
+  money_aggregator _published; // guarded by _lock
+  mutable std::mutex _lock;
+};
+
+inline void shared_money_aggregator::merge_pending()
+{
+  _published.merge(_pending);
+  _pending.clear();
+}
+
+inline void shared_money_aggregator::push(money const* amounts,
+                                          size_t count)
+{
+  _pending.push(amounts, count);
+  std::unique_lock<std::mutex> guard(_lock, std::try_to_lock);
+  if (guard.owns_lock()) merge_pending();
+}
+
+inline void shared_money_aggregator::publish()
+{
+  std::lock_guard<std::mutex> guard(_lock);
+  merge_pending();
+}
+
+inline std::vector<money_stats> shared_money_aggregator::snapshot() const
+{
+  std::lock_guard<std::mutex> guard(_lock);
+  return _published.snapshot();
+}
+
+inline money_stats shared_money_aggregator::stats(currency unit) const
+{
+  std::lock_guard<std::mutex> guard(_lock);
+  return _published.stats(unit);
+}
+
+#endif
+
+} // namespace isomon
+
+#endif
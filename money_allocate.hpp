@@ -0,0 +1,180 @@
+#ifndef ISOMON_MONEY_ALLOCATE_HPP
+#define ISOMON_MONEY_ALLOCATE_HPP
+
+/** @file money_allocate.hpp
+    @brief Exact pro-rata split of money by integer weights
+
+    Rounding each share of a split separately, as with money_calc and round,
+    can leave the shares a minor unit or more off the total. allocate uses
+    the largest remainder method in exact integer arithmetic instead, so the
+    shares always add up to the total. Needs a compiler with __int128.
+*/
+
+#include "money.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#ifndef __SIZEOF_INT128__
+#error "money_allocate.hpp needs a compiler with __int128"
+#endif
+
+namespace isomon {
+
+/// Split total into count shares proportional to weights, exactly
+/** Each share is total * weight / sum of weights rounded down in
+    magnitude, then the minor units left over go one each to the shares
+    with the largest remainders, the first ones on ties. The shares of a
+    negative total are the negated shares of its magnitude. Shares of
+    infinity are infinity for non-zero weights, shares of XXX are XXX.
+    @param out NON-NULL pointer to count values to write.
+    @return False iff a weight is negative, or weights sum to 0 or more
+            than INT64_MAX, in which case out is not written.
+*/
+inline bool allocate(money total, int64_t const* weights, size_t count,
+                     money * out);
+
+/// Same as above, returns no shares iff weights are not valid
+inline std::vector<money> allocate(money total,
+                                   std::vector<int64_t> const& weights);
+
+/// Split each of num_totals totals by the same weights
+/** Shares of totals[i] are written to out[i * count] to
+    out[i * count + count - 1]. Faster than allocating one total at a time.
+    @param out NON-NULL pointer to num_totals * count values to write.
+*/
+inline bool batch_allocate(money const* totals, size_t num_totals,
+                           int64_t const* weights, size_t count,
+                           money * out);
+
+/////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+// Splits by fixed weights. Quotients are estimated with double and then
+// corrected with their exact remainder in 128 bit arithmetic, which is much
+// faster than a 128 bit division.
+class allocator
+{
+public:
+  bool init(int64_t const* weights, size_t count);
+  void split(money total, money * out);
+
+private:
+  __extension__ typedef __int128 int128_t;
+
+  int64_t const* _weights;
+  size_t _count;
+  int64_t _sum;
+  std::vector<double> _ratios;     // weight / sum, inexact
+  std::vector<int64_t> _shares;
+  std::vector<uint64_t> _remainders;
+  std::vector<size_t> _order;
+
+  struct larger_remainder
+  {
+    uint64_t const* r;
+    bool operator () (size_t a, size_t b) const {
+      return r[a] > r[b] || (r[a] == r[b] && a < b);
+    }
+  };
+};
+
+inline bool allocator::init(int64_t const* weights, size_t count)
+{
+  _weights = weights;
+  _count = count;
+  _sum = 0;
+  for (size_t i = 0; i < count; ++i) {
+    int64_t room = std::numeric_limits<int64_t>::max() - _sum;
+    if (weights[i] < 0 || weights[i] > room) return false;
+    _sum += weights[i];
+  }
+  if (_sum == 0) return false;
+  _ratios.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    _ratios[i] = double(weights[i]) / double(_sum);
+  }
+  _shares.resize(count);
+  _remainders.resize(count);
+  _order.resize(count);
+  return true;
+}
+
+inline void allocator::split(money total, money * out)
+{
+  currency unit = total.unit();
+  int64_t minors = total.total_minors();
+  if (unit.num_minors() < 1) {
+    std::fill(out, out + _count, money());
+    return;
+  }
+  if (minors == POS_INF_MINORS || minors == NEG_INF_MINORS) {
+    for (size_t i = 0; i < _count; ++i) {
+      out[i] = (_weights[i] ? total : money(0, 0, unit));
+    }
+    return;
+  }
+  int64_t sign = (minors < 0 ? -1 : 1);
+  int64_t magnitude = minors * sign; // at most 2^53
+  int64_t left = magnitude;
+  for (size_t i = 0; i < _count; ++i) {
+    // estimate is within a few units, |product| < 2^117
+    int64_t q = int64_t(double(magnitude) * _ratios[i]);
+    int128_t r = int128_t(magnitude) * _weights[i] - int128_t(q) * _sum;
+    while (r < 0) { --q; r += _sum; }
+    while (r >= _sum) { ++q; r -= _sum; }
+    _shares[i] = q;
+    _remainders[i] = uint64_t(r);
+    left -= q;
+  }
+  // the remainders add up to left * _sum, so more than left are not zero
+  if (left > 0) {
+    for (size_t i = 0; i < _count; ++i) _order[i] = i;
+    larger_remainder cmp = { &_remainders[0] };
+    std::nth_element(_order.begin(), _order.begin() + (left - 1),
+                     _order.end(), cmp);
+    for (int64_t k = 0; k < left; ++k) ++_shares[_order[k]];
+  }
+  for (size_t i = 0; i < _count; ++i) {
+    out[i] = money(0, _shares[i] * sign, unit);
+  }
+}
+
+} // namespace isomon::detail
+
+inline bool allocate(money total, int64_t const* weights, size_t count,
+                     money * out)
+{
+  detail::allocator a;
+  if (!a.init(weights, count)) return false;
+  a.split(total, out);
+  return true;
+}
+
+inline std::vector<money> allocate(money total,
+                                   std::vector<int64_t> const& weights)
+{
+  std::vector<money> ret(weights.size());
+  if (weights.empty() || !allocate(total, &weights[0], weights.size(),
+                                   &ret[0])) {
+    ret.clear();
+  }
+  return ret;
+}
+
+inline bool batch_allocate(money const* totals, size_t num_totals,
+                           int64_t const* weights, size_t count,
+                           money * out)
+{
+  detail::allocator a;
+  if (!a.init(weights, count)) return false;
+  for (size_t i = 0; i < num_totals; ++i) {
+    a.split(totals[i], out + i * count);
+  }
+  return true;
+}
+
+} // namespace isomon
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef ISOMON_MONEY_ARROW_H
+#define ISOMON_MONEY_ARROW_H
+
+/** @file money_arrow.h
+    @brief Low-level C functions for Arrow dictionary-encoded currency columns.
+*/
+
+// Same rules as currency_data.h about ISOMON_INCLUDE_DEFINITIONS apply.
+// currency_data.c includes this file to compile the C99 definitions.
+
+#include "currency_data.h"
+
+#if defined(__cplusplus)
+namespace isomon {
+namespace data {
+#endif
+
+
+/// Dictionary of currencies in the memory layout of an Arrow utf8 array.
+/** Buffers offsets and chars can be handed as-is to Arrow as the
+    dictionary of a dictionary-encoded column with int16 indices.
+    Entry i is the 3 letter ISO code at chars + offsets[i],
+    so offsets[i + 1] - offsets[i] is always 3.
+    Use arrow_dict_clear before first use.
+*/
+typedef struct arrow_currency_dict
+{
+  int32_t length;                            ///< number of entries
+  int32_t offsets[ISOMON_ISONUM_COUNT + 1];  ///< Arrow utf8 offsets buffer
+  char chars[3 * ISOMON_ISONUM_COUNT];       ///< Arrow utf8 data buffer
+  isonum_t isonums[ISOMON_ISONUM_COUNT];     ///< ISO numeric of each entry
+  int16_t index[ISOMON_ISONUM_COUNT];        ///< entry of isonum, or -1
+} arrow_currency_dict;
+
+
+#ifdef ISOMON_INCLUDE_DEFINITIONS
+extern void arrow_dict_clear(arrow_currency_dict * dict);
+extern int16_t arrow_dict_add(arrow_currency_dict * dict, isonum_t isonum);
+extern bool arrow_dict_import(arrow_currency_dict * dict,
+                              const int32_t * offsets, const char * chars,
+                              int32_t length);
+extern bool arrow_encode_currencies(arrow_currency_dict * dict,
+                                    const isonum_t * isonums, size_t count,
+                                    int16_t * indices);
+extern bool arrow_decode_currencies(const arrow_currency_dict * dict,
+                                    const int16_t * indices, size_t count,
+                                    isonum_t * isonums);
+#endif
+
+
+/// Low-level C function to empty a currency dictionary.
+/** @param dict NON-NULL pointer to dictionary.
+*/
+inline void arrow_dict_clear(arrow_currency_dict * dict)
+{
+  dict->length = 0;
+  dict->offsets[0] = 0;
+  for (size_t i = 0; i < ISOMON_ISONUM_COUNT; ++i) dict->index[i] = -1;
+}
+
+/// Low-level C function to find or append a currency in a dictionary.
+/** @param dict NON-NULL pointer to dictionary.
+    @param isonum ISO numeric code: is_isonum(isonum) is true
+    @return Index of currency in dictionary, or -1 if isonum is not valid.
+*/
+inline int16_t arrow_dict_add(arrow_currency_dict * dict, isonum_t isonum)
+{
+  if (!is_isonum(isonum)) return -1;
+  int16_t i = dict->index[isonum];
+  if (i < 0) {
+    i = (int16_t)dict->length++;
+    const char * code = isonum2code(isonum);
+    char * dest = dict->chars + 3 * i;
+    dest[0] = code[0];
+    dest[1] = code[1];
+    dest[2] = code[2];
+    dict->offsets[i + 1] = 3 * (i + 1);
+    dict->isonums[i] = isonum;
+    dict->index[isonum] = i;
+  }
+  return i;
+}
+
+/// Low-level C function to load a dictionary from Arrow utf8 buffers.
+/** Codes may appear in any order and letter case but each must be a known
+    ISO alphabetic code and appear only once.
+    Arrays with nulls in the dictionary are not supported.
+    @param dict NON-NULL pointer to dictionary to overwrite.
+    @param offsets Arrow offsets buffer of length + 1 values.
+    @param chars Arrow data buffer.
+    @param length Number of dictionary entries.
+    @return False iff any entry is not a known currency code, in which case
+            dict is left empty.
+*/
+inline bool arrow_dict_import(arrow_currency_dict * dict,
+                              const int32_t * offsets, const char * chars,
+                              int32_t length)
+{
+  arrow_dict_clear(dict);
+  if (length < 0 || length > ISOMON_ISONUM_COUNT) return false;
+  for (int32_t i = 0; i < length; ++i) {
+    char code[4] = { 0, 0, 0, 0 };
+    isonum_t isonum;
+    if (offsets[i + 1] - offsets[i] != 3) break;
+    code[0] = chars[offsets[i]];
+    code[1] = chars[offsets[i] + 1];
+    code[2] = chars[offsets[i] + 2];
+    if (!code2isonum(code, &isonum)) break;
+    if (dict->index[isonum] >= 0) break; // duplicate
+    arrow_dict_add(dict, isonum);
+  }
+  if (dict->length != length) {
+    arrow_dict_clear(dict);
+    return false;
+  }
+  return true;
+}
+
+/// Low-level C function to dictionary-encode ISO numeric codes.
+/** Currencies not yet in dict are appended to it.
+    @param dict NON-NULL pointer to dictionary.
+    @param indices NON-NULL pointer to count values to write Arrow indices.
+    @return False iff an ISO numeric code is not valid, in which case
+            remaining indices are not written.
+*/
+inline bool arrow_encode_currencies(arrow_currency_dict * dict,
+                                    const isonum_t * isonums, size_t count,
+                                    int16_t * indices)
+{
+  for (size_t i = 0; i < count; ++i) {
+    int16_t d = arrow_dict_add(dict, isonums[i]);
+    if (d < 0) return false;
+    indices[i] = d;
+  }
+  return true;
+}
+
+/// Low-level C function to decode Arrow dictionary indices.
+/** @param dict NON-NULL pointer to dictionary.
+    @param isonums NON-NULL pointer to count values to write.
+    @return False iff an index is out of range of the dictionary, in which
+            case remaining ISO numeric codes are not written.
+*/
+inline bool arrow_decode_currencies(const arrow_currency_dict * dict,
+                                    const int16_t * indices, size_t count,
+                                    isonum_t * isonums)
+{
+  for (size_t i = 0; i < count; ++i) {
+    int16_t d = indices[i];
+    if (d < 0 || d >= dict->length) return false;
+    isonums[i] = dict->isonums[d];
+  }
+  return true;
+}
+
+#ifdef __cplusplus
+} // namespace isomon::data
+} // namespace isomon
+#endif
+
+#endif // ISOMON_MONEY_ARROW_H
@@ -0,0 +1,69 @@
+#ifndef ISOMON_MONEY_ARROW_HPP
+#define ISOMON_MONEY_ARROW_HPP
+
+/** @file money_arrow.hpp
+    @brief Conversion of money arrays to and from Arrow style columns
+*/
+
+#include "money.hpp"
+#include "money_arrow.h"
+
+namespace isomon {
+
+using data::arrow_currency_dict;
+
+/// Split money into an Arrow int64 minors column and int16 currency indices.
+/** The dictionary of the currency column is dict, with new currencies
+    appended to it, so one dictionary can be shared by several batches.
+    Infinities are written as their saturated number of minors
+    (2^53 - 1 for positive and -2^53 for negative infinity) and XXX money
+    as 0 minors of XXX.
+    @param minors NON-NULL pointer to count values to write.
+    @param indices NON-NULL pointer to count values to write.
+*/
+inline void arrow_export(money const* values, size_t count,
+                         int64_t * minors, int16_t * indices,
+                         arrow_currency_dict & dict);
+
+/// Combine Arrow minors and dictionary-encoded currency columns into money.
+/** Minors of at least 2^53 - 1 saturate to positive infinity and of at
+    most -2^53 to negative infinity.
+    @param out NON-NULL pointer to count values to write.
+    @return False iff an index is not in dict, in which case out is not
+            completely written.
+*/
+inline bool arrow_import(int64_t const* minors, int16_t const* indices,
+                         size_t count, arrow_currency_dict const& dict,
+                         money * out);
+
+/////////////////////////////////////////////////////////////////////
+
+inline void arrow_export(money const* values, size_t count,
+                         int64_t * minors, int16_t * indices,
+                         arrow_currency_dict & dict)
+{
+  for (size_t i = 0; i < count; ++i) {
+    minors[i] = values[i].total_minors();
+    isonum_t num = values[i].unit().isonum();
+    int16_t d = dict.index[num];
+    indices[i] = (d >= 0 ? d : data::arrow_dict_add(&dict, num));
+  }
+}
+
+inline bool arrow_import(int64_t const* minors, int16_t const* indices,
+                         size_t count, arrow_currency_dict const& dict,
+                         money * out)
+{
+  currency units[ISOMON_ISONUM_COUNT];
+  for (int32_t d = 0; d < dict.length; ++d) units[d] = dict.isonums[d];
+  for (size_t i = 0; i < count; ++i) {
+    int16_t d = indices[i];
+    if (d < 0 || d >= dict.length) return false;
+    out[i] = money(0, minors[i], units[d]);
+  }
+  return true;
+}
+
+} // namespace isomon
+
+#endif
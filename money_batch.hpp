@@ -0,0 +1,354 @@
+#ifndef ISOMON_MONEY_BATCH_HPP
+#define ISOMON_MONEY_BATCH_HPP
+
+/** @file money_batch.hpp
+    @brief Conversion of arrays of double to money, vectorized with AVX2
+
+    Results are bit-identical to the scalar convert function of money.hpp
+    with the same rounding policy. On x86-64 with GCC or Clang the AVX2 code
+    is compiled regardless of compiler flags and chosen at run time if the
+    CPU supports it. Otherwise a plain loop over the scalar functions is used.
+    Arrays of scaled decimal integers convert exactly with integer arithmetic.
+*/
+
+#include "money.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__) \
+    && !defined(ISOMON_NO_AVX2)
+#define ISOMON_BATCH_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace isomon {
+
+/// Convert count values in major units to money, like floor(value, unit)
+inline void batch_floor(double const* values, size_t count, currency unit,
+                        money * out);
+
+/// Convert count values in major units to money, like ceil(value, unit)
+inline void batch_ceil(double const* values, size_t count, currency unit,
+                       money * out);
+
+/// Convert count values in major units to money, like trunc(value, unit)
+inline void batch_trunc(double const* values, size_t count, currency unit,
+                        money * out);
+
+/// Convert count values in major units to money, like round(value, unit)
+inline void batch_round(double const* values, size_t count, currency unit,
+                        money * out);
+
+/// Convert count values in major units to money, like rounde(value, unit)
+inline void batch_rounde(double const* values, size_t count, currency unit,
+                         money * out);
+
+/// Like batch_floor but value i is in currency units[i]
+inline void batch_floor(double const* values, currency const* units,
+                        size_t count, money * out);
+
+/// Like batch_ceil but value i is in currency units[i]
+inline void batch_ceil(double const* values, currency const* units,
+                       size_t count, money * out);
+
+/// Like batch_trunc but value i is in currency units[i]
+inline void batch_trunc(double const* values, currency const* units,
+                        size_t count, money * out);
+
+/// Like batch_round but value i is in currency units[i]
+inline void batch_round(double const* values, currency const* units,
+                        size_t count, money * out);
+
+/// Like batch_rounde but value i is in currency units[i]
+inline void batch_rounde(double const* values, currency const* units,
+                         size_t count, money * out);
+
+/// Convert count values in major units to money, like convert<_Rounding>
+/** Example: batch_convert<rounding::half_up>(values, count, unit, out)
+*/
+template <class _Rounding>
+inline void batch_convert(double const* values, size_t count, currency unit,
+                          money * out);
+
+/// Like batch_convert but value i is in currency units[i]
+template <class _Rounding>
+inline void batch_convert(double const* values, currency const* units,
+                          size_t count, money * out);
+
+/// Convert count values of mantissas[i] * 10^exponent major units to money
+/** Same results as convert_decimal<_Rounding> of each value.
+    Example: batch_convert_decimal<rounding::half_even>(cents, -2, n, "EUR",
+                                                         out)
+*/
+template <class _Rounding>
+inline void batch_convert_decimal(int64_t const* mantissas, int exponent,
+                                  size_t count, currency unit, money * out);
+
+/////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+template <class _Rounding>
+inline void batch_convert_scalar(double const* values, currency const* units,
+                                 currency unit, size_t count, money * out)
+{
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = convert<_Rounding>(values[i], units ? units[i] : unit);
+  }
+}
+
+#ifdef ISOMON_BATCH_AVX2
+
+inline bool has_avx2()
+{
+  static const bool ret = __builtin_cpu_supports("avx2");
+  return ret;
+}
+
+// vector counterparts of the rounding policies, same results lane by lane
+
+__attribute__((target("avx2")))
+inline __m256d round_pd(__m256d x, rounding::floor)
+{
+  return _mm256_round_pd(x, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+}
+
+__attribute__((target("avx2")))
+inline __m256d round_pd(__m256d x, rounding::ceil)
+{
+  return _mm256_round_pd(x, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC);
+}
+
+__attribute__((target("avx2")))
+inline __m256d round_pd(__m256d x, rounding::trunc)
+{
+  return _mm256_round_pd(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+}
+
+__attribute__((target("avx2")))
+inline __m256d round_pd(__m256d x, rounding::half_even)
+{
+  return _mm256_round_pd(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+
+// truncate, then step away from zero if the fraction is more than half,
+// or also exactly half if ties is true; x - trunc(x) is exact
+template <bool ties>
+__attribute__((target("avx2")))
+inline __m256d round_half_pd(__m256d x)
+{
+  __m256d t = round_pd(x, rounding::trunc());
+  __m256d sign = _mm256_and_pd(x, _mm256_set1_pd(-0.0));
+  __m256d frac = _mm256_andnot_pd(_mm256_set1_pd(-0.0), _mm256_sub_pd(x, t));
+  __m256d half = _mm256_cmp_pd(frac, _mm256_set1_pd(0.5),
+                               ties ? _CMP_GE_OQ : _CMP_GT_OQ);
+  __m256d step = _mm256_and_pd(half, _mm256_or_pd(sign, _mm256_set1_pd(1.0)));
+  return _mm256_add_pd(t, step);
+}
+
+__attribute__((target("avx2")))
+inline __m256d round_pd(__m256d x, rounding::half_away)
+{
+  return round_half_pd<true>(x);
+}
+
+__attribute__((target("avx2")))
+inline __m256d round_pd(__m256d x, rounding::half_toward_zero)
+{
+  return round_half_pd<false>(x);
+}
+
+__attribute__((target("avx2")))
+inline __m256d round_pd(__m256d x, rounding::half_up)
+{
+  __m256d f = round_pd(x, rounding::floor());
+  __m256d half = _mm256_cmp_pd(_mm256_sub_pd(x, f), _mm256_set1_pd(0.5),
+                               _CMP_GE_OQ);
+  return _mm256_add_pd(f, _mm256_and_pd(half, _mm256_set1_pd(1.0)));
+}
+
+__attribute__((target("avx2")))
+inline __m256d round_pd(__m256d x, rounding::half_down)
+{
+  __m256d c = round_pd(x, rounding::ceil());
+  __m256d half = _mm256_cmp_pd(_mm256_sub_pd(c, x), _mm256_set1_pd(0.5),
+                               _CMP_GE_OQ);
+  return _mm256_sub_pd(c, _mm256_and_pd(half, _mm256_set1_pd(1.0)));
+}
+
+// integer valued doubles in [-2^53, 2^53] to int64_t, exactly,
+// by splitting into 32 bit halves that each convert with the 2^52 trick
+__attribute__((target("avx2")))
+inline __m256i integral_pd_to_epi64(__m256d r)
+{
+  const __m256d magic = _mm256_set1_pd(6755399441055744.0); // 2^52 + 2^51
+  const __m256i magic_bits = _mm256_castpd_si256(magic);
+  const __m256d two32 = _mm256_set1_pd(4294967296.0);
+  const __m256d inv_two32 = _mm256_set1_pd(1.0 / 4294967296.0);
+  __m256d hi = _mm256_floor_pd(_mm256_mul_pd(r, inv_two32)); // exact
+  __m256d lo = _mm256_sub_pd(r, _mm256_mul_pd(hi, two32));
+  __m256i hi_i = _mm256_sub_epi64(
+      _mm256_castpd_si256(_mm256_add_pd(hi, magic)), magic_bits);
+  __m256i lo_i = _mm256_sub_epi64(
+      _mm256_castpd_si256(_mm256_add_pd(lo, magic)), magic_bits);
+  return _mm256_add_epi64(_mm256_slli_epi64(hi_i, 32), lo_i);
+}
+
+// money data of 4 values given minors per major and ISO numeric per lane
+template <class _Rounding>
+__attribute__((target("avx2")))
+inline __m256i convert_pd(__m256d values, __m256d scale, __m256i isonums)
+{
+  __m256d minors = _mm256_mul_pd(values, scale);
+  __m256d bad = _mm256_or_pd(_mm256_cmp_pd(minors, minors, _CMP_UNORD_Q),
+                             _mm256_cmp_pd(scale, _mm256_set1_pd(1.0),
+                                           _CMP_LT_OQ));
+  __m256d r = round_pd(minors, _Rounding());
+  r = _mm256_max_pd(r, _mm256_set1_pd(double(NEG_INF_MINORS)));
+  r = _mm256_min_pd(r, _mm256_set1_pd(double(POS_INF_MINORS)));
+  __m256i minors_i = integral_pd_to_epi64(r);
+  __m256i data = _mm256_or_si256(_mm256_slli_epi64(minors_i, 10), isonums);
+  return _mm256_blendv_epi8(data, _mm256_set1_epi64x(ISO_XXX),
+                            _mm256_castpd_si256(bad));
+}
+
+template <class _Rounding>
+__attribute__((target("avx2")))
+void batch_convert_avx2(double const* values, currency const* units,
+                        currency unit, size_t count, money * out)
+{
+  // money is a single int64_t so 4 of them are stored at once
+  __m256i * dest = reinterpret_cast<__m256i *>(out);
+  size_t i = 0;
+  if (units) {
+    for (; i + 4 <= count; i += 4, ++dest) {
+      currency const* u = units + i;
+      __m256d scale = _mm256_setr_pd(u[0].num_minors(), u[1].num_minors(),
+                                     u[2].num_minors(), u[3].num_minors());
+      __m256i isonums = _mm256_setr_epi64x(u[0].isonum(), u[1].isonum(),
+                                           u[2].isonum(), u[3].isonum());
+      __m256d v = _mm256_loadu_pd(values + i);
+      _mm256_storeu_si256(dest, convert_pd<_Rounding>(v, scale, isonums));
+    }
+  } else {
+    __m256d scale = _mm256_set1_pd(unit.num_minors());
+    __m256i isonums = _mm256_set1_epi64x(unit.isonum());
+    for (; i + 4 <= count; i += 4, ++dest) {
+      __m256d v = _mm256_loadu_pd(values + i);
+      _mm256_storeu_si256(dest, convert_pd<_Rounding>(v, scale, isonums));
+    }
+  }
+  batch_convert_scalar<_Rounding>(values + i, units ? units + i : 0, unit,
+                             count - i, out + i);
+}
+
+#endif // ISOMON_BATCH_AVX2
+
+template <class _Rounding>
+inline void batch_dispatch(double const* values, currency const* units,
+                           currency unit, size_t count, money * out)
+{
+  #ifdef ISOMON_BATCH_AVX2
+  if (has_avx2()) {
+    batch_convert_avx2<_Rounding>(values, units, unit, count, out);
+    return;
+  }
+  #endif
+  batch_convert_scalar<_Rounding>(values, units, unit, count, out);
+}
+
+} // namespace isomon::detail
+
+template <class _Rounding>
+inline void batch_convert(double const* values, size_t count, currency unit,
+                          money * out)
+{
+  detail::batch_dispatch<_Rounding>(values, 0, unit, count, out);
+}
+
+template <class _Rounding>
+inline void batch_convert(double const* values, currency const* units,
+                          size_t count, money * out)
+{
+  detail::batch_dispatch<_Rounding>(values, units, currency(), count, out);
+}
+
+template <class _Rounding>
+inline void batch_convert_decimal(int64_t const* mantissas, int exponent,
+                                  size_t count, currency unit, money * out)
+{
+  if (unit.num_minors() < 1) {
+    for (size_t i = 0; i < count; ++i) out[i] = money();
+    return;
+  }
+  // currency looked up once, money is a single int64_t written directly
+  int64_t shift = int64_t(exponent) + unit.num_digits();
+  int64_t isonum = unit.isonum();
+  int64_t * dest = reinterpret_cast<int64_t *>(out);
+  for (size_t i = 0; i < count; ++i) {
+    int64_t minors = detail::scale_decimal<_Rounding>(mantissas[i], shift);
+    dest[i] = (minors << 10) | isonum;
+  }
+}
+
+inline void batch_floor(double const* values, size_t count, currency unit,
+                        money * out)
+{
+  batch_convert<rounding::floor>(values, count, unit, out);
+}
+
+inline void batch_ceil(double const* values, size_t count, currency unit,
+                       money * out)
+{
+  batch_convert<rounding::ceil>(values, count, unit, out);
+}
+
+inline void batch_trunc(double const* values, size_t count, currency unit,
+                        money * out)
+{
+  batch_convert<rounding::trunc>(values, count, unit, out);
+}
+
+inline void batch_round(double const* values, size_t count, currency unit,
+                        money * out)
+{
+  batch_convert<rounding::half_away>(values, count, unit, out);
+}
+
+inline void batch_rounde(double const* values, size_t count, currency unit,
+                         money * out)
+{
+  batch_convert<rounding::half_even>(values, count, unit, out);
+}
+
+inline void batch_floor(double const* values, currency const* units,
+                        size_t count, money * out)
+{
+  batch_convert<rounding::floor>(values, units, count, out);
+}
+
+inline void batch_ceil(double const* values, currency const* units,
+                       size_t count, money * out)
+{
+  batch_convert<rounding::ceil>(values, units, count, out);
+}
+
+inline void batch_trunc(double const* values, currency const* units,
+                        size_t count, money * out)
+{
+  batch_convert<rounding::trunc>(values, units, count, out);
+}
+
+inline void batch_round(double const* values, currency const* units,
+                        size_t count, money * out)
+{
+  batch_convert<rounding::half_away>(values, units, count, out);
+}
+
+inline void batch_rounde(double const* values, currency const* units,
+                         size_t count, money * out)
+{
+  batch_convert<rounding::half_even>(values, units, count, out);
+}
+
+} // namespace isomon
+
+#endif
@@ -36,6 +36,7 @@ struct money_calc<double>
     if (this->unit == rhs.unit()) {
       this->minors += rhs.total_minors();
     } else {
+       ISOMON_COUNT(calc_nan);
        minors = NAN;
        unit = ISO_XXX;
     }
@@ -46,6 +47,7 @@ struct money_calc<double>
     if (this->unit == rhs.unit) {
       this->minors += rhs.minors;
     } else {
+       ISOMON_COUNT(calc_nan);
        minors = NAN;
        unit = ISO_XXX;
     }
@@ -180,31 +182,35 @@ inline money_calc<double> operator / (money m, double x) {
   return money_calc<double>(m) / x;
 }
 
+/// Convert to money with rounding policy, like convert(double, currency)
+template <class _Rounding, class _Number>
+money convert(money_calc<_Number> const& mc) {
+  return detail::money_cast<_Rounding>(mc.minors, mc.unit);
+}
+
 template <class _Number>
 money floor(money_calc<_Number> const& mc) {
-  return detail::money_cast(mc.minors, mc.unit, number_traits<_Number>::floor);
+  return convert<rounding::floor>(mc);
 }
 
 template <class _Number>
 money ceil(money_calc<_Number> const& mc) {
-  return detail::money_cast(mc.minors, mc.unit, number_traits<_Number>::ceil);
+  return convert<rounding::ceil>(mc);
 }
 
 template <class _Number>
 money trunc(money_calc<_Number> const& mc) {
-  return detail::money_cast(mc.minors, mc.unit, number_traits<_Number>::trunc);
+  return convert<rounding::trunc>(mc);
 }
 
 template <class _Number>
 money round(money_calc<_Number> const& mc) {
-  typedef number_traits<_Number> nt;
-  return detail::money_cast(mc.minors, mc.unit, nt::roundhalfout);
+  return convert<rounding::half_away>(mc);
 }
 
 template <class _Number>
 money rounde(money_calc<_Number> const& mc) {
-  typedef number_traits<_Number> nt;
-  return detail::money_cast(mc.minors, mc.unit, nt::roundhalfeven);
+  return convert<rounding::half_even>(mc);
 }
 
 
@@ -0,0 +1,361 @@
+#ifndef ISOMON_MONEY_COLUMN_HPP
+#define ISOMON_MONEY_COLUMN_HPP
+
+/** @file money_column.hpp
+    @brief Column of money stored as separate minors and currency arrays
+
+    Arrays of money are mostly of a single currency. money_column stores the
+    number of minor units of every row in a plain int64_t array and the
+    currency once for the whole column, until a row of another currency
+    makes it keep one currency per row. Bulk operations on a column of one
+    currency run on the int64_t array alone and give the same money as the
+    scalar operations of money.hpp and money_calc.hpp row by row.
+*/
+
+#include "money_calc.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+namespace isomon {
+
+/// Money in structure of arrays form
+class money_column
+{
+public:
+  class const_iterator;
+
+  /// Empty column, it takes the currency of the first row added
+  money_column() {}
+
+  money_column(money const* values, size_t count);
+
+  size_t size() const { return _minors.size(); }
+  bool empty() const { return _minors.empty(); }
+
+  /// True if all rows are of currency unit(), then units() is NULL
+  bool uniform() const { return _units.empty(); }
+
+  /// Currency of all rows if uniform(), otherwise meaningless
+  currency unit() const { return _unit; }
+
+  /// Number of minor units of each row, infinities as +/- 2^53
+  int64_t const* minors() const { return empty() ? 0 : &_minors[0]; }
+
+  /// Currency of each row, NULL if uniform()
+  currency const* units() const { return uniform() ? 0 : &_units[0]; }
+
+  money operator [] (size_t i) const {
+    return money(0, _minors[i], uniform() ? _unit : _units[i]);
+  }
+
+  const_iterator begin() const;
+  const_iterator end() const;
+
+  void push_back(money m);
+  void set(size_t i, money m);
+  void clear() { _minors.clear(); _units.clear(); }
+
+  /// Back to one currency for the column if every row has the same
+  void compact();
+
+  /// All rows added up with money +=, the same as adding in a loop
+  money sum() const;
+
+  /// Every row multiplied like money *= factor
+  void scale(int32_t factor);
+
+  /// Every row r becomes convert<_Rounding>(r * factor), see money_calc
+  template <class _Rounding>
+  void scale(double factor);
+
+  /// Every row r becomes convert<_Rounding>(r.value() * rate, to)
+  template <class _Rounding>
+  void convert(double rate, currency to);
+
+  /// Like money::value() of every row
+  /** @param out NON-NULL pointer to size() values to write.
+  */
+  void values(double * out) const;
+
+  /// Order of every row relative to rhs: -1 less, 0 equal, 1 greater,
+  /// or 2 if it is of another currency
+  /** @param out NON-NULL pointer to size() values to write.
+  */
+  void compare(money rhs, int8_t * out) const;
+
+  /// @param out NON-NULL pointer to size() values to write.
+  void copy_to(money * out) const;
+
+private:
+  void split_units();
+
+  // don't scale by double without a rounding policy
+  void scale(double);
+
+  std::vector<int64_t> _minors;
+  std::vector<currency> _units; // empty if uniform
+  currency _unit;
+};
+
+/// Random access to rows of a money_column as money values
+class money_column::const_iterator
+{
+public:
+  typedef std::random_access_iterator_tag iterator_category;
+  typedef money value_type;
+  typedef ptrdiff_t difference_type;
+  typedef money const* pointer;
+  typedef money reference;
+
+  const_iterator() : _column(0), _i(0) {}
+
+  money operator * () const { return (*_column)[_i]; }
+  money operator [] (difference_type n) const { return (*_column)[_i + n]; }
+
+  const_iterator & operator ++ () { ++_i; return *this; }
+  const_iterator & operator -- () { --_i; return *this; }
+  const_iterator operator ++ (int) { const_iterator r(*this); ++_i; return r; }
+  const_iterator operator -- (int) { const_iterator r(*this); --_i; return r; }
+  const_iterator & operator += (difference_type n) { _i += n; return *this; }
+  const_iterator & operator -= (difference_type n) { _i -= n; return *this; }
+
+  const_iterator operator + (difference_type n) const {
+    return const_iterator(_column, _i + n);
+  }
+  const_iterator operator - (difference_type n) const {
+    return const_iterator(_column, _i - n);
+  }
+  difference_type operator - (const_iterator rhs) const {
+    return difference_type(_i) - difference_type(rhs._i);
+  }
+
+  bool operator == (const_iterator rhs) const { return _i == rhs._i; }
+  bool operator != (const_iterator rhs) const { return _i != rhs._i; }
+  bool operator < (const_iterator rhs) const { return _i < rhs._i; }
+
+private:
+  friend class money_column;
+  const_iterator(money_column const* c, size_t i) : _column(c), _i(i) {}
+
+  money_column const* _column;
+  size_t _i;
+};
+
+/////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+// total plus x[0], x[1], ... each added like money +=, saturating whenever
+// a partial sum leaves [NEG_INF_MINORS, POS_INF_MINORS]. Blocks which can
+// not reach infinity, whatever the order, are summed as plain int64_t.
+inline int64_t sum_minors(int64_t total, int64_t const* x, size_t n,
+                          currency unit)
+{
+  const size_t BLOCK = 512; // sum of magnitudes below 2^62
+  for (size_t i = 0; i < n; i += BLOCK) {
+    size_t m = std::min(BLOCK, n - i);
+    int64_t sum = 0;
+    uint64_t magnitude = 0;
+    for (size_t j = 0; j < m; ++j) {
+      int64_t v = x[i + j];
+      sum += v;
+      magnitude += uint64_t(v < 0 ? -v : v);
+    }
+    uint64_t headroom = uint64_t(total < 0 ? -total : total) + magnitude;
+    if (headroom <= uint64_t(POS_INF_MINORS)) {
+      total += sum;
+    } else {
+      money t(0, total, unit);
+      for (size_t j = 0; j < m; ++j) t += money(0, x[i + j], unit);
+      total = t.total_minors();
+    }
+  }
+  return total;
+}
+
+// money_cast of a number of minors which is not NaN to a currency with
+// minor units
+template <class _Rounding>
+inline int64_t cast_minors(double minors)
+{
+  if (minors > double(POS_INF_MINORS)) {
+    if (std::isinf(minors)) ISOMON_COUNT(cast_inf);
+    return POS_INF_MINORS;
+  }
+  if (minors < double(NEG_INF_MINORS)) {
+    if (std::isinf(minors)) ISOMON_COUNT(cast_inf);
+    return NEG_INF_MINORS;
+  }
+  return _Rounding::round(minors);
+}
+
+// like money::value() of minors of a currency with minor units
+inline double minors_value(int64_t minors, int32_t num_minors)
+{
+  double const inf = std::numeric_limits<double>::infinity();
+  if (minors == POS_INF_MINORS) return inf;
+  if (minors == NEG_INF_MINORS) return -inf;
+  return double(minors) / num_minors;
+}
+
+} // namespace isomon::detail
+
+inline money_column::money_column(money const* values, size_t count)
+{
+  for (size_t i = 0; i < count; ++i) push_back(values[i]);
+}
+
+inline money_column::const_iterator money_column::begin() const
+{
+  return const_iterator(this, 0);
+}
+
+inline money_column::const_iterator money_column::end() const
+{
+  return const_iterator(this, size());
+}
+
+inline void money_column::split_units()
+{
+  if (uniform()) _units.assign(_minors.size(), _unit);
+}
+
+inline void money_column::push_back(money m)
+{
+  if (empty() && uniform()) _unit = m.unit();
+  if (uniform() && m.unit() != _unit) split_units();
+  _minors.push_back(m.total_minors());
+  if (!uniform()) _units.push_back(m.unit());
+}
+
+inline void money_column::set(size_t i, money m)
+{
+  if (uniform() && m.unit() != _unit) {
+    if (size() == 1) _unit = m.unit();
+    else split_units();
+  }
+  _minors[i] = m.total_minors();
+  if (!uniform()) _units[i] = m.unit();
+}
+
+inline void money_column::compact()
+{
+  if (uniform()) return;
+  for (size_t i = 1; i < _units.size(); ++i) {
+    if (_units[i] != _units[0]) return;
+  }
+  if (!_units.empty()) _unit = _units[0];
+  _units.clear();
+}
+
+inline money money_column::sum() const
+{
+  if (uniform()) {
+    if (_unit.num_minors() < 1) return money();
+    return money(0, detail::sum_minors(0, minors(), size(), _unit), _unit);
+  }
+  money total(0, 0, _units[0]);
+  for (size_t i = 0; i < size(); ++i) total += (*this)[i];
+  return total;
+}
+
+inline void money_column::scale(int32_t factor)
+{
+  // XXX rows have 0 minors, which stay 0, so currencies never matter
+  if (factor > -1024 && factor < 1024) { // |product| < 2^63
+    for (size_t i = 0; i < size(); ++i) {
+      int64_t p = _minors[i] * factor;
+      if (p < detail::NEG_INF_MINORS || p > detail::POS_INF_MINORS) {
+        ISOMON_COUNT(saturation);
+      }
+      _minors[i] = std::max(detail::NEG_INF_MINORS,
+                            std::min(detail::POS_INF_MINORS, p));
+    }
+  } else {
+    for (size_t i = 0; i < size(); ++i) {
+      _minors[i] = ((*this)[i] * factor).total_minors();
+    }
+  }
+}
+
+template <class _Rounding>
+void money_column::scale(double factor)
+{
+  // a finite factor can not make NaN, so the currency stays
+  if (uniform() && _unit.num_minors() > 0 && std::isfinite(factor)) {
+    for (size_t i = 0; i < size(); ++i) {
+      _minors[i] = detail::cast_minors<_Rounding>(_minors[i] * factor);
+    }
+    return;
+  }
+  split_units();
+  for (size_t i = 0; i < size(); ++i) {
+    set(i, isomon::convert<_Rounding>((*this)[i] * factor));
+  }
+  compact();
+}
+
+template <class _Rounding>
+void money_column::convert(double rate, currency to)
+{
+  // neither infinite rows nor a finite non-zero rate can make NaN
+  if (uniform() && _unit.num_minors() > 0 && to.num_minors() > 0
+      && std::isfinite(rate) && rate != 0) {
+    int32_t n = _unit.num_minors();
+    int32_t to_n = to.num_minors();
+    for (size_t i = 0; i < size(); ++i) {
+      double value = detail::minors_value(_minors[i], n);
+      _minors[i] = detail::cast_minors<_Rounding>(value * rate * to_n);
+    }
+    _unit = to;
+    return;
+  }
+  split_units();
+  for (size_t i = 0; i < size(); ++i) {
+    set(i, isomon::convert<_Rounding>((*this)[i].value() * rate, to));
+  }
+  compact();
+}
+
+inline void money_column::values(double * out) const
+{
+  if (uniform() && _unit.num_minors() > 0) {
+    int32_t n = _unit.num_minors();
+    for (size_t i = 0; i < size(); ++i) {
+      out[i] = detail::minors_value(_minors[i], n);
+    }
+    return;
+  }
+  for (size_t i = 0; i < size(); ++i) out[i] = (*this)[i].value();
+}
+
+inline void money_column::compare(money rhs, int8_t * out) const
+{
+  int64_t r = rhs.total_minors();
+  if (uniform()) {
+    if (rhs.unit() != _unit) {
+      std::fill(out, out + size(), int8_t(2));
+      return;
+    }
+    for (size_t i = 0; i < size(); ++i) {
+      out[i] = int8_t((_minors[i] > r) - (_minors[i] < r));
+    }
+    return;
+  }
+  for (size_t i = 0; i < size(); ++i) {
+    int8_t order = int8_t((_minors[i] > r) - (_minors[i] < r));
+    out[i] = (_units[i] == rhs.unit() ? order : int8_t(2));
+  }
+}
+
+inline void money_column::copy_to(money * out) const
+{
+  for (size_t i = 0; i < size(); ++i) out[i] = (*this)[i];
+}
+
+} // namespace isomon
+
+#endif
@@ -0,0 +1,299 @@
+#ifndef ISOMON_MONEY_FORMAT_HPP
+#define ISOMON_MONEY_FORMAT_HPP
+
+/** @file money_format.hpp
+    @brief Locale-aware money formatting with conventions cached once
+*/
+
+#include "money_text.hpp"
+
+#include <climits>
+#include <cstring>
+#include <locale>
+#include <string>
+
+namespace isomon {
+
+/// Table of currency symbols by ISO numeric code.
+/** Starts out with the ISO alphabetic code as symbol for every currency.
+    Not thread-safe to modify, thread-safe to read.
+*/
+class currency_symbols
+{
+public:
+  /// Max length of a symbol in bytes (UTF-8 is fine)
+  static const size_t max_size = 7;
+
+  currency_symbols();
+
+  /// Symbol table with common symbols such as $, €, £ and ¥ in UTF-8.
+  static currency_symbols const& common();
+
+  /// Set symbol, truncated to max_size bytes
+  void set(currency unit, char const* symbol);
+
+  /// Null-terminated symbol of currency
+  char const* get(currency unit) const { return syms_[index(unit)]; }
+
+private:
+  #ifndef DOXYGEN_SHOULD_SKIP_THIS
+  static size_t index(currency unit) {
+    return size_t(unit.isonum()) % ISOMON_ISONUM_COUNT;
+  }
+
+  char syms_[ISOMON_ISONUM_COUNT][max_size + 1];
+  #endif
+};
+
+/// Formats money with the moneypunct conventions of a locale.
+/** The grouping, thousands separator, decimal point, signs and positive and
+    negative field patterns are queried from the locale once at
+    construction. Number of fractional digits comes from the currency
+    rather than the locale. Like operator<<, a space separates the
+    currency symbol from the rest of the amount unless the pattern already
+    puts one there. An empty negative sign, as in the classic "C" locale,
+    is replaced by "-" so negative amounts never look positive.
+*/
+class money_formatter
+{
+public:
+  /// Capture moneypunct<char> of locale, with ISO codes as symbols
+  explicit money_formatter(std::locale const& loc = std::locale::classic());
+
+  /// Capture moneypunct<char> of locale, with symbols from table.
+  /** The symbol table must outlive this formatter.
+  */
+  money_formatter(std::locale const& loc, currency_symbols const& symbols);
+
+  /// Maximum number of chars written by format for one value
+  size_t max_size() const { return max_size_; }
+
+  /// Write formatted money (no null terminator).
+  /** @param out NON-NULL pointer to at least max_size() chars.
+      @return Pointer one past last char written.
+  */
+  char * format(char * out, money m) const;
+
+  /// Write count values each followed by delimiter.
+  /** @param out NON-NULL pointer to at least count * (max_size() + 1) chars.
+      @return Pointer one past last char written.
+  */
+  char * format(char * out, money const* values, size_t count,
+                char delimiter = '\n') const;
+
+  std::string str(money m) const;
+
+private:
+  #ifndef DOXYGEN_SHOULD_SKIP_THIS
+  enum { f_end, f_symbol, f_sign, f_value, f_space };
+
+  void init(std::locale const& loc);
+  static void compile(std::money_base::pattern pat, char * fields);
+  char * write_value(char * out, uint64_t minors, currency unit) const;
+
+  currency_symbols const* symbols_;
+  char decimal_point_;
+  char thousands_sep_;
+  char grouping_[8];
+  char pos_sign_[4];
+  char neg_sign_[4];
+  char pos_fields_[8];
+  char neg_fields_[8];
+  size_t max_size_;
+  #endif
+};
+
+/////////////////////////////////////////////////////////////////////
+
+inline currency_symbols::currency_symbols()
+{
+  for (size_t i = 0; i < ISOMON_ISONUM_COUNT; ++i) {
+    std::memcpy(syms_[i], data::isonum2code(i), 4);
+  }
+}
+
+inline void currency_symbols::set(currency unit, char const* symbol)
+{
+  char * dest = syms_[index(unit)];
+  std::strncpy(dest, symbol, max_size);
+  dest[max_size] = '\0';
+}
+
+inline currency_symbols const& currency_symbols::common()
+{
+  struct init_common : currency_symbols {
+    init_common() {
+      set(ISO_USD, "$");
+      set(ISO_EUR, "\xE2\x82\xAC");
+      set(ISO_GBP, "\xC2\xA3");
+      set(ISO_JPY, "\xC2\xA5");
+      set(ISO_CNY, "\xC2\xA5");
+      set(ISO_INR, "\xE2\x82\xB9");
+      set(ISO_KRW, "\xE2\x82\xA9");
+      set(ISO_RUB, "\xE2\x82\xBD");
+      set(ISO_ILS, "\xE2\x82\xAA");
+      set(ISO_CHF, "CHF");
+    }
+  };
+  static init_common table;
+  return table;
+}
+
+inline money_formatter::money_formatter(std::locale const& loc)
+  : symbols_(0)
+{
+  init(loc);
+}
+
+inline money_formatter::money_formatter(std::locale const& loc,
+                                        currency_symbols const& symbols)
+  : symbols_(&symbols)
+{
+  init(loc);
+}
+
+inline void money_formatter::init(std::locale const& loc)
+{
+  using namespace std;
+  const moneypunct<char> & mp = use_facet<moneypunct<char> >(loc);
+  decimal_point_ = mp.decimal_point();
+  thousands_sep_ = mp.thousands_sep();
+  string grouping = mp.grouping();
+  size_t n = std::min(grouping.size(), sizeof(grouping_) - 1);
+  std::memcpy(grouping_, grouping.data(), n);
+  grouping_[n] = '\0';
+  string pos = mp.positive_sign().substr(0, sizeof(pos_sign_) - 1);
+  string neg = mp.negative_sign().substr(0, sizeof(neg_sign_) - 1);
+  if (neg.empty()) neg = "-"; // classic "C" locale has no negative sign
+  std::memcpy(pos_sign_, pos.c_str(), pos.size() + 1);
+  std::memcpy(neg_sign_, neg.c_str(), neg.size() + 1);
+  compile(mp.pos_format(), pos_fields_);
+  compile(mp.neg_format(), neg_fields_);
+  // digits with a separator between every digit, plus decimal point
+  max_size_ = 2 * decimal_max_size + currency_symbols::max_size
+              + 2 * (sizeof(neg_sign_) + 2);
+}
+
+// turn the four pattern fields into a list of things to write,
+// making sure symbol is separated by a space from the value that follows
+// or precedes it, while a sign before the symbol hugs it as in "(USD 1.00)"
+inline void money_formatter::compile(std::money_base::pattern pat,
+                                     char * fields)
+{
+  char * p = fields;
+  for (int i = 0; i < 4; ++i) {
+    switch (pat.field[i]) {
+      case std::money_base::symbol: *p++ = f_symbol; break;
+      case std::money_base::sign: *p++ = f_sign; break;
+      case std::money_base::value: *p++ = f_value; break;
+      case std::money_base::space: *p++ = f_space; break;
+      default: break;
+    }
+  }
+  *p = f_end;
+  char spaced[8];
+  char * q = spaced;
+  for (p = fields; *p != f_end; ++p) {
+    if (*p == f_symbol && p > fields && q[-1] == f_value) *q++ = f_space;
+    *q++ = *p;
+    if (*p == f_symbol && p[1] != f_end && p[1] != f_space) *q++ = f_space;
+  }
+  *q = f_end;
+  std::memcpy(fields, spaced, sizeof(spaced));
+}
+
+inline char * money_formatter::write_value(char * out, uint64_t n,
+                                           currency unit) const
+{
+  int64_t num_minors = unit.num_minors();
+  int digits = unit.num_digits();
+  uint64_t major = n;
+  uint64_t frac = 0;
+  if (num_minors > 0) {
+    major = n / num_minors;
+    frac = (n % num_minors) * (detail::pow10(digits) / num_minors);
+  }
+  char buf[decimal_max_size];
+  char * end = detail::write_uint(buf, major);
+  char const* g = grouping_;
+  if (*g <= 0 || *g == CHAR_MAX || thousands_sep_ == '\0') {
+    std::memcpy(out, buf, end - buf);
+    out += end - buf;
+  } else {
+    // count separators from the right, then copy left to right
+    char seps[decimal_max_size];
+    int len = int(end - buf);
+    int nseps = 0;
+    int pos = len;
+    int group = *g;
+    while (group > 0 && group != CHAR_MAX && pos > group) {
+      pos -= group;
+      seps[nseps++] = char(pos);
+      if (g[1] != '\0') group = *++g;
+    }
+    for (int i = 0; i < len; ++i) {
+      if (nseps > 0 && seps[nseps - 1] == i) {
+        *out++ = thousands_sep_;
+        --nseps;
+      }
+      *out++ = buf[i];
+    }
+  }
+  if (digits > 0 && num_minors > 0) {
+    *out++ = decimal_point_;
+    out = detail::write_uint(out, frac, digits);
+  }
+  return out;
+}
+
+inline char * money_formatter::format(char * out, money m) const
+{
+  int64_t minors = m.total_minors();
+  bool neg = minors < 0;
+  uint64_t n = neg ? 0 - uint64_t(minors) : uint64_t(minors);
+  char const* sign = neg ? neg_sign_ : pos_sign_;
+  currency unit = m.unit();
+  for (char const* f = neg ? neg_fields_ : pos_fields_; *f != f_end; ++f) {
+    switch (*f) {
+      case f_symbol: {
+        char const* sym = symbols_ ? symbols_->get(unit) : unit.c_str();
+        while (*sym) *out++ = *sym++;
+        break;
+      }
+      case f_sign:
+        if (*sign) *out++ = *sign;
+        break;
+      case f_value:
+        out = write_value(out, n, unit);
+        break;
+      case f_space:
+        *out++ = ' ';
+        break;
+    }
+  }
+  // remaining chars of a multi-char sign go at the end, like money_put
+  if (*sign) {
+    for (++sign; *sign; ++sign) *out++ = *sign;
+  }
+  return out;
+}
+
+inline char * money_formatter::format(char * out, money const* values,
+                                      size_t count, char delimiter) const
+{
+  for (size_t i = 0; i < count; ++i) {
+    out = format(out, values[i]);
+    *out++ = delimiter;
+  }
+  return out;
+}
+
+inline std::string money_formatter::str(money m) const
+{
+  char buf[128];
+  return std::string(buf, format(buf, m));
+}
+
+} // namespace isomon
+
+#endif
@@ -0,0 +1,272 @@
+#ifndef ISOMON_MONEY_JSON_HPP
+#define ISOMON_MONEY_JSON_HPP
+
+/** @file money_json.hpp
+    @brief Streaming JSON writer and reader for money
+*/
+
+#include "money_text.hpp"
+
+#include <ostream>
+
+namespace isomon {
+
+/// JSON object forms for money
+enum json_style {
+  json_minors,  ///< {"ccy":"EUR","minors":123456}
+  json_decimal  ///< {"ccy":"EUR","amount":"1234.56"}
+};
+
+/// Maximum number of chars written by write_json (no null terminator)
+const size_t json_max_size = 64;
+
+/// Write money as JSON object.
+/** @param out NON-NULL pointer to at least json_max_size chars.
+    @return Pointer one past last char written (no null terminator).
+*/
+inline char * write_json(char * out, money m, json_style style = json_minors);
+
+/// Read money from JSON object.
+/** Accepts either form of json_style with keys in any order and whitespace
+    between tokens. Unknown keys and duplicate keys are rejected.
+    @return Pointer one past the closing brace or NULL if not valid.
+*/
+inline char const* read_json(char const* first, char const* last, money & out);
+
+/// Streaming writer of a JSON array of money to an output stream.
+/** Values are formatted into an internal buffer which is flushed to the
+    stream buffer in large blocks. Call close() or destroy to end array.
+    A block the stream buffer does not take in full sets badbit on the stream.
+*/
+class json_writer
+{
+public:
+  json_writer(std::ostream & os, json_style style = json_minors);
+  ~json_writer() { close(); }
+
+  json_writer & operator << (money m) { write(m); return *this; }
+
+  void write(money m);
+  void write(money const* values, size_t count);
+
+  /// Write closing bracket and flush to stream
+  void close();
+
+private:
+  #ifndef DOXYGEN_SHOULD_SKIP_THIS
+  json_writer(json_writer const&);
+  void operator = (json_writer const&);
+  void flush();
+
+  std::ostream * os_;
+  json_style style_;
+  bool first_;
+  bool closed_;
+  char * end_;
+  char buf_[4096];
+  #endif
+};
+
+/// Streaming reader of a JSON array of money from a character buffer.
+class json_reader
+{
+public:
+  json_reader(char const* first, char const* last);
+
+  /// Read next array element.
+  /** @return False at end of array or on error; fail() tells which.
+  */
+  bool next(money & out);
+
+  /// Read up to count elements, returns number read.
+  size_t read(money * out, size_t count);
+
+  /// True if input was not a valid JSON array of money.
+  bool fail() const { return pos_ == 0; }
+
+  /// Position after last char consumed or NULL after failure.
+  char const* position() const { return pos_; }
+
+private:
+  #ifndef DOXYGEN_SHOULD_SKIP_THIS
+  char const* pos_;
+  char const* last_;
+  bool started_;
+  bool done_;
+  #endif
+};
+
+/////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+// read "key" and colon, returns 0 if not a known key
+inline char const* read_json_key(char const* p, char const* last, int & key)
+{
+  p = read_char(p, last, '"');
+  if (!p) return 0;
+  char const* q = p;
+  while (q < last && *q != '"') ++q;
+  if (q == last) return 0;
+  size_t len = q - p;
+  if (len == 3 && std::memcmp(p, "ccy", 3) == 0) {
+    key = 0;
+  } else if (len == 6 && std::memcmp(p, "minors", 6) == 0) {
+    key = 1;
+  } else if (len == 6 && std::memcmp(p, "amount", 6) == 0) {
+    key = 2;
+  } else {
+    return 0;
+  }
+  return read_char(q + 1, last, ':');
+}
+
+inline char const* read_json_currency(char const* p, char const* last,
+                                      isonum_t & out)
+{
+  p = read_char(p, last, '"');
+  if (!p || last - p < 4 || p[3] != '"') return 0;
+  char code[4] = { p[0], p[1], p[2], '\0' };
+  int16_t hash;
+  if (!data::code2hash(code, &hash) || !data::hash2isonum(hash, &out)) {
+    return 0;
+  }
+  return p + 4;
+}
+
+} // namespace isomon::detail
+
+inline char * write_json(char * out, money m, json_style style)
+{
+  std::memcpy(out, "{\"ccy\":\"", 8);
+  out += 8;
+  std::memcpy(out, m.unit().c_str(), 3);
+  out += 3;
+  if (style == json_decimal) {
+    std::memcpy(out, "\",\"amount\":\"", 12);
+    out = write_decimal(out + 12, m);
+    *out++ = '"';
+  } else {
+    std::memcpy(out, "\",\"minors\":", 11);
+    out = detail::write_int(out + 11, m.total_minors());
+  }
+  *out++ = '}';
+  return out;
+}
+
+inline char const* read_json(char const* first, char const* last, money & out)
+{
+  char const* p = detail::read_char(first, last, '{');
+  if (!p) return 0;
+  isonum_t isonum = ISO_XXX;
+  char const* amount = 0;
+  char const* amount_end = 0;
+  int64_t minors = 0;
+  int seen = 0;
+  for (int i = 0; i < 2; ++i) {
+    if (i > 0 && !(p = detail::read_char(p, last, ','))) return 0;
+    int key;
+    if (!(p = detail::read_json_key(p, last, key))) return 0;
+    if (seen & (1 << key)) return 0;
+    seen |= (1 << key);
+    if (key == 0) {
+      p = detail::read_json_currency(p, last, isonum);
+    } else if (key == 1) {
+      p = detail::read_int(detail::skip_ws(p, last), last, minors);
+    } else if ((amount = detail::read_char(p, last, '"'))) {
+      amount_end = amount;
+      while (amount_end < last && *amount_end != '"') ++amount_end;
+      p = (amount_end < last ? amount_end + 1 : 0);
+    } else {
+      p = 0;
+    }
+    if (!p) return 0;
+  }
+  if (!(seen & 1) || !(p = detail::read_char(p, last, '}'))) return 0;
+  currency unit(isonum);
+  if (!amount) {
+    out = money(0, minors, unit);
+  } else if (unit.is_no_currency()) {
+    out = money();
+  } else if (read_decimal(amount, amount_end, unit, out) != amount_end) {
+    return 0;
+  }
+  return p;
+}
+
+inline json_writer::json_writer(std::ostream & os, json_style style)
+  : os_(&os), style_(style), first_(true), closed_(false), end_(buf_)
+{
+  *end_++ = '[';
+}
+
+inline void json_writer::flush()
+{
+  std::streamsize n = end_ - buf_;
+  if (os_->rdbuf()->sputn(buf_, n) != n) os_->setstate(std::ios_base::badbit);
+  end_ = buf_;
+}
+
+inline void json_writer::write(money m)
+{
+  if (end_ + json_max_size + 2 > buf_ + sizeof(buf_)) flush();
+  if (!first_) *end_++ = ',';
+  first_ = false;
+  end_ = write_json(end_, m, style_);
+}
+
+inline void json_writer::write(money const* values, size_t count)
+{
+  for (size_t i = 0; i < count; ++i) write(values[i]);
+}
+
+inline void json_writer::close()
+{
+  if (closed_) return;
+  closed_ = true;
+  *end_++ = ']';
+  flush();
+}
+
+inline json_reader::json_reader(char const* first, char const* last)
+  : pos_(first), last_(last), started_(false), done_(false)
+{
+}
+
+inline bool json_reader::next(money & out)
+{
+  if (done_ || !pos_) return false;
+  if (!started_) {
+    started_ = true;
+    pos_ = detail::read_char(pos_, last_, '[');
+    if (!pos_) return false;
+    char const* close = detail::read_char(pos_, last_, ']');
+    if (close) {
+      pos_ = close;
+      done_ = true;
+      return false;
+    }
+  } else {
+    char const* p = detail::skip_ws(pos_, last_);
+    if (p < last_ && *p == ']') {
+      pos_ = p + 1;
+      done_ = true;
+      return false;
+    }
+    pos_ = detail::read_char(p, last_, ',');
+    if (!pos_) return false;
+  }
+  pos_ = read_json(pos_, last_, out);
+  return pos_ != 0;
+}
+
+inline size_t json_reader::read(money * out, size_t count)
+{
+  size_t n = 0;
+  while (n < count && next(out[n])) ++n;
+  return n;
+}
+
+} // namespace isomon
+
+#endif
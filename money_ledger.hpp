@@ -0,0 +1,253 @@
+#ifndef ISOMON_MONEY_LEDGER_HPP
+#define ISOMON_MONEY_LEDGER_HPP
+
+/** @file money_ledger.hpp
+    @brief Balances of many accounts in many currencies, posted in batches
+
+    A money_ledger keeps a money balance for every account and currency.
+    Common currencies, given when constructing, are a dense row per account
+    of balances next to their limits, so a posting reads one or two cache
+    lines. Others are kept sparsely, only for the accounts they were posted
+    to. Batches of postings prefetch the rows of postings a few ahead, so
+    that with many accounts their cache misses overlap.
+*/
+
+#include "money.hpp"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace isomon {
+
+/// Money balances of accounts numbered from 0, with lower limits
+/** Balances add up postings with money +=, so saturate to infinity.
+    A posting which lowers a balance below the limit of its account in its
+    currency is rejected, and the balance stays as it is. A copy of a
+    ledger between batches is a consistent snapshot of all its balances.
+    Example: currency common[] = { "EUR", "USD" };
+             money_ledger book(1000, common, 2);
+             book.set_limit(7, money(-100, 0, "EUR"));
+             book.post(7, money(-50, 0, "EUR")) is money_ledger::posted
+             book.post(7, money(-60, 0, "EUR")) is money_ledger::over_limit
+*/
+class money_ledger
+{
+public:
+  enum status {
+    posted,      ///< the amount was added to the balance
+    no_account,  ///< the account number is not below num_accounts()
+    no_currency, ///< the amount has no currency
+    over_limit   ///< the balance would go below the limit of the account
+  };
+
+  struct posting
+  {
+    size_t account;
+    money amount;
+  };
+
+  /// num_accounts accounts with zero balances and no limits
+  /** @param dense_units Pointer to num_dense common currencies
+  */
+  money_ledger(size_t num_accounts, currency const* dense_units,
+               size_t num_dense);
+
+  size_t num_accounts() const { return _num_accounts; }
+
+  /// Balance of account in unit, zero if nothing was posted to it
+  /** @return XXX if account or unit do not exist */
+  money balance(size_t account, currency unit) const;
+
+  /// Balances of account which are not zero, in order of ISO numeric code
+  std::vector<money> balances(size_t account) const;
+
+  /// Sum of the balances of all accounts in unit, with money +=
+  money total(currency unit) const;
+
+  /// Lowest balance allowed for account in the currency of limit
+  /** money::neg_infinity(unit), the default, is no limit. Postings which
+      raise a balance are never rejected, even if it is below the limit.
+      @return False iff account does not exist or limit has no currency
+  */
+  bool set_limit(size_t account, money limit);
+
+  /// Add amount to the balance of account in its currency
+  status post(size_t account, money amount);
+
+  /// Same as post of each of count postings in order
+  /** @param results NULL or pointer to count statuses to write
+      @return Number of postings posted
+  */
+  size_t post(posting const* postings, size_t count, status * results = 0);
+
+private:
+  struct cell
+  {
+    money balance;
+    int64_t limit; // minors
+  };
+
+  static bool by_isonum(money a, money b) {
+    return a.unit().isonum() < b.unit().isonum();
+  }
+
+  static uint64_t sparse_key(size_t account, int64_t isonum) {
+    return (uint64_t(account) << 10) | uint64_t(isonum);
+  }
+
+  cell & sparse(size_t account, currency unit);
+  status apply(cell & c, money amount);
+
+  size_t _num_accounts;
+  size_t _num_dense;
+  std::vector<currency> _dense_units;
+  detail::currency_slots _dense_slots; // of _dense_units
+  std::vector<cell> _dense;          // row of _num_dense per account
+  std::map<uint64_t, cell> _sparse;  // by sparse_key
+};
+
+/////////////////////////////////////////////////////////////////////
+
+inline money_ledger::money_ledger(size_t num_accounts,
+                                  currency const* dense_units,
+                                  size_t num_dense)
+  : _num_accounts(num_accounts), _num_dense(0)
+{
+  for (size_t i = 0; i < num_dense; ++i) {
+    currency unit = dense_units[i];
+    int16_t & d = _dense_slots[unit.isonum()];
+    if (unit.num_minors() > 0 && d < 0) {
+      d = int16_t(_dense_units.size());
+      _dense_units.push_back(unit);
+    }
+  }
+  _num_dense = _dense_units.size();
+  _dense.resize(num_accounts * _num_dense);
+  for (size_t i = 0; i < _dense.size(); ++i) {
+    _dense[i].balance = money(0, 0, _dense_units[i % _num_dense]);
+    _dense[i].limit = detail::NEG_INF_MINORS;
+  }
+}
+
+inline money money_ledger::balance(size_t account, currency unit) const
+{
+  if (account >= _num_accounts || unit.num_minors() < 1) return money();
+  int16_t d = _dense_slots.find(unit.isonum());
+  if (d >= 0) return _dense[account * _num_dense + d].balance;
+  std::map<uint64_t, cell>::const_iterator it;
+  it = _sparse.find(sparse_key(account, unit.isonum()));
+  return (it == _sparse.end() ? money(0, 0, unit) : it->second.balance);
+}
+
+inline std::vector<money> money_ledger::balances(size_t account) const
+{
+  std::vector<money> ret;
+  if (account >= _num_accounts) return ret;
+  for (size_t i = 0; i <= size_t(detail::CURRENCY_BITS); ++i) {
+    int16_t d = _dense_slots.find(i);
+    if (d < 0) continue;
+    money balance = _dense[account * _num_dense + d].balance;
+    if (balance.total_minors() != 0) ret.push_back(balance);
+  }
+  size_t num_dense = ret.size();
+  std::map<uint64_t, cell>::const_iterator it, end;
+  it = _sparse.lower_bound(sparse_key(account, 0));
+  end = _sparse.lower_bound(sparse_key(account + 1, 0));
+  for (; it != end; ++it) {
+    if (it->second.balance.total_minors() != 0) {
+      ret.push_back(it->second.balance);
+    }
+  }
+  std::inplace_merge(ret.begin(), ret.begin() + num_dense, ret.end(),
+                     by_isonum);
+  return ret;
+}
+
+inline money money_ledger::total(currency unit) const
+{
+  if (unit.num_minors() < 1) return money();
+  money sum(0, 0, unit);
+  int16_t d = _dense_slots.find(unit.isonum());
+  if (d >= 0) {
+    for (size_t a = 0; a < _num_accounts; ++a) {
+      sum += _dense[a * _num_dense + d].balance;
+    }
+  } else {
+    std::map<uint64_t, cell>::const_iterator it;
+    for (it = _sparse.begin(); it != _sparse.end(); ++it) {
+      if (it->second.balance.unit() == unit) sum += it->second.balance;
+    }
+  }
+  return sum;
+}
+
+inline money_ledger::cell & money_ledger::sparse(size_t account,
+                                                 currency unit)
+{
+  uint64_t key = sparse_key(account, unit.isonum());
+  std::map<uint64_t, cell>::iterator it = _sparse.lower_bound(key);
+  if (it == _sparse.end() || it->first != key) {
+    cell c = { money(0, 0, unit), detail::NEG_INF_MINORS };
+    it = _sparse.insert(it, std::make_pair(key, c));
+  }
+  return it->second;
+}
+
+inline bool money_ledger::set_limit(size_t account, money limit)
+{
+  currency unit = limit.unit();
+  if (account >= _num_accounts || unit.num_minors() < 1) return false;
+  int16_t d = _dense_slots.find(unit.isonum());
+  cell & c = (d >= 0 ? _dense[account * _num_dense + d]
+                     : sparse(account, unit));
+  c.limit = limit.total_minors();
+  return true;
+}
+
+inline money_ledger::status money_ledger::apply(cell & c, money amount)
+{
+  money updated = c.balance + amount;
+  if (amount.total_minors() < 0 && updated.total_minors() < c.limit) {
+    return over_limit;
+  }
+  c.balance = updated;
+  return posted;
+}
+
+inline money_ledger::status money_ledger::post(size_t account, money amount)
+{
+  isonum_t isonum = amount.unit().isonum();
+  if (account >= _num_accounts) return no_account;
+  if (isonum == ISO_XXX) return no_currency;
+  int16_t d = _dense_slots.find(isonum);
+  if (d >= 0) return apply(_dense[account * _num_dense + d], amount);
+  return apply(sparse(account, amount.unit()), amount);
+}
+
+// Rows are far apart in a ledger of many accounts, and a posting to one
+// row does not wait on others, so prefetching them lets a batch wait on
+// many cache misses at once where posting one by one waits on a few.
+// Sorting batches by account first, for rows in order of address, was
+// measured slower: the sort costs more than the misses it saves.
+inline size_t money_ledger::post(posting const* postings, size_t count,
+                                 status * results)
+{
+  size_t const AHEAD = 16;
+  cell const* rows = (_dense.empty() ? 0 : &_dense[0]);
+  size_t num_posted = 0;
+  for (size_t i = 0; i < count; ++i) {
+    size_t ahead = (i + AHEAD < count ? postings[i + AHEAD].account : 0);
+    if (rows && ahead < _num_accounts) {
+      __builtin_prefetch(rows + ahead * _num_dense);
+    }
+    status s = post(postings[i].account, postings[i].amount);
+    num_posted += (s == posted);
+    if (results) results[i] = s;
+  }
+  return num_posted;
+}
+
+} // namespace isomon
+
+#endif
@@ -0,0 +1,280 @@
+#ifndef ISOMON_MONEY_PARSE_HPP
+#define ISOMON_MONEY_PARSE_HPP
+
+/** @file money_parse.hpp
+    @brief Parsing of localized money text like "1.234.567,89 EUR"
+*/
+
+#include "money_format.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace isomon {
+
+/// Conventions of money text, chosen once per data source
+struct amount_format
+{
+  /// How negative amounts are written
+  enum sign_style {
+    minus_before,  ///< "-1.00", "USD -1.00" or "-USD 1.00"
+    minus_after,   ///< "1.00-"
+    parentheses,   ///< "(1.00)" or "(1.00) USD"
+    any_sign       ///< any of the above
+  };
+
+  /// Where the currency code or symbol is written
+  enum unit_position {
+    unit_before,   ///< "USD 1.00"
+    unit_after,    ///< "1.00 USD"
+    unit_any,      ///< either or none
+    unit_none      ///< never, default currency of parser is used
+  };
+
+  char decimal_mark;      ///< like '.' or ','
+  char group_mark;        ///< like ',', '.', ' ', '\'' or '\0' for none
+  sign_style sign;
+  unit_position position;
+
+  amount_format(char decimal = '.', char group = ',',
+                sign_style s = any_sign, unit_position p = unit_any)
+    : decimal_mark(decimal), group_mark(group), sign(s), position(p) {}
+};
+
+/// Parser of money text in one amount_format.
+/** Amounts are converted with integer arithmetic only. Like read_decimal,
+    fractional digits beyond the minor unit of the currency must be zeros,
+    otherwise the text is not an exact amount and parsing fails. Group
+    marks must separate groups of 3 digits, otherwise parsing fails.
+*/
+class money_parser
+{
+public:
+  /// Parser recognizing ISO alphabetic codes as currency.
+  /** @param default_unit Currency when text has none, or XXX to require
+      currency in the text.
+  */
+  explicit money_parser(amount_format const& fmt,
+                        currency default_unit = currency());
+
+  /// Parser also recognizing the symbols in a symbol table, like "$".
+  money_parser(amount_format const& fmt, currency_symbols const& symbols,
+               currency default_unit = currency());
+
+  /// Parse one amount, surrounding whitespace is skipped.
+  /** @return Pointer one past last char read or NULL if not valid.
+  */
+  char const* parse(char const* first, char const* last, money & out) const;
+
+  /// Parse delimited amounts like "1,00 EUR;2,50 EUR;..." in bulk.
+  /** Stops at the first field that is not a valid amount.
+      @param stop If not NULL, gets position after last field parsed.
+      @return Number of amounts parsed.
+  */
+  size_t parse(char const* first, char const* last, char delimiter,
+               money * out, size_t max_count, char const** stop = 0) const;
+
+private:
+  #ifndef DOXYGEN_SHOULD_SKIP_THIS
+  struct symbol_entry {
+    std::string symbol;
+    isonum_t isonum;
+    bool operator < (symbol_entry const& rhs) const {
+      return symbol.size() > rhs.symbol.size(); // longest first
+    }
+  };
+
+  void init(currency_symbols const* symbols);
+  char const* read_unit(char const* p, char const* last, isonum_t & out) const;
+  char const* read_number(char const* p, char const* last,
+                          char * buf, size_t & len) const;
+
+  amount_format fmt_;
+  currency default_unit_;
+  std::vector<symbol_entry> symbols_;
+  #endif
+};
+
+/////////////////////////////////////////////////////////////////////
+
+inline money_parser::money_parser(amount_format const& fmt,
+                                  currency default_unit)
+  : fmt_(fmt), default_unit_(default_unit)
+{
+  init(0);
+}
+
+inline money_parser::money_parser(amount_format const& fmt,
+                                  currency_symbols const& symbols,
+                                  currency default_unit)
+  : fmt_(fmt), default_unit_(default_unit)
+{
+  init(&symbols);
+}
+
+inline void money_parser::init(currency_symbols const* symbols)
+{
+  if (!symbols) return;
+  for (int16_t i = 0; i < int16_t(ISOMON_ISONUM_COUNT); ++i) {
+    if (!data::is_isonum(i)) continue;
+    char const* sym = symbols->get(i);
+    if (*sym && std::strcmp(sym, data::isonum2code(i)) != 0) {
+      symbol_entry e;
+      e.symbol = sym;
+      e.isonum = i;
+      symbols_.push_back(e);
+    }
+  }
+  std::stable_sort(symbols_.begin(), symbols_.end());
+}
+
+inline char const* money_parser::read_unit(char const* p, char const* last,
+                                           isonum_t & out) const
+{
+  if (last - p >= 3) {
+    char code[4] = { p[0], p[1], p[2], '\0' };
+    bool alone = (last - p == 3 || !std::isalpha((unsigned char)p[3]));
+    if (alone && data::code2isonum(code, &out)) return p + 3;
+  }
+  for (size_t i = 0; i < symbols_.size(); ++i) {
+    std::string const& s = symbols_[i].symbol;
+    if (size_t(last - p) >= s.size()
+        && s.compare(0, s.size(), p, s.size()) == 0) {
+      out = symbols_[i].isonum;
+      return p + s.size();
+    }
+  }
+  return 0;
+}
+
+// Copy digits into buf with '.' as decimal point and no group marks.
+// Group marks are only between digits of the integer part, with at most 3
+// digits before the first and exactly 3 after each, so that a mistyped
+// decimal mark like "1.5" with '.' grouping is not read as 15.
+inline char const* money_parser::read_number(char const* p, char const* last,
+                                             char * buf, size_t & len) const
+{
+  const size_t max_len = 40;
+  len = 0;
+  bool decimal = false;
+  bool grouped = false;
+  size_t run = 0; // integer digits since the start or last group mark
+  while (p < last && len < max_len) {
+    char ch = *p;
+    if (unsigned(ch - '0') < 10) {
+      buf[len++] = ch;
+      run += !decimal;
+    } else if (ch == fmt_.decimal_mark && !decimal) {
+      if (grouped && run != 3) return 0;
+      decimal = true;
+      buf[len++] = '.';
+    } else if (ch == fmt_.group_mark && !decimal && len > 0
+               && p + 1 < last && unsigned(p[1] - '0') < 10) {
+      if (grouped ? run != 3 : run > 3) return 0;
+      grouped = true;
+      run = 0;
+    } else {
+      break;
+    }
+    ++p;
+  }
+  if (grouped && !decimal && run != 3) return 0;
+  return len < max_len ? p : 0;
+}
+
+inline char const* money_parser::parse(char const* first, char const* last,
+                                       money & out) const
+{
+  typedef amount_format af;
+  bool allow_minus_before = (fmt_.sign == af::minus_before
+                             || fmt_.sign == af::any_sign);
+  bool allow_minus_after = (fmt_.sign == af::minus_after
+                            || fmt_.sign == af::any_sign);
+  bool allow_paren = (fmt_.sign == af::parentheses
+                      || fmt_.sign == af::any_sign);
+  bool allow_unit_before = (fmt_.position == af::unit_before
+                            || fmt_.position == af::unit_any);
+  bool allow_unit_after = (fmt_.position == af::unit_after
+                           || fmt_.position == af::unit_any);
+
+  char const* p = detail::skip_ws(first, last);
+  bool paren = false;
+  bool neg = false;
+  bool has_unit = false;
+  isonum_t isonum = default_unit_.isonum();
+  if (allow_paren && p < last && *p == '(') {
+    paren = true;
+    p = detail::skip_ws(p + 1, last);
+  }
+  for (int pass = 0; pass < 2; ++pass) { // unit and sign in either order
+    char const* q;
+    if (allow_unit_before && !has_unit && (q = read_unit(p, last, isonum))) {
+      has_unit = true;
+      p = detail::skip_ws(q, last);
+    }
+    if (allow_minus_before && !neg && !paren && p < last && *p == '-') {
+      neg = true;
+      p = detail::skip_ws(p + 1, last);
+    }
+  }
+  char buf[48];
+  size_t len;
+  char const* num_begin = p;
+  if (!(p = read_number(p, last, buf + 1, len))) return 0;
+  if (p == num_begin) return 0;
+  if (allow_minus_after && !neg && !paren && p < last && *p == '-') {
+    neg = true;
+    ++p;
+  }
+  char const* q = detail::skip_ws(p, last);
+  if (allow_unit_after && !has_unit && (q = read_unit(q, last, isonum))) {
+    has_unit = true;
+    p = q;
+  }
+  if (paren) {
+    p = detail::read_char(p, last, ')');
+    if (!p) return 0;
+    neg = true;
+    q = detail::skip_ws(p, last);
+    if (allow_unit_after && !has_unit && (q = read_unit(q, last, isonum))) {
+      has_unit = true;
+      p = q;
+    }
+  }
+  currency unit(isonum);
+  if (unit.is_no_currency()) return 0;
+  // sign goes in front of the digits so that overlong amounts saturate
+  // to the infinity of their own sign
+  char * num = buf + 1;
+  if (neg) {
+    *--num = '-';
+    ++len;
+  }
+  if (read_decimal(num, num + len, unit, out) != num + len) return 0;
+  return detail::skip_ws(p, last);
+}
+
+inline size_t money_parser::parse(char const* first, char const* last,
+                                  char delimiter, money * out,
+                                  size_t max_count, char const** stop) const
+{
+  size_t n = 0;
+  char const* p = first;
+  while (n < max_count && p < last) {
+    char const* field_end = static_cast<char const*>(
+        std::memchr(p, delimiter, last - p));
+    if (!field_end) field_end = last;
+    if (parse(p, field_end, out[n]) != field_end) break;
+    ++n;
+    p = (field_end < last ? field_end + 1 : last);
+  }
+  if (stop) *stop = p;
+  return n;
+}
+
+} // namespace isomon
+
+#endif
@@ -0,0 +1,251 @@
+#ifndef ISOMON_MONEY_SKETCH_HPP
+#define ISOMON_MONEY_SKETCH_HPP
+
+/** @file money_sketch.hpp
+    @brief Histograms and quantiles of amount sizes per currency
+
+    A money_sketch counts the magnitudes of amounts, the absolute values of
+    their minor units, in logarithmic buckets, one histogram per currency.
+    Magnitudes below 2^_Bits have a bucket each and larger ones share
+    buckets 2^-_Bits as wide as their lower bound, so quantiles are within
+    a relative error of 2^-(_Bits + 1). Inserting is a few integer
+    operations, memory is a fixed number of buckets for each currency seen
+    whatever the number of amounts, and sketches merge by adding counts.
+*/
+
+#include "money.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace isomon {
+
+/// Histograms of magnitudes of amounts per currency
+/** Each currency takes num_buckets counts of 8 bytes, 48 KiB with the
+    default of 7 bits.
+    Example: money_sketch<> sizes;
+             sizes.insert(payments, n);
+             money p99 = sizes.quantile("EUR", 0.99);
+*/
+template <int _Bits = 7>
+class money_sketch
+{
+public:
+  /// Buckets of magnitudes from 0 to 2^53 minor units, the infinities
+  static const size_t num_buckets = ((54 - _Bits) << _Bits) + 1;
+
+  money_sketch();
+
+  /// Count the magnitude of m in its currency, XXX amounts are ignored
+  void insert(money m);
+
+  /// Same as insert of each of count amounts
+  void insert(money const* amounts, size_t count);
+
+  /// Add the counts of other, as if its amounts were inserted here too
+  void merge(money_sketch const& other);
+
+  /// Number of amounts of unit inserted
+  uint64_t count(currency unit) const;
+
+  /// Magnitude at quantile q of the amounts of unit
+  /** The magnitude of rank floor(q * (count - 1)) in increasing order,
+      within a relative error of 2^-(_Bits + 1).
+      @return XXX if there are no amounts of unit or q is not in [0, 1]
+  */
+  money quantile(currency unit, double q) const;
+
+  /// Lowest magnitude and count of each bucket of unit with amounts,
+  /// in increasing order of magnitude
+  std::vector<std::pair<money, uint64_t> > histogram(currency unit) const;
+
+  /// Forget all amounts inserted
+  void clear();
+
+private:
+  struct table
+  {
+    uint64_t count;
+    uint64_t min; // magnitudes
+    uint64_t max;
+    std::vector<uint64_t> buckets;
+  };
+
+  static size_t bucket(uint64_t magnitude);
+  static uint64_t bucket_low(size_t b);
+  static uint64_t bucket_high(size_t b);
+
+  table & find_or_add(int64_t isonum);
+  table const* find(currency unit) const;
+  static void add(table & t, int64_t minors);
+
+  std::vector<table> _tables;
+  std::vector<isonum_t> _isonums; // of _tables
+  detail::currency_slots _slots;  // of _tables
+};
+
+/////////////////////////////////////////////////////////////////////
+
+template <int _Bits>
+const size_t money_sketch<_Bits>::num_buckets;
+
+template <int _Bits>
+money_sketch<_Bits>::money_sketch()
+{
+  static_assert(_Bits >= 0 && _Bits <= 20, "bits not in [0, 20]");
+}
+
+// Magnitudes below 2^_Bits are their own bucket. Others have their top
+// _Bits + 1 bits, in [2^_Bits, 2^(_Bits + 1)), after 2^_Bits buckets for
+// each bit shifted out. Magnitudes are at most 2^53, so with no more than
+// 53 - _Bits shifts the last bucket is num_buckets - 1.
+template <int _Bits>
+inline size_t money_sketch<_Bits>::bucket(uint64_t magnitude)
+{
+  int top = 63 - __builtin_clzll(magnitude | 1);
+  int shift = std::max(0, top - _Bits);
+  return (size_t(shift) << _Bits) + size_t(magnitude >> shift);
+}
+
+template <int _Bits>
+inline uint64_t money_sketch<_Bits>::bucket_low(size_t b)
+{
+  if (b < (size_t(1) << _Bits)) return b;
+  int shift = int(b >> _Bits) - 1;
+  return uint64_t(b - (size_t(shift) << _Bits)) << shift;
+}
+
+template <int _Bits>
+inline uint64_t money_sketch<_Bits>::bucket_high(size_t b)
+{
+  if (b < (size_t(1) << _Bits)) return b;
+  int shift = int(b >> _Bits) - 1;
+  return bucket_low(b) + (uint64_t(1) << shift) - 1;
+}
+
+template <int _Bits>
+typename money_sketch<_Bits>::table &
+money_sketch<_Bits>::find_or_add(int64_t isonum)
+{
+  int16_t & i = _slots[isonum];
+  if (i < 0) {
+    i = int16_t(_tables.size());
+    _tables.push_back(table());
+    _isonums.push_back(isonum_t(isonum));
+    table & t = _tables.back();
+    t.count = 0;
+    t.min = ~uint64_t(0);
+    t.max = 0;
+    t.buckets.assign(num_buckets, 0);
+  }
+  return _tables[i];
+}
+
+template <int _Bits>
+typename money_sketch<_Bits>::table const*
+money_sketch<_Bits>::find(currency unit) const
+{
+  int16_t i = _slots.find(unit.isonum());
+  return (i < 0 ? 0 : &_tables[i]);
+}
+
+template <int _Bits>
+inline void money_sketch<_Bits>::add(table & t, int64_t minors)
+{
+  uint64_t mag = (minors < 0 ? -uint64_t(minors) : uint64_t(minors));
+  ++t.count;
+  t.min = std::min(t.min, mag);
+  t.max = std::max(t.max, mag);
+  ++t.buckets[bucket(mag)];
+}
+
+template <int _Bits>
+inline void money_sketch<_Bits>::insert(money m)
+{
+  int64_t isonum = m.unit().isonum();
+  if (isonum == ISO_XXX) return;
+  add(find_or_add(isonum), m.total_minors());
+}
+
+// amounts mostly come in runs of one currency, looked up once per run
+// from their bits, without checking every currency like unit()
+template <int _Bits>
+void money_sketch<_Bits>::insert(money const* amounts, size_t count)
+{
+  table * t = 0;
+  int64_t isonum = ISO_XXX;
+  for (size_t i = 0; i < count; ++i) {
+    int64_t bits = detail::money_bits(amounts[i]);
+    if ((bits & detail::CURRENCY_BITS) != isonum) {
+      isonum = bits & detail::CURRENCY_BITS;
+      t = (isonum == ISO_XXX ? 0 : &find_or_add(isonum));
+    }
+    if (t) add(*t, bits >> 10);
+  }
+}
+
+template <int _Bits>
+void money_sketch<_Bits>::merge(money_sketch const& other)
+{
+  for (size_t j = 0; j < other._tables.size(); ++j) {
+    table const& o = other._tables[j];
+    table & t = find_or_add(other._isonums[j]);
+    t.count += o.count;
+    t.min = std::min(t.min, o.min);
+    t.max = std::max(t.max, o.max);
+    for (size_t b = 0; b < num_buckets; ++b) t.buckets[b] += o.buckets[b];
+  }
+}
+
+template <int _Bits>
+uint64_t money_sketch<_Bits>::count(currency unit) const
+{
+  table const* t = find(unit);
+  return (t ? t->count : 0);
+}
+
+// The middle of the bucket holding the rank, clamped to the magnitudes
+// seen, which makes the lowest and highest quantiles exact.
+template <int _Bits>
+money money_sketch<_Bits>::quantile(currency unit, double q) const
+{
+  table const* t = find(unit);
+  if (!t || t->count == 0 || !(q >= 0 && q <= 1)) return money();
+  uint64_t rank = uint64_t(q * double(t->count - 1));
+  rank = std::min(rank, t->count - 1);
+  size_t b = 0;
+  for (uint64_t below = 0; (below += t->buckets[b]) <= rank; ++b) {}
+  uint64_t low = bucket_low(b);
+  uint64_t mid = low + (bucket_high(b) - low + 1) / 2;
+  mid = std::max(t->min, std::min(t->max, mid));
+  return money(0, int64_t(mid), unit);
+}
+
+template <int _Bits>
+std::vector<std::pair<money, uint64_t> >
+money_sketch<_Bits>::histogram(currency unit) const
+{
+  std::vector<std::pair<money, uint64_t> > ret;
+  table const* t = find(unit);
+  if (!t) return ret;
+  for (size_t b = 0; b < num_buckets; ++b) {
+    if (t->buckets[b]) {
+      money low(0, int64_t(bucket_low(b)), unit);
+      ret.push_back(std::make_pair(low, t->buckets[b]));
+    }
+  }
+  return ret;
+}
+
+template <int _Bits>
+void money_sketch<_Bits>::clear()
+{
+  _tables.clear();
+  _isonums.clear();
+  _slots.clear();
+}
+
+} // namespace isomon
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef ISOMON_MONEY_TEXT_HPP
+#define ISOMON_MONEY_TEXT_HPP
+
+/** @file money_text.hpp
+    @brief Exact decimal text conversion of money without floating point
+*/
+
+#include "money.hpp"
+
+#include <cstring>
+
+namespace isomon {
+
+/// Maximum number of chars written by write_decimal (no null terminator)
+const size_t decimal_max_size = 24;
+
+/// Write amount of money as decimal text like "-1234.56", no currency code.
+/** Integer arithmetic only, so no double rounding and no locale lookups.
+    Number of fractional digits is num_digits() of the currency.
+    @param out NON-NULL pointer to at least decimal_max_size chars.
+    @return Pointer one past last char written (no null terminator).
+*/
+inline char * write_decimal(char * out, money m);
+
+/// Read decimal text like "-1234.56" as exact amount of money.
+/** Accepts an optional '-' or '+', digits and an optional '.' with digits.
+    Fractional digits beyond num_digits() of the currency must be zeros,
+    otherwise the text is not an exact amount and reading fails.
+    Amounts too large saturate like money construction does.
+    @return Pointer one past last char read or NULL if no valid amount.
+*/
+inline char const* read_decimal(char const* first, char const* last,
+                                currency unit, money & out);
+
+/////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+inline int64_t pow10(int n)
+{
+  static const int64_t table[19] = {
+    1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL,
+    100000000LL, 1000000000LL, 10000000000LL, 100000000000LL,
+    1000000000000LL, 10000000000000LL, 100000000000000LL,
+    1000000000000000LL, 10000000000000000LL, 100000000000000000LL,
+    1000000000000000000LL
+  };
+  return table[n < 0 ? 0 : (n > 18 ? 18 : n)];
+}
+
+inline char const* digit_pairs()
+{
+  return "00010203040506070809101112131415161718192021222324"
+         "25262728293031323334353637383940414243444546474849"
+         "50515253545556575859606162636465666768697071727374"
+         "75767778798081828384858687888990919293949596979899";
+}
+
+// write all decimal digits of n, at least min_digits with zero padding
+inline char * write_uint(char * out, uint64_t n, int min_digits = 1)
+{
+  char buf[20];
+  char * p = buf + sizeof(buf);
+  while (n >= 100) {
+    p -= 2;
+    std::memcpy(p, digit_pairs() + 2 * (n % 100), 2);
+    n /= 100;
+  }
+  if (n >= 10) {
+    p -= 2;
+    std::memcpy(p, digit_pairs() + 2 * n, 2);
+  } else {
+    *--p = char('0' + n);
+  }
+  while (buf + sizeof(buf) - p < min_digits) *--p = '0';
+  size_t len = buf + sizeof(buf) - p;
+  std::memcpy(out, p, len);
+  return out + len;
+}
+
+inline char * write_int(char * out, int64_t i)
+{
+  uint64_t n = i;
+  if (i < 0) {
+    *out++ = '-';
+    n = 0 - n;
+  }
+  return write_uint(out, n);
+}
+
+// read up to max_digits decimal digits, returns end of digits
+inline char const* read_uint(char const* first, char const* last,
+                             uint64_t & out, int max_digits = 18)
+{
+  uint64_t n = 0;
+  char const* p = first;
+  while (p < last && p - first < max_digits && unsigned(*p - '0') < 10) {
+    n = n * 10 + (*p - '0');
+    ++p;
+  }
+  out = n;
+  return p;
+}
+
+// leading zeros do not count against the digit limit of read_uint
+inline char const* skip_zeros(char const* p, char const* last)
+{
+  while (p < last && *p == '0') ++p;
+  return p;
+}
+
+inline char const* skip_ws(char const* p, char const* last)
+{
+  while (p < last && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+    ++p;
+  }
+  return p;
+}
+
+inline char const* read_char(char const* p, char const* last, char ch)
+{
+  p = skip_ws(p, last);
+  return (p < last && *p == ch) ? p + 1 : 0;
+}
+
+// signed integer of at most 18 digits, more digits saturate to 10^18
+inline char const* read_int(char const* first, char const* last, int64_t & out)
+{
+  char const* p = first;
+  bool neg = (p < last && *p == '-');
+  if (p < last && (*p == '-' || *p == '+')) ++p;
+  uint64_t n;
+  char const* end = read_uint(skip_zeros(p, last), last, n);
+  if (end == p) return 0;
+  while (end < last && unsigned(*end - '0') < 10) {
+    n = pow10(18);
+    ++end;
+  }
+  out = neg ? -int64_t(n) : int64_t(n);
+  return end;
+}
+
+} // namespace isomon::detail
+
+inline char * write_decimal(char * out, money m)
+{
+  int64_t minors = m.total_minors();
+  uint64_t n = minors;
+  if (minors < 0) {
+    *out++ = '-';
+    n = 0 - n;
+  }
+  currency unit = m.unit();
+  int digits = unit.num_digits();
+  int64_t num_minors = unit.num_minors();
+  if (digits < 1 || num_minors < 1) {
+    return detail::write_uint(out, n);
+  }
+  out = detail::write_uint(out, n / num_minors);
+  *out++ = '.';
+  uint64_t frac = (n % num_minors) * (detail::pow10(digits) / num_minors);
+  return detail::write_uint(out, frac, digits);
+}
+
+inline char const* read_decimal(char const* first, char const* last,
+                                currency unit, money & out)
+{
+  int64_t num_minors = unit.num_minors();
+  if (num_minors < 1) return 0;
+  int digits = unit.num_digits();
+  char const* p = first;
+  bool neg = (p < last && *p == '-');
+  if (p < last && (*p == '-' || *p == '+')) ++p;
+  uint64_t major;
+  char const* end = detail::read_uint(detail::skip_zeros(p, last), last,
+                                      major);
+  bool overflow = false;
+  while (end < last && unsigned(*end - '0') < 10) {
+    overflow = true;
+    ++end;
+  }
+  bool any_digits = (end != p);
+  uint64_t frac = 0;
+  if (end < last && *end == '.') {
+    p = end + 1;
+    end = detail::read_uint(p, last, frac, digits);
+    int frac_digits = int(end - p);
+    while (end < last && *end == '0') ++end;
+    if (end < last && unsigned(*end - '0') < 10) return 0; // inexact
+    any_digits = any_digits || (end != p);
+    frac *= detail::pow10(digits - frac_digits);
+  }
+  if (!any_digits) return 0;
+  int64_t scale = detail::pow10(digits);
+  if ((frac * num_minors) % scale != 0) return 0; // not a whole minor unit
+  int64_t minors = detail::POS_INF_MINORS + 1; // saturates either sign
+  if (!overflow && major <= uint64_t(detail::POS_INF_MINORS / num_minors)) {
+    minors = int64_t(major) * num_minors + int64_t(frac * num_minors / scale);
+  }
+  out = money(0, neg ? -minors : minors, unit);
+  return end;
+}
+
+} // namespace isomon
+
+#endif
@@ -0,0 +1,237 @@
+#ifndef ISOMON_MONEY_WIRE_HPP
+#define ISOMON_MONEY_WIRE_HPP
+
+/** @file money_wire.hpp
+    @brief Compact variable length wire encoding of money arrays
+*/
+
+#include "money.hpp"
+
+#include <cstring>
+
+namespace isomon {
+
+/// Upper bound on bytes written by wire_encode for count values
+inline size_t wire_max_size(size_t count);
+
+/// Encode array of money into compact bytes.
+/** Layout, all integers little-endian:
+    - LEB128 varint count of values
+    - LEB128 varint number of distinct currencies in dictionary
+    - dictionary of 2 byte ISO numeric codes, in order of first appearance
+    - if more than one currency, an index into dictionary per value,
+      1 byte each or 2 bytes each if more than 256 currencies
+    - length nibbles: 4 bits per value, byte length minus 1, low nibble first
+    - the zigzag encoded total_minors() of each value in 1 to 8 bytes
+
+    Keeping lengths apart from the data, in the style of stream-vbyte, makes
+    decoding free of per-byte branches. A typical single currency array of
+    small amounts takes just over 1.5 bytes per value.
+    @param out NON-NULL pointer to at least wire_max_size(count) bytes.
+    @return Number of bytes written.
+*/
+inline size_t wire_encode(money const* values, size_t count, uint8_t * out);
+
+/// Read number of values encoded by wire_encode.
+/** @return False iff the bytes are not the start of wire_encode output.
+*/
+inline bool wire_count(uint8_t const* in, size_t size, size_t * count);
+
+/// Decode money array from bytes written by wire_encode.
+/** @param out NON-NULL pointer to memory for count values as given by
+    wire_count.
+    @return False iff the bytes are not a complete wire_encode output.
+*/
+inline bool wire_decode(uint8_t const* in, size_t size, money * out);
+
+/////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+inline uint64_t zigzag(int64_t i)
+{
+  return (uint64_t(i) << 1) ^ uint64_t(i >> 63);
+}
+
+inline int64_t unzigzag(uint64_t u)
+{
+  return int64_t(u >> 1) ^ -int64_t(u & 1);
+}
+
+// number of bytes 1 to 8 to hold all significant bits of u
+inline unsigned byte_length(uint64_t u)
+{
+  return (71 - __builtin_clzll(u | 1)) / 8;
+}
+
+inline uint64_t load_le64(uint8_t const* p)
+{
+  uint64_t u;
+  std::memcpy(&u, p, 8);
+  #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  u = __builtin_bswap64(u);
+  #endif
+  return u;
+}
+
+inline void store_le64(uint8_t * p, uint64_t u)
+{
+  #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  u = __builtin_bswap64(u);
+  #endif
+  std::memcpy(p, &u, 8);
+}
+
+inline uint8_t * write_leb128(uint8_t * out, uint64_t u)
+{
+  while (u >= 0x80) {
+    *out++ = uint8_t(u | 0x80);
+    u >>= 7;
+  }
+  *out++ = uint8_t(u);
+  return out;
+}
+
+inline uint8_t const* read_leb128(uint8_t const* in, uint8_t const* end,
+                                  uint64_t & u)
+{
+  u = 0;
+  for (int shift = 0; in < end && shift < 64; shift += 7) {
+    uint8_t b = *in++;
+    u |= uint64_t(b & 0x7F) << shift;
+    if (!(b & 0x80)) return in;
+  }
+  return 0;
+}
+
+} // namespace isomon::detail
+
+inline size_t wire_max_size(size_t count)
+{
+  // counts, full dictionary, 2 byte indexes, nibbles, 8 data bytes each
+  return 2 * 10 + 2 * ISOMON_ISONUM_COUNT + 2 * count + (count + 1) / 2
+         + 8 * count + 8;
+}
+
+inline size_t wire_encode(money const* values, size_t count, uint8_t * out)
+{
+  uint8_t * const begin = out;
+  int16_t dict_index[ISOMON_ISONUM_COUNT];
+  std::memset(dict_index, -1, sizeof(dict_index));
+  isonum_t dict[ISOMON_ISONUM_COUNT];
+  size_t dict_size = 0;
+  for (size_t i = 0; i < count; ++i) {
+    isonum_t num = values[i].unit().isonum();
+    if (dict_index[num] < 0) {
+      dict_index[num] = int16_t(dict_size);
+      dict[dict_size++] = num;
+    }
+  }
+  out = detail::write_leb128(out, count);
+  out = detail::write_leb128(out, dict_size);
+  for (size_t d = 0; d < dict_size; ++d) {
+    *out++ = uint8_t(dict[d]);
+    *out++ = uint8_t(dict[d] >> 8);
+  }
+  if (dict_size > 256) {
+    for (size_t i = 0; i < count; ++i) {
+      int16_t d = dict_index[values[i].unit().isonum()];
+      *out++ = uint8_t(d);
+      *out++ = uint8_t(d >> 8);
+    }
+  } else if (dict_size > 1) {
+    for (size_t i = 0; i < count; ++i) {
+      *out++ = uint8_t(dict_index[values[i].unit().isonum()]);
+    }
+  }
+  uint8_t * nibbles = out;
+  uint8_t * data = nibbles + (count + 1) / 2;
+  for (size_t i = 0; i < count; ++i) {
+    uint64_t z = detail::zigzag(values[i].total_minors());
+    unsigned len = detail::byte_length(z);
+    uint8_t nib = uint8_t(len - 1) << (4 * (i % 2));
+    nibbles[i / 2] = (i % 2) ? uint8_t(nibbles[i / 2] | nib) : nib;
+    detail::store_le64(data, z); // may write past len, never past max size
+    data += len;
+  }
+  return data - begin;
+}
+
+inline bool wire_count(uint8_t const* in, size_t size, size_t * count)
+{
+  uint64_t n;
+  if (!detail::read_leb128(in, in + size, n)) return false;
+  *count = size_t(n);
+  return true;
+}
+
+inline bool wire_decode(uint8_t const* in, size_t size, money * out)
+{
+  uint8_t const* const end = in + size;
+  uint64_t count, dict_size;
+  if (!(in = detail::read_leb128(in, end, count))) return false;
+  if (!(in = detail::read_leb128(in, end, dict_size))) return false;
+  if (count > uint64_t(end - in) || dict_size > ISOMON_ISONUM_COUNT
+      || (count > 0 && dict_size == 0)) {
+    return false;
+  }
+  size_t index_bytes = (dict_size > 256 ? 2 : (dict_size > 1 ? 1 : 0));
+  if (uint64_t(end - in) < 2 * dict_size + index_bytes * count
+                           + (count + 1) / 2) {
+    return false;
+  }
+  currency dict[ISOMON_ISONUM_COUNT];
+  for (size_t d = 0; d < dict_size; ++d) {
+    dict[d] = currency(int16_t(in[0] | (in[1] << 8)));
+    in += 2;
+  }
+  uint8_t const* indexes = in;
+  uint8_t const* nibbles = indexes + index_bytes * count;
+  uint8_t const* data = nibbles + (count + 1) / 2;
+
+  // check sizes up front so the decoding loop need not
+  size_t data_size = count;
+  uint8_t too_long = 0;
+  for (size_t i = 0; i < (count + 1) / 2; ++i) {
+    data_size += (nibbles[i] & 0xF) + (nibbles[i] >> 4);
+    too_long |= nibbles[i];
+  }
+  if (count % 2 && (nibbles[count / 2] & 0xF0)) return false; // unused
+  if ((too_long & 0x88) || data_size != size_t(end - data)) return false;
+  for (size_t i = 0; index_bytes && i < count; ++i) {
+    size_t d = indexes[index_bytes * i];
+    if (index_bytes == 2) d |= size_t(indexes[2 * i + 1]) << 8;
+    if (d >= dict_size) return false;
+  }
+
+  static const uint64_t masks[8] = {
+    0xFFULL, 0xFFFFULL, 0xFFFFFFULL, 0xFFFFFFFFULL, 0xFFFFFFFFFFULL,
+    0xFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL
+  };
+  size_t i = 0;
+  for (; i < count && end - data >= 8; ++i) {
+    unsigned len1 = (nibbles[i / 2] >> (4 * (i % 2))) & 0xF;
+    uint64_t z = detail::load_le64(data) & masks[len1];
+    data += len1 + 1;
+    size_t d = 0;
+    if (index_bytes == 1) d = indexes[i];
+    if (index_bytes == 2) d = indexes[2 * i] | (indexes[2 * i + 1] << 8);
+    out[i] = money(0, detail::unzigzag(z), dict[d]);
+  }
+  for (; i < count; ++i) {
+    unsigned len1 = (nibbles[i / 2] >> (4 * (i % 2))) & 0xF;
+    uint8_t buf[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    std::memcpy(buf, data, len1 + 1);
+    uint64_t z = detail::load_le64(buf);
+    data += len1 + 1;
+    size_t d = 0;
+    if (index_bytes == 1) d = indexes[i];
+    if (index_bytes == 2) d = indexes[2 * i] | (indexes[2 * i + 1] << 8);
+    out[i] = money(0, detail::unzigzag(z), dict[d]);
+  }
+  return true;
+}
+
+} // namespace isomon
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef ISOMON_SHARDED_MONEY_HPP
+#define ISOMON_SHARDED_MONEY_HPP
+
+/** @file sharded_money.hpp
+    @brief Totals of money in every currency spread over per-thread shards,
+    needs C++11
+
+    Many threads adding into one atomic_money all write the same cache line.
+    sharded_money gives each thread its own shard of totals, one for every
+    ISO numeric code, so adds stay in the cache of the core making them.
+*/
+
+#include "atomic_money.hpp"
+
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+namespace isomon {
+
+/// Totals per currency, added to by many threads and read by any
+/** Threads are assigned shards round robin on their first add to any
+    sharded_money, so with at least as many shards as threads no two
+    threads share one. Each shard starts on its own cache line and has a
+    total for every ISO numeric code, ISOMON_ISONUM_COUNT of them, so
+    currencies added with data::add_currency at any time are totalled.
+    Totals are exact as long as no shard saturates to infinity. A read
+    combines shards with money addition, so saturates too.
+*/
+class sharded_money
+{
+public:
+  /// num_shards of 0 is one per hardware thread, rounded up to a power of 2
+  explicit sharded_money(size_t num_shards = 0);
+  ~sharded_money();
+
+  size_t num_shards() const { return _num_shards; }
+
+  /// Add m to the total of its currency, XXX adds are ignored
+  void add(money m);
+
+  /// Total of all shards in currency unit, XXX if it has no minor units
+  money read(currency unit) const;
+
+  /// Totals which are not zero, in order of ISO numeric code
+  std::vector<money> read_all() const;
+
+  /// Set all totals to zero, not safe to call while other threads add
+  void reset();
+
+private:
+  sharded_money(sharded_money const&);
+  void operator = (sharded_money const&);
+
+  atomic_money * shard(size_t i) const { return _cells + i * _stride; }
+
+  size_t _num_shards;      // a power of 2
+  size_t _stride;          // cells per shard, by ISO numeric code
+  atomic_money * _storage;
+  atomic_money * _cells;   // _storage aligned to a cache line
+};
+
+/////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+const size_t CACHE_LINE_SIZE = 64;
+
+// shard of the calling thread, threads numbered round robin on first call
+inline size_t thread_shard(size_t num_shards)
+{
+  static std::atomic<size_t> next(0);
+  thread_local size_t const id = next.fetch_add(1);
+  return id & (num_shards - 1);
+}
+
+} // namespace isomon::detail
+
+inline sharded_money::sharded_money(size_t num_shards)
+  : _num_shards(1)
+{
+  if (num_shards == 0) num_shards = std::thread::hardware_concurrency();
+  while (_num_shards < num_shards) _num_shards *= 2;
+  size_t const per_line = detail::CACHE_LINE_SIZE / sizeof(atomic_money);
+  _stride = (ISOMON_ISONUM_COUNT + per_line - 1) / per_line * per_line;
+  _storage = new atomic_money[_num_shards * _stride + per_line];
+  uintptr_t offset = reinterpret_cast<uintptr_t>(_storage)
+                     % detail::CACHE_LINE_SIZE;
+  _cells = _storage + (offset ? per_line - offset / sizeof(atomic_money) : 0);
+  reset();
+}
+
+inline sharded_money::~sharded_money()
+{
+  delete [] _storage;
+}
+
+inline void sharded_money::add(money m)
+{
+  shard(detail::thread_shard(_num_shards))[m.unit().isonum()].fetch_add(
+      m, std::memory_order_relaxed);
+}
+
+inline money sharded_money::read(currency unit) const
+{
+  money total(0, 0, unit);
+  for (size_t s = 0; s < _num_shards; ++s) {
+    total += shard(s)[unit.isonum()].load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+inline std::vector<money> sharded_money::read_all() const
+{
+  std::vector<money> ret;
+  for (int16_t i = 0; i < int16_t(ISOMON_ISONUM_COUNT); ++i) {
+    if (!data::is_isonum(i)) continue;
+    money total = read(currency(i));
+    if (total.total_minors() != 0) ret.push_back(total);
+  }
+  return ret;
+}
+
+inline void sharded_money::reset()
+{
+  // zero of every ISO numeric code, even of currencies not added yet
+  for (size_t s = 0; s < _num_shards; ++s) {
+    for (size_t i = 0; i < ISOMON_ISONUM_COUNT; ++i) {
+      shard(s)[i].store(detail::money_from_bits(int64_t(i)),
+                        std::memory_order_relaxed);
+    }
+  }
+}
+
+} // namespace isomon
+
+#endif
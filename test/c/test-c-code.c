@@ -1,4 +1,5 @@
 #include "currency_data.h"
+#include "money_arrow.h"
 
 #include <stdio.h>
 #include <ctype.h>
@@ -86,8 +87,32 @@ bool pass_all_unmodified()
   return true;
 }
 
+bool pass_arrow_round_trip()
+{
+  static arrow_currency_dict dict, dict2;
+  isonum_t isonums[] = { 978, 840, 978, 392, 840 };
+  int16_t indices[5];
+  isonum_t back[5];
+  arrow_dict_clear(&dict);
+  if (!arrow_encode_currencies(&dict, isonums, 5, indices)) return false;
+  if (dict.length != 3) return false;
+  if (memcmp(dict.chars, "EURUSDJPY", 9) != 0) return false;
+  if (dict.offsets[3] != 9 || indices[4] != 1) return false;
+  if (!arrow_dict_import(&dict2, dict.offsets, dict.chars, dict.length)) {
+    return false;
+  }
+  if (!arrow_decode_currencies(&dict2, indices, 5, back)) return false;
+  if (memcmp(back, isonums, sizeof(back)) != 0) return false;
+  indices[0] = 3;
+  if (arrow_decode_currencies(&dict2, indices, 5, back)) return false;
+  isonums[0] = 1000;
+  if (arrow_encode_currencies(&dict, isonums, 5, indices)) return false;
+  return true;
+}
+
 bool pass_all()
 {
+  DO_TEST0(pass_arrow_round_trip);
   if (!pass_all_unmodified()) return false;
   DO_TEST3(pass_known_currency, "INR", 356, 100);
 
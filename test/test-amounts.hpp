@@ -0,0 +1,34 @@
+#ifndef ISOMON_TEST_AMOUNTS_HPP
+#define ISOMON_TEST_AMOUNTS_HPP
+
+#include "money.hpp"
+
+#include <cstdlib>
+#include <vector>
+
+// seed of srand for every randomized test, so that failures repeat
+unsigned const TEST_SEED = 12345;
+
+// Mostly ordinary amounts of units[i % num_units], with near infinities,
+// infinities of the first and last unit and, if with_xxx, no currency.
+// Seeds rand() with TEST_SEED.
+inline std::vector<isomon::money> test_amounts(isomon::currency const* units,
+                                               size_t num_units, size_t n,
+                                               bool with_xxx)
+{
+  using isomon::money;
+  std::vector<money> v;
+  srand(TEST_SEED);
+  for (size_t i = 0; i < n; ++i) {
+    int64_t minors = rand() % 20000001 - 10000000;
+    if (i % 89 == 0) minors = (int64_t(rand()) << 22) - (1LL << 52);
+    money m(0, minors, units[i % num_units]);
+    if (i % 211 == 0) m = money::pos_infinity(units[0]);
+    if (i % 223 == 0) m = money::neg_infinity(units[num_units - 1]);
+    if (with_xxx && i % 101 == 0) m = money();
+    v.push_back(m);
+  }
+  return v;
+}
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef ISOMON_TEST_ATOMIC_MONEY_HPP
+#define ISOMON_TEST_ATOMIC_MONEY_HPP
+
+#include "atomic_money.hpp"
+#include "test-amounts.hpp"
+
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace boost;
+using namespace boost::unit_test;
+using namespace isomon;
+
+BOOST_AUTO_TEST_CASE( atomic_money_basic_test )
+{
+  atomic_money a(money(1, 50, "EUR"));
+  BOOST_CHECK( a.is_lock_free() );
+  BOOST_CHECK_EQUAL( a.fetch_add(money(0, 25, "EUR")), money(1, 50, "EUR") );
+  BOOST_CHECK_EQUAL( a.load(), money(1, 75, "EUR") );
+  BOOST_CHECK_EQUAL( a -= money(2, 0, "EUR"), money(0, -25, "EUR") );
+  BOOST_CHECK_EQUAL( a.exchange(money(3, 0, "USD")), money(0, -25, "EUR") );
+  money expected(1, 0, "USD");
+  BOOST_CHECK( !a.compare_exchange_strong(expected, money()) );
+  BOOST_CHECK_EQUAL( expected, money(3, 0, "USD") );
+  BOOST_CHECK( a.compare_exchange_strong(expected, money(4, 0, "USD")) );
+  BOOST_CHECK_EQUAL( money(a), money(4, 0, "USD") );
+
+  a += money(1, 0, "EUR");
+  BOOST_CHECK_EQUAL( a.load(), money() );
+  a += money(1, 0, "EUR");
+  BOOST_CHECK_EQUAL( a.load(), money() );
+  BOOST_CHECK_EQUAL( atomic_money().load(), money() );
+
+  atomic_money big(money::pos_infinity("JPY"));
+  BOOST_CHECK_EQUAL( big += money(0, 1, "JPY"), money::pos_infinity("JPY") );
+  big.store(money::neg_infinity("JPY"));
+  BOOST_CHECK_EQUAL( big.fetch_sub(money(0, 1, "JPY")),
+                     money::neg_infinity("JPY") );
+  BOOST_CHECK_EQUAL( big.load(), money::neg_infinity("JPY") );
+}
+
+// random adds of every size give the same as money +=
+BOOST_AUTO_TEST_CASE( atomic_money_same_as_money_test )
+{
+  char const* codes[] = { "EUR", "EUR", "EUR", "USD", "XXX" };
+  srand(TEST_SEED);
+  money m(0, 0, "EUR");
+  atomic_money a(m);
+  for (int i = 0; i < 200000; ++i) {
+    int64_t minors = int64_t(rand()) << (rand() % 32);
+    if (rand() % 2) minors = -minors;
+    money rhs(0, minors, codes[rand() % 5 ? 0 : rand() % 5]);
+    if (i % 1000 == 0) rhs = money::pos_infinity("EUR");
+    if (i % 1000 == 500) rhs = money::neg_infinity("EUR");
+    BOOST_REQUIRE_EQUAL( a.fetch_add(rhs), m );
+    m += rhs;
+    BOOST_REQUIRE_EQUAL( a.load(), m );
+    if (m == money()) {
+      m = money(0, minors, "EUR");
+      a.store(m);
+    }
+  }
+}
+
+static void add_many(atomic_money * a, money amount, int times)
+{
+  for (int i = 0; i < times; ++i) a->fetch_add(amount);
+}
+
+static void run_threads(atomic_money * a, vector<money> const& amounts,
+                        int times)
+{
+  vector<thread> threads;
+  for (size_t i = 0; i < amounts.size(); ++i) {
+    threads.push_back(thread(add_many, a, amounts[i], times));
+  }
+  for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+}
+
+BOOST_AUTO_TEST_CASE( atomic_money_threads_test )
+{
+  vector<money> amounts;
+  for (int t = 0; t < 8; ++t) {
+    amounts.push_back(money(0, (t % 2 ? -1 : 3) * (t + 1), "EUR"));
+  }
+  atomic_money a(money(0, 0, "EUR"));
+  run_threads(&a, amounts, 100000);
+  int64_t sum = 0;
+  for (int t = 0; t < 8; ++t) sum += amounts[t].total_minors() * 100000;
+  BOOST_CHECK_EQUAL( a.load(), money(0, sum, "EUR") );
+
+  // adds which reach infinity saturate there, however interleaved
+  amounts.assign(8, money(0, 1LL << 30, "EUR"));
+  a.store(money(0, (1LL << 53) - (1LL << 40), "EUR"));
+  run_threads(&a, amounts, 1000);
+  BOOST_CHECK_EQUAL( a.load(), money::pos_infinity("EUR") );
+
+  // one add of another currency makes XXX for good
+  amounts.assign(8, money(0, 1, "EUR"));
+  amounts[3] = money(0, 1, "USD");
+  a.store(money(0, 0, "EUR"));
+  run_threads(&a, amounts, 10000);
+  BOOST_CHECK_EQUAL( a.load(), money() );
+}
+
+// A balance only ever holds the result of whole operations: one thread
+// adds EUR 0.05 while another stores USD 0 and EUR 100 in turn, so every
+// balance seen is USD 0, XXX, or EUR 100 plus a multiple of 0.05.
+static bool legal_balance(money m)
+{
+  if (m == money() || m == money(0, 0, "USD")) return true;
+  int64_t minors = m.total_minors();
+  return m.unit() == currency("EUR") && minors >= 10000 && minors % 5 == 0;
+}
+
+BOOST_AUTO_TEST_CASE( atomic_money_store_race_test )
+{
+  atomic_money a(money(100, 0, "EUR"));
+  std::atomic<bool> done(false);
+  std::atomic<int> illegal(0);
+  thread storer([&]() {
+    for (int i = 0; i < 200000; ++i) {
+      a.store(i % 2 ? money(100, 0, "EUR") : money(0, 0, "USD"));
+    }
+    done = true;
+  });
+  thread watcher([&]() {
+    while (!done) illegal += !legal_balance(a.load());
+  });
+  while (!done) {
+    illegal += !legal_balance(a.fetch_add(money(0, 5, "EUR")));
+  }
+  storer.join();
+  watcher.join();
+  BOOST_CHECK_EQUAL( illegal.load(), 0 );
+  BOOST_CHECK( legal_balance(a.load()) );
+}
+
+#endif
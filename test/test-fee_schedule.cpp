@@ -0,0 +1,152 @@
+#ifndef ISOMON_TEST_FEE_SCHEDULE_HPP
+#define ISOMON_TEST_FEE_SCHEDULE_HPP
+
+#include "fee_schedule.hpp"
+#include "test-amounts.hpp"
+
+#include <cstdlib>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace boost;
+using namespace boost::unit_test;
+using namespace isomon;
+
+typedef fee_schedule<4> schedule4;
+
+static schedule4::rate_type rate4(int64_t mantissa)
+{
+  schedule4::rate_type r = { mantissa };
+  return r;
+}
+
+BOOST_AUTO_TEST_CASE( fee_schedule_examples_test )
+{
+  schedule4 tax;
+  BOOST_CHECK( tax.add_bracket(money(1000, 0, "EUR"), rate4(1000)) );
+  BOOST_CHECK( tax.add_bracket(money(5000, 0, "EUR"), rate4(2000)) );
+  BOOST_CHECK( tax.add_bracket(money(0, 0, "USD"), rate4(50)) );
+  BOOST_CHECK( !tax.add_bracket(money(-1, 0, "EUR"), rate4(50)) );
+  BOOST_CHECK( !tax.add_bracket(money(1, 0, "EUR"), rate4(-50)) );
+  BOOST_CHECK( !tax.add_bracket(money::pos_infinity("EUR"), rate4(50)) );
+  BOOST_CHECK( !tax.add_bracket(money(), rate4(50)) );
+
+  typedef rounding::half_even re;
+  BOOST_CHECK_EQUAL( tax.fee<re>(money(6000, 0, "EUR")), money(600, 0, "EUR") );
+  BOOST_CHECK_EQUAL( tax.fee<re>(money(-6000, 0, "EUR")),
+                     money(600, 0, "EUR") );
+  BOOST_CHECK_EQUAL( tax.fee<re>(money(999, 0, "EUR")), money(0, 0, "EUR") );
+  BOOST_CHECK_EQUAL( tax.fee<re>(money(1000, 5, "EUR")), money(0, 0, "EUR") );
+  BOOST_CHECK_EQUAL( tax.fee<rounding::ceil>(money(1000, 5, "EUR")),
+                     money(0, 1, "EUR") );
+  // 0.5% of 1.10 is 0.0055
+  BOOST_CHECK_EQUAL( tax.fee<re>(money(1, 10, "USD")), money(0, 1, "USD") );
+  BOOST_CHECK_EQUAL( tax.fee<rounding::trunc>(money(1, 10, "USD")),
+                     money(0, 0, "USD") );
+  BOOST_CHECK_EQUAL( tax.fee<re>(money(5, 0, "JPY")), money() );
+  BOOST_CHECK_EQUAL( tax.fee<re>(money()), money() );
+  BOOST_CHECK_EQUAL( tax.fee<re>(money::neg_infinity("EUR")),
+                     money::pos_infinity("EUR") );
+
+  // replacing a rate, minimum and maximum
+  BOOST_CHECK( tax.add_bracket(money(5000, 0, "EUR"), rate4(3000)) );
+  BOOST_CHECK_EQUAL( tax.fee<re>(money(6000, 0, "EUR")), money(700, 0, "EUR") );
+  BOOST_CHECK( tax.set_minimum(money(2, 50, "EUR")) );
+  BOOST_CHECK( tax.set_maximum(money(650, 0, "EUR")) );
+  BOOST_CHECK( !tax.set_minimum(money(0, -1, "EUR")) );
+  BOOST_CHECK( !tax.set_maximum(money()) );
+  BOOST_CHECK_EQUAL( tax.fee<re>(money(0, 1, "EUR")), money(2, 50, "EUR") );
+  BOOST_CHECK_EQUAL( tax.fee<re>(money(0, 0, "EUR")), money(0, 0, "EUR") );
+  BOOST_CHECK_EQUAL( tax.fee<re>(money(6000, 0, "EUR")), money(650, 0, "EUR") );
+  BOOST_CHECK_EQUAL( tax.fee<re>(money::pos_infinity("EUR")),
+                     money(650, 0, "EUR") );
+  BOOST_CHECK( tax.set_minimum(money(1, 0, "GBP")) );
+  BOOST_CHECK_EQUAL( tax.fee<re>(money(0, -3, "GBP")), money(1, 0, "GBP") );
+
+  schedule4 commission(schedule4::whole_amount);
+  commission.add_bracket(money(0, 0, "EUR"), rate4(30));
+  commission.add_bracket(money(10000, 0, "EUR"), rate4(20));
+  BOOST_CHECK_EQUAL( commission.fee<re>(money(9000, 0, "EUR")),
+                     money(27, 0, "EUR") );
+  BOOST_CHECK_EQUAL( commission.fee<re>(money(20000, 0, "EUR")),
+                     money(40, 0, "EUR") );
+
+  // products beyond 2^64
+  fee_schedule<18> fine;
+  fee_schedule<18>::rate_type almost_one = { 999999999999999999LL };
+  fine.add_bracket(money(0, 0, "EUR"), almost_one);
+  BOOST_CHECK_EQUAL( fine.fee<rounding::floor>(money(0, 1LL << 50, "EUR")),
+                     money(0, (1LL << 50) - 1, "EUR") );
+  BOOST_CHECK_EQUAL( fine.fee<rounding::ceil>(money(0, 1LL << 50, "EUR")),
+                     money(0, 1LL << 50, "EUR") );
+}
+
+// fee added up bracket by bracket in int64_t, for small amounts
+template <class _Rounding>
+static money reference_fee(vector<int64_t> const& thresholds,
+                           vector<int64_t> const& rates, bool marginal,
+                           money amount)
+{
+  int64_t mag = amount.total_minors();
+  if (mag < 0) mag = -mag;
+  int64_t raw = 0;
+  for (size_t i = 0; i < thresholds.size(); ++i) {
+    if (mag < thresholds[i]) break;
+    if (marginal) {
+      int64_t top = (i + 1 < thresholds.size() ? thresholds[i + 1] : mag);
+      raw += (min(mag, top) - thresholds[i]) * rates[i];
+    } else {
+      raw = mag * rates[i];
+    }
+  }
+  int64_t minors = isomon::detail::scale_decimal<_Rounding>(raw, -4);
+  return money(0, minors, amount.unit());
+}
+
+template <class _Rounding>
+static void check_fee_schedule(bool marginal)
+{
+  vector<int64_t> thresholds, rates;
+  schedule4 s(marginal ? schedule4::marginal : schedule4::whole_amount);
+  for (int64_t t = 0; t < 2000000; t += 1 + rand() % 300000) {
+    thresholds.push_back(t + 1);
+    rates.push_back(rand() % 30000);
+    s.add_bracket(money(0, t + 1, "EUR"), rate4(rates.back()));
+  }
+  vector<money> amounts;
+  for (int i = 0; i < 20000; ++i) {
+    amounts.push_back(money(0, rand() % 4000001 - 2000000, "EUR"));
+  }
+  amounts[7] = money(0, thresholds[1], "EUR");
+  amounts[8] = money(0, thresholds[1] - 1, "EUR");
+  amounts[9] = money(0, 5, "JPY");
+  vector<money> fees(amounts.size());
+  s.fees<_Rounding>(&amounts[0], amounts.size(), &fees[0]);
+  for (size_t i = 0; i < amounts.size(); ++i) {
+    money expected = money();
+    if (amounts[i].unit() == currency("EUR")) {
+      expected = reference_fee<_Rounding>(thresholds, rates, marginal,
+                                          amounts[i]);
+    }
+    BOOST_REQUIRE_EQUAL( s.fee<_Rounding>(amounts[i]), expected );
+    BOOST_REQUIRE_EQUAL( fees[i], expected );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( fee_schedule_random_test )
+{
+  srand(TEST_SEED);
+  for (int marginal = 0; marginal < 2; ++marginal) {
+    check_fee_schedule<rounding::floor>(marginal);
+    check_fee_schedule<rounding::ceil>(marginal);
+    check_fee_schedule<rounding::trunc>(marginal);
+    check_fee_schedule<rounding::half_away>(marginal);
+    check_fee_schedule<rounding::half_even>(marginal);
+    check_fee_schedule<rounding::half_up>(marginal);
+    check_fee_schedule<rounding::half_down>(marginal);
+    check_fee_schedule<rounding::half_toward_zero>(marginal);
+  }
+}
+
+#endif
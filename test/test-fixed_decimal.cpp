@@ -0,0 +1,88 @@
+#ifndef ISOMON_TEST_FIXED_DECIMAL_HPP
+#define ISOMON_TEST_FIXED_DECIMAL_HPP
+
+#include "fixed_decimal.hpp"
+#include "test-amounts.hpp"
+
+#include <cstdlib>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace boost;
+using namespace boost::unit_test;
+using namespace isomon;
+
+BOOST_AUTO_TEST_CASE( fixed_decimal_convert_test )
+{
+  fixed_decimal<3> x = { 123455 };
+  BOOST_CHECK_EQUAL( money(123, 46, "USD"), rounde(x, "USD") );
+  BOOST_CHECK_EQUAL( money(123, 45, "USD"), floor(x, "USD") );
+  BOOST_CHECK_EQUAL( money(123, 46, "USD"),
+                     convert<rounding::half_up>(x, "USD") );
+  fixed_decimal<0> big = { INT64_MAX };
+  BOOST_CHECK_EQUAL( money::pos_infinity("USD"), trunc(big, "USD") );
+  fixed_decimal<18> tiny = { -1 };
+  BOOST_CHECK_EQUAL( money(0, -1, "KWD"), floor(tiny, "KWD") );
+  BOOST_CHECK_EQUAL( money(0, 0, "KWD"), round(tiny, "KWD") );
+  BOOST_CHECK_EQUAL( money(), round(x, "XAU") );
+}
+
+BOOST_AUTO_TEST_CASE( fixed_decimal_traits_test )
+{
+  typedef number_traits<fixed_decimal<1> > nt;
+  for (int64_t m = -30; m <= 30; ++m) {
+    fixed_decimal<1> x = { m };
+    double d = m / 10.0;
+    BOOST_REQUIRE_EQUAL( nt::floor(x), int64_t(std::floor(d)) );
+    BOOST_REQUIRE_EQUAL( nt::ceil(x), int64_t(std::ceil(d)) );
+    BOOST_REQUIRE_EQUAL( nt::trunc(x), int64_t(std::trunc(d)) );
+    BOOST_REQUIRE_EQUAL( nt::roundhalfout(x), std::llround(d) );
+    BOOST_REQUIRE_EQUAL( nt::roundhalfeven(x), llrounde(d) );
+    BOOST_REQUIRE_EQUAL( nt::roundhalfup(x), llroundhalfup(d) );
+    BOOST_REQUIRE_EQUAL( nt::roundhalfdown(x), llroundhalfdown(d) );
+    BOOST_REQUIRE_EQUAL( nt::roundhalfin(x), llroundhalfin(d) );
+  }
+  BOOST_CHECK( !nt::isnan(fixed_decimal<1>()) );
+  BOOST_CHECK( !nt::isinf(fixed_decimal<1>()) );
+}
+
+// eighths of major units are exact in every number type below, and give
+// ties in currencies with 2 digits
+template <class _Rounding>
+static void check_same_money(int64_t eighths, currency unit)
+{
+  money expected = convert<_Rounding>(eighths / 8.0, unit);
+  BOOST_REQUIRE_EQUAL( expected, convert<_Rounding>(eighths / 8.0f, unit) );
+  BOOST_REQUIRE_EQUAL( expected, convert<_Rounding>(eighths / 8.0L, unit) );
+  fixed_decimal<3> x = { eighths * 125 };
+  BOOST_REQUIRE_EQUAL( expected, convert<_Rounding>(x, unit) );
+  if (eighths % 8 == 0) {
+    int64_t whole = eighths / 8;
+    BOOST_REQUIRE_EQUAL( expected, convert<_Rounding>(whole, unit) );
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef __int128 int128;
+    BOOST_REQUIRE_EQUAL( expected, convert<_Rounding>(int128(whole), unit) );
+#endif
+  }
+}
+
+BOOST_AUTO_TEST_CASE( same_money_from_all_numbers_test )
+{
+  char const* codes[] = { "USD", "JPY", "KWD", "CLF", "XAU" };
+  srand(TEST_SEED);
+  for (int i = 0; i < 50000; ++i) {
+    currency c(codes[i % 5]);
+    int64_t eighths = rand() % (1 << 24) - (1 << 23); // fits float
+    if (i % 3 == 0) eighths &= ~int64_t(7);
+    check_same_money<rounding::floor>(eighths, c);
+    check_same_money<rounding::ceil>(eighths, c);
+    check_same_money<rounding::trunc>(eighths, c);
+    check_same_money<rounding::half_away>(eighths, c);
+    check_same_money<rounding::half_even>(eighths, c);
+    check_same_money<rounding::half_up>(eighths, c);
+    check_same_money<rounding::half_down>(eighths, c);
+    check_same_money<rounding::half_toward_zero>(eighths, c);
+  }
+}
+
+#endif
@@ -0,0 +1,95 @@
+// Built as its own executable with ISOMON_INSTRUMENT defined for every
+// translation unit, see CMakeLists.txt.
+
+#define BOOST_TEST_MODULE instrument
+#include <boost/test/unit_test.hpp>
+
+#include "money_calc.hpp"
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace isomon;
+using namespace isomon::instrument;
+
+static uint64_t delta(counts const& before, event e)
+{
+  return snapshot()[e] - before[e];
+}
+
+BOOST_AUTO_TEST_CASE( enabled_test )
+{
+  BOOST_CHECK( instrument::enabled );
+  BOOST_CHECK_EQUAL( string(name(currency_mismatch)), "currency_mismatch" );
+}
+
+BOOST_AUTO_TEST_CASE( money_events_test )
+{
+  counts before = snapshot();
+  money m(1, 0, "EUR");
+  m += money(1, 0, "USD");
+  BOOST_CHECK_EQUAL( m, money() );
+  BOOST_CHECK_EQUAL( delta(before, currency_mismatch), 1u );
+  BOOST_CHECK_EQUAL( delta(before, saturation), 0u );
+
+  money big = money::pos_infinity("EUR");
+  big += money(0, 1, "EUR");
+  BOOST_CHECK_EQUAL( big, money::pos_infinity("EUR") );
+  big *= 1; // stays infinity, not a new saturation
+  BOOST_CHECK_EQUAL( delta(before, saturation), 1u );
+  money(0, 1LL << 40, "EUR") * 1000000;
+  money(0, -(1LL << 40), "EUR") * 1000000;
+  BOOST_CHECK_EQUAL( delta(before, saturation), 3u );
+
+  money(0, 5, "EUR") + money(0, 5, "EUR");
+  BOOST_CHECK_EQUAL( delta(before, currency_mismatch), 1u );
+}
+
+BOOST_AUTO_TEST_CASE( cast_and_calc_events_test )
+{
+  counts before = snapshot();
+  BOOST_CHECK_EQUAL( round(double(NAN), "EUR"), money() );
+  BOOST_CHECK_EQUAL( floor(double(INFINITY), "EUR"), money::pos_infinity("EUR") );
+  BOOST_CHECK_EQUAL( ceil(-double(INFINITY), "EUR"), money::neg_infinity("EUR") );
+  round(1.5, "EUR");
+  BOOST_CHECK_EQUAL( delta(before, cast_nan), 1u );
+  BOOST_CHECK_EQUAL( delta(before, cast_inf), 2u );
+
+  money_calc<double> mc(money(1, 0, "EUR"));
+  mc += money(1, 0, "EUR");
+  BOOST_CHECK_EQUAL( delta(before, calc_nan), 0u );
+  mc += money(1, 0, "USD");
+  BOOST_CHECK( std::isnan(mc.minors) );
+  BOOST_CHECK_EQUAL( delta(before, calc_nan), 1u );
+  BOOST_CHECK_EQUAL( round(mc), money() );
+  BOOST_CHECK_EQUAL( delta(before, cast_nan), 2u );
+}
+
+BOOST_AUTO_TEST_CASE( unknown_code_test )
+{
+  counts before = snapshot();
+  BOOST_CHECK( currency("AAA").is_no_currency() );
+  currency("USD");
+  istringstream is("ZZZ");
+  currency c;
+  is >> c;
+  BOOST_CHECK( is.fail() );
+  BOOST_CHECK_EQUAL( delta(before, unknown_code), 2u );
+}
+
+BOOST_AUTO_TEST_CASE( threads_aggregate_test )
+{
+  counts before = snapshot();
+  vector<thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.push_back(thread([] {
+      money m;
+      for (int i = 0; i < 1000; ++i) m += money(0, i, "EUR");
+    }));
+  }
+  for (size_t t = 0; t < threads.size(); ++t) threads[t].join();
+  // the threads exited, their counts are kept
+  BOOST_CHECK_EQUAL( delta(before, currency_mismatch), 4000u );
+}
@@ -2,8 +2,14 @@
 #define ISOMON_TEST_MONEY_HPP
 
 #include "money.hpp"
+#include "test-amounts.hpp"
 
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <sstream>
+#include <unordered_set>
+#include <vector>
 #include <boost/test/unit_test.hpp>
 #include <boost/lexical_cast.hpp>
 
@@ -183,5 +189,340 @@ BOOST_AUTO_TEST_CASE( six_fifths_rounding_test )
   BOOST_CHECK_EQUAL( one_99, floor(not_really_two, "USD") );
 }
 
+BOOST_AUTO_TEST_CASE( rounding_policy_test )
+{
+  // all exactly half a cent once multiplied by 100
+  double halves[] = { 0.005, 0.015, 0.025, -0.005, -0.015, -0.025 };
+  int64_t expected[][6] = {
+    { 0, 1, 2, -1, -2, -3 },  // floor
+    { 1, 2, 3, 0, -1, -2 },   // ceil
+    { 0, 1, 2, 0, -1, -2 },   // trunc
+    { 1, 2, 3, -1, -2, -3 },  // half_away
+    { 0, 2, 2, 0, -2, -2 },   // half_even
+    { 1, 2, 3, 0, -1, -2 },   // half_up
+    { 0, 1, 2, -1, -2, -3 },  // half_down
+    { 0, 1, 2, 0, -1, -2 }    // half_toward_zero
+  };
+  for (int i = 0; i < 6; ++i) {
+    double x = halves[i];
+    BOOST_CHECK_EQUAL( expected[0][i],
+                       convert<rounding::floor>(x, "USD").total_minors() );
+    BOOST_CHECK_EQUAL( expected[1][i],
+                       convert<rounding::ceil>(x, "USD").total_minors() );
+    BOOST_CHECK_EQUAL( expected[2][i],
+                       convert<rounding::trunc>(x, "USD").total_minors() );
+    BOOST_CHECK_EQUAL( expected[3][i],
+                       convert<rounding::half_away>(x, "USD").total_minors() );
+    BOOST_CHECK_EQUAL( expected[4][i],
+                       convert<rounding::half_even>(x, "USD").total_minors() );
+    BOOST_CHECK_EQUAL( expected[5][i],
+                       convert<rounding::half_up>(x, "USD").total_minors() );
+    BOOST_CHECK_EQUAL( expected[6][i],
+                       convert<rounding::half_down>(x, "USD").total_minors() );
+    BOOST_CHECK_EQUAL( expected[7][i],
+                       convert<rounding::half_toward_zero>(x, "USD")
+                           .total_minors() );
+  }
+  BOOST_CHECK_EQUAL( money(0, 1, "USD"), round(0.005, "USD") );
+  BOOST_CHECK_EQUAL( money(0, 1, "USD"),
+                     convert<rounding::half_away>(0.005, "USD") );
+}
+
+BOOST_AUTO_TEST_CASE( rounding_traits_test )
+{
+  typedef number_traits<double> nt;
+  double edges[] = { 0.0, -0.0, 0.5, -0.5, 1.5, -1.5, 2.5, -2.5,
+                     0.49999999999999994, -0.49999999999999994,
+                     4503599627370495.5, -4503599627370495.5,
+                     4503599627370496.0, 9007199254740991.0,
+                     9007199254740992.0, -9007199254740992.0, 1e-300 };
+  vector<double> xs(edges, edges + sizeof(edges) / sizeof(edges[0]));
+  srand(TEST_SEED);
+  for (int i = 0; i < 100000; ++i) {
+    double x = (rand() - RAND_MAX / 2) / 1024.0;
+    xs.push_back(x);
+    xs.push_back(std::floor(x) + 0.5);
+    xs.push_back(x * (int64_t(1) << (rand() % 30)));
+  }
+  for (size_t i = 0; i < xs.size(); ++i) {
+    double x = xs[i];
+    BOOST_REQUIRE_EQUAL( nt::floor(x), int64_t(std::floor(x)) );
+    BOOST_REQUIRE_EQUAL( nt::ceil(x), int64_t(std::ceil(x)) );
+    BOOST_REQUIRE_EQUAL( nt::trunc(x), int64_t(std::trunc(x)) );
+    BOOST_REQUIRE_EQUAL( nt::roundhalfout(x), std::llround(x) );
+    BOOST_REQUIRE_EQUAL( nt::roundhalfeven(x), int64_t(std::nearbyint(x)) );
+    bool tie = (std::fabs(x - std::trunc(x)) == 0.5); // exact difference
+    int64_t nearest = std::llround(x);
+    BOOST_REQUIRE_EQUAL( nt::roundhalfup(x),
+                         tie ? int64_t(std::ceil(x)) : nearest );
+    BOOST_REQUIRE_EQUAL( nt::roundhalfdown(x),
+                         tie ? int64_t(std::floor(x)) : nearest );
+    BOOST_REQUIRE_EQUAL( nt::roundhalfin(x),
+                         tie ? int64_t(std::trunc(x)) : nearest );
+  }
+}
+
+// reference rounding by libm and long double, which is exact here
+static void check_half_rounding(double x)
+{
+  long double fl = std::floor((long double)x);
+  bool tie = ((long double)x - fl == 0.5L);
+  int64_t nearest = std::llround(x);
+  BOOST_REQUIRE_EQUAL( llrounde(x), int64_t(std::nearbyint(x)) );
+  BOOST_REQUIRE_EQUAL( llroundhalfup(x), tie ? int64_t(fl + 1) : nearest );
+  BOOST_REQUIRE_EQUAL( llroundhalfdown(x), tie ? int64_t(fl) : nearest );
+  BOOST_REQUIRE_EQUAL( llroundhalfin(x),
+                       tie ? int64_t(std::trunc(x)) : nearest );
+}
+
+static void check_half_rounding_near(double tie)
+{
+  double xs[] = { tie, std::nextafter(tie, 0.0), std::nextafter(tie, 1e300),
+                  std::nextafter(tie, -1e300) };
+  for (int i = 0; i < 4; ++i) {
+    check_half_rounding(xs[i]);
+    check_half_rounding(-xs[i]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( half_rounding_boundaries_test )
+{
+  for (int64_t n = 0; n <= 65536; ++n) check_half_rounding_near(n + 0.5);
+  // in every binade up to 2^53, the first, last and random ties
+  srand(TEST_SEED);
+  for (int k = 16; k <= 53; ++k) {
+    int64_t lo = int64_t(1) << (k - 1);
+    for (int64_t j = 0; j < 256; ++j) {
+      check_half_rounding_near(double(lo + j) + 0.5);
+      check_half_rounding_near(double(2 * lo - j - 1) + 0.5);
+      int64_t r = (int64_t(rand()) << 31 | rand()) & (lo - 1);
+      check_half_rounding_near(double(lo + r) + 0.5);
+    }
+  }
+  check_half_rounding_near(9007199254740992.0);
+
+  // out of the range of int64_t, the same as std::llround
+  double outside[] = { 9223372036854775808.0, -9223372036854775808.0, 1e300,
+                       -1e300, INFINITY, -INFINITY, NAN };
+  for (int i = 0; i < 7; ++i) {
+    double x = outside[i];
+    BOOST_CHECK_EQUAL( llrounde(x), std::llround(x) );
+    BOOST_CHECK_EQUAL( llroundhalfup(x), std::llround(x) );
+    BOOST_CHECK_EQUAL( llroundhalfdown(x), std::llround(x) );
+    BOOST_CHECK_EQUAL( llroundhalfin(x), std::llround(x) );
+  }
+  double largest = std::nextafter(9223372036854775808.0, 0.0);
+  BOOST_CHECK_EQUAL( llrounde(largest), int64_t(largest) );
+  BOOST_CHECK_EQUAL( llrounde(-9223372036854775808.0 + 1024),
+                     int64_t(-9223372036854775808.0 + 1024) );
+}
+
+static bool same_bits(double a, double b)
+{
+  return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+BOOST_AUTO_TEST_CASE( money_value_division_test )
+{
+  for (int16_t i = 0; i < int16_t(ISOMON_ISONUM_COUNT); ++i) {
+    if (!data::is_isonum(i)) continue;
+    currency c(i);
+    money m(123456, 78, c);
+    if (c.num_minors() > 0) {
+      BOOST_CHECK( same_bits(m.value(),
+                             double(m.total_minors()) / c.num_minors()) );
+    }
+  }
+  BOOST_CHECK( std::isnan(money().value()) );
+}
+
+// exact reference with 128 bit integers, policy by index as listed below
+static int64_t reference_decimal(int policy, int64_t mantissa, int shift)
+{
+  __int128 const top = isomon::detail::POS_INF_MINORS;
+  __int128 const bottom = isomon::detail::NEG_INF_MINORS;
+  __int128 pow10 = 1;
+  for (int i = 0; i < (shift < 0 ? -shift : shift); ++i) pow10 *= 10;
+  __int128 v;
+  if (shift >= 0) {
+    v = mantissa * pow10;
+  } else {
+    __int128 fl = mantissa / pow10;
+    if (fl * pow10 > mantissa) --fl;
+    __int128 rem = mantissa - fl * pow10;
+    bool tie = (2 * rem == pow10);
+    __int128 nearest = (2 * rem < pow10 ? fl : fl + 1);
+    __int128 ce = fl + (rem > 0);
+    switch (policy) {
+      case 0: v = fl; break;
+      case 1: v = ce; break;
+      case 2: v = (mantissa < 0 ? ce : fl); break;
+      case 3: v = tie ? (mantissa < 0 ? fl : ce) : nearest; break;
+      case 4: v = tie ? (fl % 2 == 0 ? fl : ce) : nearest; break;
+      case 5: v = tie ? ce : nearest; break;
+      case 6: v = tie ? fl : nearest; break;
+      default: v = tie ? (mantissa < 0 ? ce : fl) : nearest; break;
+    }
+  }
+  return int64_t(v > top ? top : (v < bottom ? bottom : v));
+}
+
+template <class _Rounding>
+static int64_t decimal_minors(int64_t mantissa, int exponent, currency c)
+{
+  return convert_decimal<_Rounding>(mantissa, exponent, c).total_minors();
+}
+
+BOOST_AUTO_TEST_CASE( convert_decimal_test )
+{
+  BOOST_CHECK_EQUAL( money(123, 46, "USD"),
+                     convert_decimal<rounding::half_even>(123455, -3, "USD") );
+  BOOST_CHECK_EQUAL( money(123, 45, "USD"),
+                     convert_decimal<rounding::trunc>(123459, -3, "USD") );
+  BOOST_CHECK_EQUAL( money(-123, -46, "USD"),
+                     convert_decimal<rounding::floor>(-123451, -3, "USD") );
+  BOOST_CHECK_EQUAL( money(1200, 0, "JPY"),
+                     convert_decimal<rounding::floor>(12, 2, "JPY") );
+  BOOST_CHECK_EQUAL( money(0, 1, "KWD"),
+                     convert_decimal<rounding::ceil>(1, -30, "KWD") );
+  BOOST_CHECK_EQUAL( money::pos_infinity("USD"),
+                     convert_decimal<rounding::floor>(1, 20, "USD") );
+  BOOST_CHECK_EQUAL( money::neg_infinity("USD"),
+                     convert_decimal<rounding::floor>(INT64_MIN, 0, "USD") );
+  BOOST_CHECK_EQUAL( money(),
+                     convert_decimal<rounding::floor>(1, 0, "XAU") );
+
+  char const* codes[] = { "USD", "JPY", "KWD", "CLF" };
+  srand(TEST_SEED);
+  for (int i = 0; i < 200000; ++i) {
+    currency c(codes[i % 4]);
+    int64_t m = (int64_t(rand()) << 33 ^ int64_t(rand()) << 2 ^ rand());
+    m >>= rand() % 63;
+    if (rand() % 2) m = -m;
+    if (i % 1000 == 0) m = (i % 2000 ? INT64_MAX : INT64_MIN);
+    int e = rand() % 46 - 30;
+    int shift = e + c.num_digits();
+    BOOST_REQUIRE_EQUAL( decimal_minors<rounding::floor>(m, e, c),
+                         reference_decimal(0, m, shift) );
+    BOOST_REQUIRE_EQUAL( decimal_minors<rounding::ceil>(m, e, c),
+                         reference_decimal(1, m, shift) );
+    BOOST_REQUIRE_EQUAL( decimal_minors<rounding::trunc>(m, e, c),
+                         reference_decimal(2, m, shift) );
+    BOOST_REQUIRE_EQUAL( decimal_minors<rounding::half_away>(m, e, c),
+                         reference_decimal(3, m, shift) );
+    BOOST_REQUIRE_EQUAL( decimal_minors<rounding::half_even>(m, e, c),
+                         reference_decimal(4, m, shift) );
+    BOOST_REQUIRE_EQUAL( decimal_minors<rounding::half_up>(m, e, c),
+                         reference_decimal(5, m, shift) );
+    BOOST_REQUIRE_EQUAL( decimal_minors<rounding::half_down>(m, e, c),
+                         reference_decimal(6, m, shift) );
+    BOOST_REQUIRE_EQUAL( decimal_minors<rounding::half_toward_zero>(m, e, c),
+                         reference_decimal(7, m, shift) );
+  }
+}
+
+// traits of another number type agree with those of double on values
+// both represent exactly
+template <class _Number>
+static void check_traits_like_double(_Number x)
+{
+  typedef number_traits<_Number> nt;
+  typedef number_traits<double> dt;
+  double d = double(x);
+  BOOST_REQUIRE_EQUAL( nt::floor(x), dt::floor(d) );
+  BOOST_REQUIRE_EQUAL( nt::ceil(x), dt::ceil(d) );
+  BOOST_REQUIRE_EQUAL( nt::trunc(x), dt::trunc(d) );
+  BOOST_REQUIRE_EQUAL( nt::roundhalfout(x), dt::roundhalfout(d) );
+  BOOST_REQUIRE_EQUAL( nt::roundhalfeven(x), dt::roundhalfeven(d) );
+  BOOST_REQUIRE_EQUAL( nt::roundhalfup(x), dt::roundhalfup(d) );
+  BOOST_REQUIRE_EQUAL( nt::roundhalfdown(x), dt::roundhalfdown(d) );
+  BOOST_REQUIRE_EQUAL( nt::roundhalfin(x), dt::roundhalfin(d) );
+}
+
+BOOST_AUTO_TEST_CASE( other_number_traits_test )
+{
+  srand(TEST_SEED);
+  for (int i = 0; i < 100000; ++i) {
+    int64_t n = rand() - RAND_MAX / 2;
+    float f = (n >> 7) / 256.0f; // at most 24 significant bits
+    check_traits_like_double(f);
+    check_traits_like_double(std::floor(f) + 0.5f);
+    check_traits_like_double((long double)(n) / 1024);
+    check_traits_like_double(std::floor((long double)(n) / 4) + 0.5L);
+    check_traits_like_double(n);
+  }
+  check_traits_like_double(0.49999997f);
+  check_traits_like_double(-0.49999997f);
+  check_traits_like_double(8388607.5f);
+  check_traits_like_double(4503599627370495.5L);
+  check_traits_like_double(-4503599627370495.5L);
+  BOOST_CHECK( number_traits<float>::isnan(NAN) );
+  BOOST_CHECK( number_traits<long double>::isinf(-INFINITY) );
+  BOOST_CHECK( !number_traits<int64_t>::isinf(INT64_MAX) );
+}
+
+BOOST_AUTO_TEST_CASE( convert_other_numbers_test )
+{
+  BOOST_CHECK_EQUAL( money(1, 13, "USD"), round(1.125f, "USD") );
+  BOOST_CHECK_EQUAL( money(1, 12, "USD"), rounde(1.125L, "USD") );
+  BOOST_CHECK_EQUAL( money(-2, 0, "USD"), floor(-1.9999f, "USD") );
+  BOOST_CHECK_EQUAL( money(), round(NAN, "USD") );
+  BOOST_CHECK_EQUAL( money::neg_infinity("EUR"),
+                     floor(-INFINITY, "EUR") );
+  BOOST_CHECK_EQUAL( money::pos_infinity("EUR"), ceil(1e30L, "EUR") );
+  BOOST_CHECK_EQUAL( money(42, 0, "JPY"), trunc(int64_t(42), "JPY") );
+  BOOST_CHECK_EQUAL( money(-42, 0, "KWD"), round(int64_t(-42), "KWD") );
+  BOOST_CHECK_EQUAL( money::pos_infinity("USD"),
+                     floor(int64_t(90071992547410LL), "USD") );
+  BOOST_CHECK_EQUAL( money(90071992547409LL, 0, "USD"),
+                     floor(int64_t(90071992547409LL), "USD") );
+  BOOST_CHECK_EQUAL( money::neg_infinity("KWD"), floor(INT64_MIN, "KWD") );
+  BOOST_CHECK_EQUAL( money::pos_infinity("KWD"), floor(INT64_MAX, "KWD") );
+  BOOST_CHECK_EQUAL( money(), floor(int64_t(1), "XAU") );
+#ifdef __SIZEOF_INT128__
+  __extension__ typedef __int128 int128;
+  BOOST_CHECK_EQUAL( money(-7, 0, "EUR"), rounde(int128(-7), "EUR") );
+  BOOST_CHECK_EQUAL( money::pos_infinity("EUR"),
+                     rounde(int128(INT64_MAX) * INT64_MAX, "EUR") );
+  BOOST_CHECK_EQUAL( money::neg_infinity("EUR"),
+                     rounde(-int128(INT64_MAX) * INT64_MAX, "EUR") );
 #endif
+}
+
+BOOST_AUTO_TEST_CASE( hash_test )
+{
+  BOOST_CHECK_EQUAL( hash_value(money(1, 50, "EUR")),
+                     hash_value(money(0, 150, "EUR")) );
+  BOOST_CHECK( hash_value(money(1, 0, "EUR"))
+               != hash_value(money(1, 0, "USD")) );
+  BOOST_CHECK_EQUAL( hash_value(currency("EUR")),
+                     hash_value(money(0, 0, "EUR")) );
+  // XAU has no minor units, so money(0, 0, "XAU") is XXX but not the hash
+  BOOST_CHECK_EQUAL( money(0, 0, "XAU"), money() );
+  BOOST_CHECK( hash_value(currency("XAU")) != hash_value(currency("XXX")) );
+  BOOST_CHECK( hash_value(currency("XAU")) != hash_value(money(0, 0, "XAU")) );
+  BOOST_CHECK_EQUAL( std::hash<money>()(money::pos_infinity("JPY")),
+                     hash_value(money::pos_infinity("JPY")) );
+  BOOST_CHECK_EQUAL( std::hash<currency>()(currency("KWD")),
+                     hash_value(currency("KWD")) );
 
+  // whole amounts of a few currencies spread evenly over low bits
+  unordered_set<money> seen;
+  vector<int> buckets(256);
+  char const* codes[] = { "EUR", "USD", "JPY", "GBP" };
+  for (int c = 0; c < 4; ++c) {
+    for (int64_t i = 0; i < 4096; ++i) {
+      money m(i * 5, 0, codes[c]);
+      seen.insert(m);
+      ++buckets[hash_value(m) & 255];
+    }
+  }
+  BOOST_CHECK_EQUAL( seen.size(), 4u * 4096 );
+  BOOST_CHECK( seen.count(money(100, 0, "GBP")) );
+  BOOST_CHECK( !seen.count(money(100, 1, "GBP")) );
+  // 64 per bucket on average, a standard deviation of 8
+  BOOST_CHECK( *min_element(buckets.begin(), buckets.end()) > 24 );
+  BOOST_CHECK( *max_element(buckets.begin(), buckets.end()) < 104 );
+}
+
+#endif
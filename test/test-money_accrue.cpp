@@ -0,0 +1,140 @@
+#ifndef ISOMON_TEST_MONEY_ACCRUE_HPP
+#define ISOMON_TEST_MONEY_ACCRUE_HPP
+
+#include "money_accrue.hpp"
+#include "test-amounts.hpp"
+
+#include <cstdlib>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace boost;
+using namespace boost::unit_test;
+using namespace isomon;
+
+// balances of a few currencies, with infinities and no currency
+static currency const accrue_units[] = { "EUR", "JPY", "KWD", "USD" };
+
+template <class _Rounding>
+static void check_accrue_double(vector<money> const& start)
+{
+  size_t n = start.size();
+  vector<double> rates(n);
+  for (size_t i = 0; i < n; ++i) rates[i] = (rand() % 2001 - 1000) * 1e-5;
+  rates[7] = NAN;
+  rates[n / 2] = -INFINITY;
+  double const shared[] = { 0.0005 / 365, -0.01, 1.5, 0.0, NAN, INFINITY };
+  int const days = 40;
+
+  for (int s = 0; s < 6; ++s) {
+    vector<money> got(start);
+    accrue<_Rounding>(&got[0], n, shared[s], days, 3);
+    for (size_t i = 0; i < n; ++i) {
+      money expected = start[i];
+      for (int d = 0; d < days; ++d) {
+        expected += convert<_Rounding>(expected * shared[s]);
+      }
+      BOOST_REQUIRE_EQUAL( got[i], expected );
+    }
+  }
+  vector<money> got(start);
+  accrue<_Rounding>(&got[0], n, &rates[0], days, 0);
+  for (size_t i = 0; i < n; ++i) {
+    money expected = start[i];
+    for (int d = 0; d < days; ++d) {
+      expected += convert<_Rounding>(expected * rates[i]);
+    }
+    BOOST_REQUIRE_EQUAL( got[i], expected );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( accrue_double_test )
+{
+  vector<money> start = test_amounts(accrue_units, 4, 10000, true);
+  check_accrue_double<rounding::floor>(start);
+  check_accrue_double<rounding::ceil>(start);
+  check_accrue_double<rounding::trunc>(start);
+  check_accrue_double<rounding::half_away>(start);
+  check_accrue_double<rounding::half_even>(start);
+  check_accrue_double<rounding::half_up>(start);
+  check_accrue_double<rounding::half_down>(start);
+  check_accrue_double<rounding::half_toward_zero>(start);
+
+  money m(100, 0, "EUR");
+  accrue<rounding::trunc>(&m, 1, 0.1, 3);
+  BOOST_CHECK_EQUAL( m, money(133, 10, "EUR") );
+  accrue<rounding::trunc>(&m, 1, 0.1, 0);
+  BOOST_CHECK_EQUAL( m, money(133, 10, "EUR") );
+}
+
+template <class _Rounding>
+static void check_accrue_fixed(vector<money> const& start)
+{
+  // products of balances and mantissas here fit in int64_t
+  size_t n = start.size();
+  vector<fixed_decimal<7> > rates(n);
+  for (size_t i = 0; i < n; ++i) rates[i].mantissa = rand() % 200001 - 100000;
+  int const days = 30;
+  vector<money> got(start);
+  accrue<_Rounding>(&got[0], n, &rates[0], days, 2);
+  for (size_t i = 0; i < n; ++i) {
+    money expected = start[i];
+    for (int d = 0; d < days; ++d) {
+      int64_t p = expected.total_minors() * rates[i].mantissa;
+      money interest(0, isomon::detail::scale_decimal<_Rounding>(p, -7),
+                     expected.unit());
+      expected += interest;
+    }
+    BOOST_REQUIRE_EQUAL( got[i], expected );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( accrue_fixed_test )
+{
+  vector<money> start = test_amounts(accrue_units, 4, 5000, true);
+  for (size_t i = 0; i < start.size(); ++i) {
+    int64_t minors = start[i].total_minors();
+    if (minors > (1LL << 40) || minors < -(1LL << 40)) {
+      start[i] = money(0, rand(), start[i].unit());
+    }
+  }
+  check_accrue_fixed<rounding::floor>(start);
+  check_accrue_fixed<rounding::ceil>(start);
+  check_accrue_fixed<rounding::trunc>(start);
+  check_accrue_fixed<rounding::half_away>(start);
+  check_accrue_fixed<rounding::half_even>(start);
+  check_accrue_fixed<rounding::half_up>(start);
+  check_accrue_fixed<rounding::half_down>(start);
+  check_accrue_fixed<rounding::half_toward_zero>(start);
+
+  // exact where double is not: 0.1 is not a double
+  fixed_decimal<1> tenth = { 1 };
+  money m(0, 25, "EUR");
+  accrue<rounding::half_even>(&m, 1, tenth, 1);
+  BOOST_CHECK_EQUAL( m, money(0, 27, "EUR") ); // 2.5 to 2
+  fixed_decimal<2> x = { 5 };
+  m = money(0, 30, "USD");
+  accrue<rounding::half_down>(&m, 1, x, 1);
+  BOOST_CHECK_EQUAL( m, money(0, 31, "USD") ); // 1.5 to 1
+
+  // products beyond 2^64 and saturation
+  fixed_decimal<18> big = { 999999999999999999LL }; // 1 - 10^-18
+  m = money(0, (1LL << 51) + 3, "EUR");
+  accrue<rounding::floor>(&m, 1, big, 1);
+  BOOST_CHECK_EQUAL( m, money(0, (1LL << 52) + 5, "EUR") );
+  m = money(0, -(1LL << 51) - 3, "EUR");
+  accrue<rounding::ceil>(&m, 1, big, 1);
+  BOOST_CHECK_EQUAL( m, money(0, -(1LL << 52) - 5, "EUR") );
+  accrue<rounding::ceil>(&m, 1, big, 1);
+  BOOST_CHECK_EQUAL( m, money::neg_infinity("EUR") );
+  fixed_decimal<0> triple = { 3 };
+  m = money(0, 1LL << 51, "JPY");
+  accrue<rounding::trunc>(&m, 1, triple, 1);
+  BOOST_CHECK_EQUAL( m, money::pos_infinity("JPY") );
+  m = money();
+  accrue<rounding::trunc>(&m, 1, triple, 5);
+  BOOST_CHECK_EQUAL( m, money() );
+}
+
+#endif
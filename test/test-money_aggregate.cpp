@@ -0,0 +1,192 @@
+#ifndef ISOMON_TEST_MONEY_AGGREGATE_HPP
+#define ISOMON_TEST_MONEY_AGGREGATE_HPP
+
+#include "money_aggregate.hpp"
+#include "test-amounts.hpp"
+
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace boost;
+using namespace boost::unit_test;
+using namespace isomon;
+
+BOOST_AUTO_TEST_CASE( money_aggregator_examples_test )
+{
+  money_aggregator agg;
+  agg.push(money(1, 0, "EUR"));
+  agg.push(money(2, 0, "EUR"));
+  agg.push(money(0, -5, "USD"));
+  agg.push(money());
+  agg.push(money(5, 0, "XXX"));
+
+  money_stats eur = agg.stats("EUR");
+  BOOST_CHECK_EQUAL( eur.unit, currency("EUR") );
+  BOOST_CHECK_EQUAL( eur.count, 2u );
+  BOOST_CHECK_EQUAL( eur.sum, money(3, 0, "EUR") );
+  BOOST_CHECK_EQUAL( eur.min, money(1, 0, "EUR") );
+  BOOST_CHECK_EQUAL( eur.max, money(2, 0, "EUR") );
+  BOOST_CHECK( eur.exact_sum == 300 );
+  BOOST_CHECK_EQUAL( eur.mean<rounding::half_even>(), money(1, 50, "EUR") );
+  BOOST_CHECK_EQUAL( agg.no_currency_count(), 2u );
+
+  money_stats jpy = agg.stats("JPY");
+  BOOST_CHECK_EQUAL( jpy.count, 0u );
+  BOOST_CHECK_EQUAL( jpy.sum, money(0, 0, "JPY") );
+  BOOST_CHECK_EQUAL( jpy.min, money() );
+  BOOST_CHECK_EQUAL( jpy.mean<rounding::half_even>(), money() );
+
+  // snapshot in ISO numeric order, EUR 978 and USD 840
+  vector<money_stats> snap = agg.snapshot();
+  BOOST_REQUIRE_EQUAL( snap.size(), 2u );
+  BOOST_CHECK_EQUAL( snap[0].unit, currency("USD") );
+  BOOST_CHECK_EQUAL( snap[1].unit, currency("EUR") );
+  agg.push(money(4, 0, "EUR"));
+  BOOST_CHECK_EQUAL( snap[1].count, 2u );
+  BOOST_CHECK_EQUAL( agg.stats("EUR").count, 3u );
+
+  // rounding of the mean, -0.05 / 2
+  agg.push(money(0, 0, "USD"));
+  money_stats usd = agg.stats("USD");
+  BOOST_CHECK_EQUAL( usd.mean<rounding::half_even>(), money(0, -2, "USD") );
+  BOOST_CHECK_EQUAL( usd.mean<rounding::half_away>(), money(0, -3, "USD") );
+  BOOST_CHECK_EQUAL( usd.mean<rounding::floor>(), money(0, -3, "USD") );
+  BOOST_CHECK_EQUAL( usd.mean<rounding::ceil>(), money(0, -2, "USD") );
+
+  // the money sum saturates, the exact sum does not
+  money_aggregator big;
+  money huge(0, 1LL << 52, "EUR");
+  big.push(huge);
+  big.push(huge);
+  big.push(-huge);
+  BOOST_CHECK_EQUAL( big.stats("EUR").sum.total_minors(),
+                     (1LL << 53) - 1 - (1LL << 52) );
+  BOOST_CHECK( big.stats("EUR").exact_sum
+               == isomon::detail::int128_t(1LL << 52) );
+  BOOST_CHECK_EQUAL( big.stats("EUR").mean<rounding::trunc>(),
+                     money(0, (1LL << 52) / 3, "EUR") );
+
+  // merged, the money sum is the saturating sum of the partition sums
+  money_aggregator first, rest;
+  first.push(huge);
+  rest.push(huge);
+  rest.push(-huge);
+  first.merge(rest);
+  BOOST_CHECK_EQUAL( first.stats("EUR").sum, huge );
+  BOOST_CHECK( first.stats("EUR").exact_sum == big.stats("EUR").exact_sum );
+  first.merge(big);
+  BOOST_CHECK_EQUAL( first.stats("EUR").sum, money::pos_infinity("EUR") );
+
+  big.push(money::pos_infinity("EUR"));
+  BOOST_CHECK_EQUAL( big.stats("EUR").max, money::pos_infinity("EUR") );
+
+  agg.clear();
+  BOOST_CHECK( agg.snapshot().empty() );
+  BOOST_CHECK_EQUAL( agg.no_currency_count(), 0u );
+}
+
+BOOST_AUTO_TEST_CASE( money_aggregator_random_test )
+{
+  srand(TEST_SEED);
+  char const* codes[] = { "EUR", "USD", "JPY", "KWD", "XXX" };
+  vector<money> stream;
+  for (int i = 0; i < 20000; ++i) {
+    int64_t minors = (int64_t(rand()) << 20 ^ rand()) % (1LL << 40);
+    if (rand() % 2) minors = -minors;
+    if (rand() % 1000 == 0) minors = (rand() % 2 ? 1LL : -1LL) * (1LL << 60);
+    stream.push_back(money(0, minors, codes[rand() % 5]));
+  }
+
+  // four partitions, one pushed in an array, merged
+  money_aggregator whole;
+  money_aggregator parts[4];
+  for (size_t i = 0; i < stream.size(); ++i) {
+    whole.push(stream[i]);
+    if (i % 4) parts[i % 4].push(stream[i]);
+  }
+  for (size_t i = 0; i < stream.size(); i += 4) {
+    parts[0].push(&stream[i], 1);
+  }
+  money_aggregator merged;
+  for (int p = 0; p < 4; ++p) merged.merge(parts[p]);
+
+  uint64_t no_currency = 0;
+  for (size_t c = 0; c < 5; ++c) {
+    currency unit(codes[c]);
+    uint64_t count = 0;
+    money sum(0, 0, unit);
+    isomon::detail::int128_t exact = 0;
+    int64_t lo = isomon::detail::POS_INF_MINORS;
+    int64_t hi = isomon::detail::NEG_INF_MINORS;
+    for (size_t i = 0; i < stream.size(); ++i) {
+      if (stream[i].unit() != unit) continue;
+      ++count;
+      sum += stream[i];
+      exact += stream[i].total_minors();
+      lo = min(lo, stream[i].total_minors());
+      hi = max(hi, stream[i].total_minors());
+    }
+    if (!unit.is_currency()) {
+      no_currency = count;
+      continue;
+    }
+    money_stats s = whole.stats(unit), m = merged.stats(unit);
+    BOOST_CHECK_EQUAL( s.count, count );
+    BOOST_CHECK_EQUAL( s.sum, sum );
+    BOOST_CHECK( s.exact_sum == exact );
+    BOOST_CHECK_EQUAL( s.min, money(0, lo, unit) );
+    BOOST_CHECK_EQUAL( s.max, money(0, hi, unit) );
+    money part_sums(0, 0, unit);
+    for (int p = 0; p < 4; ++p) part_sums += parts[p].stats(unit).sum;
+    BOOST_CHECK_EQUAL( m.count, count );
+    BOOST_CHECK_EQUAL( m.sum, part_sums );
+    BOOST_CHECK( m.exact_sum == exact );
+    BOOST_CHECK_EQUAL( m.min, s.min );
+    BOOST_CHECK_EQUAL( m.max, s.max );
+    BOOST_CHECK_EQUAL( m.mean<rounding::half_even>(),
+                       s.mean<rounding::half_even>() );
+    int64_t mean = s.mean<rounding::floor>().total_minors();
+    BOOST_CHECK( isomon::detail::int128_t(mean) * count <= exact );
+    BOOST_CHECK( isomon::detail::int128_t(mean + 1) * count > exact );
+  }
+  BOOST_CHECK_EQUAL( whole.no_currency_count(), no_currency );
+  BOOST_CHECK_EQUAL( merged.no_currency_count(), no_currency );
+  BOOST_CHECK_EQUAL( whole.snapshot().size(), 4u );
+}
+
+// snapshots taken while another thread pushes see whole arrays only
+BOOST_AUTO_TEST_CASE( shared_money_aggregator_threads_test )
+{
+  shared_money_aggregator agg;
+  vector<money> batch(1000, money(0, 1, "EUR"));
+  batch[7] = money(0, 2, "USD");
+  int const num_batches = 2000;
+  thread pusher([&]() {
+    for (int b = 0; b < num_batches; ++b) agg.push(&batch[0], batch.size());
+  });
+  uint64_t last = 0;
+  size_t bad = 0;
+  for (int i = 0; i < 20000; ++i) {
+    money_stats eur = agg.stats("EUR");
+    vector<money_stats> all = agg.snapshot();
+    if (eur.count % 999 || eur.exact_sum != int64_t(eur.count)
+        || eur.sum != money(0, eur.count, "EUR") || eur.count < last) {
+      ++bad;
+    }
+    last = eur.count;
+    if (!all.empty() && (all.size() != 2 || all[0].count * 999
+                                             != all[1].count)) {
+      ++bad;
+    }
+  }
+  pusher.join();
+  BOOST_CHECK_EQUAL( bad, 0u );
+  agg.publish();
+  BOOST_CHECK_EQUAL( agg.stats("EUR").count, 999u * num_batches );
+  BOOST_CHECK_EQUAL( agg.stats("USD").sum, money(0, 2 * num_batches, "USD") );
+}
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef ISOMON_TEST_MONEY_ALLOCATE_HPP
+#define ISOMON_TEST_MONEY_ALLOCATE_HPP
+
+#include "money_allocate.hpp"
+#include "test-amounts.hpp"
+
+#include <cstdlib>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace boost;
+using namespace boost::unit_test;
+using namespace isomon;
+
+static vector<int64_t> weights_of(int64_t a, int64_t b, int64_t c)
+{
+  vector<int64_t> w;
+  w.push_back(a);
+  w.push_back(b);
+  w.push_back(c);
+  return w;
+}
+
+BOOST_AUTO_TEST_CASE( allocate_examples_test )
+{
+  vector<money> s = allocate(money(1, 0, "USD"), weights_of(1, 1, 1));
+  BOOST_REQUIRE_EQUAL( s.size(), 3u );
+  BOOST_CHECK_EQUAL( s[0], money(0, 34, "USD") );
+  BOOST_CHECK_EQUAL( s[1], money(0, 33, "USD") );
+  BOOST_CHECK_EQUAL( s[2], money(0, 33, "USD") );
+
+  s = allocate(money(-1, 0, "USD"), weights_of(1, 1, 1));
+  BOOST_CHECK_EQUAL( s[0], money(0, -34, "USD") );
+  BOOST_CHECK_EQUAL( s[2], money(0, -33, "USD") );
+
+  // 5 * 0.3 = 1.5, 5 * 0.7 = 3.5, tie goes to the first
+  s = allocate(money(0, 5, "EUR"), weights_of(3, 0, 7));
+  BOOST_CHECK_EQUAL( s[0], money(0, 2, "EUR") );
+  BOOST_CHECK_EQUAL( s[1], money(0, 0, "EUR") );
+  BOOST_CHECK_EQUAL( s[2], money(0, 3, "EUR") );
+
+  s = allocate(money(0, 100, "JPY"), weights_of(1, 2, 3));
+  BOOST_CHECK_EQUAL( s[0], money(0, 17, "JPY") );
+  BOOST_CHECK_EQUAL( s[1], money(0, 33, "JPY") );
+  BOOST_CHECK_EQUAL( s[2], money(0, 50, "JPY") );
+
+  s = allocate(money::pos_infinity("EUR"), weights_of(1, 0, 2));
+  BOOST_CHECK_EQUAL( s[0], money::pos_infinity("EUR") );
+  BOOST_CHECK_EQUAL( s[1], money(0, 0, "EUR") );
+  s = allocate(money(), weights_of(1, 0, 2));
+  BOOST_CHECK_EQUAL( s[2], money() );
+
+  BOOST_CHECK( allocate(money(1, 0, "USD"), weights_of(1, -1, 1)).empty() );
+  BOOST_CHECK( allocate(money(1, 0, "USD"), weights_of(0, 0, 0)).empty() );
+  BOOST_CHECK( allocate(money(1, 0, "USD"), vector<int64_t>()).empty() );
+  BOOST_CHECK( allocate(money(1, 0, "USD"),
+                        weights_of(INT64_MAX, 1, 0)).empty() );
+  s = allocate(money(0, (1LL << 53) - 2, "USD"),
+               weights_of(INT64_MAX - 1, 1, 0));
+  BOOST_CHECK_EQUAL( s[0], money(0, (1LL << 53) - 2, "USD") );
+  BOOST_CHECK_EQUAL( s[1], money(0, 0, "USD") );
+}
+
+// shares by 128 bit division and a full sort, the plain way
+static vector<int64_t> reference_shares(int64_t total, vector<int64_t> w)
+{
+  __extension__ typedef __int128 int128;
+  int128 sum = 0;
+  for (size_t i = 0; i < w.size(); ++i) sum += w[i];
+  int64_t mag = (total < 0 ? -total : total);
+  vector<int64_t> shares(w.size());
+  vector<pair<int128, size_t> > rems;
+  int64_t left = mag;
+  for (size_t i = 0; i < w.size(); ++i) {
+    int128 p = int128(mag) * w[i];
+    shares[i] = int64_t(p / sum);
+    rems.push_back(make_pair(-(p % sum), i)); // larger first, then by index
+    left -= shares[i];
+  }
+  sort(rems.begin(), rems.end());
+  for (int64_t k = 0; k < left; ++k) ++shares[rems[k].second];
+  for (size_t i = 0; i < w.size(); ++i) shares[i] *= (total < 0 ? -1 : 1);
+  return shares;
+}
+
+BOOST_AUTO_TEST_CASE( allocate_random_test )
+{
+  srand(TEST_SEED);
+  for (int i = 0; i < 20000; ++i) {
+    size_t n = 1 + rand() % (i % 10 ? 10 : 300);
+    vector<int64_t> w(n);
+    int shift = rand() % 23; // sum of weights stays below 2^63
+    for (size_t j = 0; j < n; ++j) {
+      w[j] = (rand() % 4 ? int64_t(rand()) << shift : 0);
+    }
+    w[rand() % n] += 1;
+    int64_t total = (int64_t(rand()) << (rand() % 23)) - (1LL << 52);
+    vector<money> s = allocate(money(0, total, "EUR"), w);
+    vector<int64_t> expected = reference_shares(total, w);
+    BOOST_REQUIRE_EQUAL( s.size(), n );
+    money sum(0, 0, "EUR");
+    for (size_t j = 0; j < n; ++j) {
+      BOOST_REQUIRE_EQUAL( s[j].total_minors(), expected[j] );
+      sum += s[j];
+    }
+    BOOST_REQUIRE_EQUAL( sum, money(0, total, "EUR") );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( batch_allocate_test )
+{
+  int64_t w[] = { 5, 0, 11, 7, 1 };
+  vector<money> totals;
+  srand(TEST_SEED);
+  for (int i = 0; i < 1000; ++i) {
+    totals.push_back(money(0, rand() - RAND_MAX / 2, i % 3 ? "EUR" : "KWD"));
+  }
+  totals.push_back(money::neg_infinity("USD"));
+  totals.push_back(money());
+  vector<money> got(totals.size() * 5);
+  BOOST_REQUIRE( batch_allocate(&totals[0], totals.size(), w, 5, &got[0]) );
+  for (size_t i = 0; i < totals.size(); ++i) {
+    money one[5];
+    BOOST_REQUIRE( allocate(totals[i], w, 5, one) );
+    for (int j = 0; j < 5; ++j) BOOST_REQUIRE_EQUAL( got[i * 5 + j], one[j] );
+  }
+  int64_t bad[] = { 1, -2 };
+  BOOST_CHECK( !batch_allocate(&totals[0], totals.size(), bad, 2, &got[0]) );
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef ISOMON_TEST_MONEY_ARROW_HPP
+#define ISOMON_TEST_MONEY_ARROW_HPP
+
+#include "money_arrow.hpp"
+
+#include <cstring>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace boost;
+using namespace boost::unit_test;
+using namespace isomon;
+
+BOOST_AUTO_TEST_CASE( arrow_export_test )
+{
+  money values[] = { money(1, 50, "USD"), money(-2, 0, "JPY"),
+                     money(0, 7, "USD"), money(), money::pos_infinity("EUR") };
+  size_t n = sizeof(values) / sizeof(values[0]);
+  int64_t minors[5];
+  int16_t indices[5];
+  static arrow_currency_dict dict;
+  data::arrow_dict_clear(&dict);
+  arrow_export(values, n, minors, indices, dict);
+
+  int64_t expect_minors[] = { 150, -2, 7, 0, (1LL << 53) - 1 };
+  int16_t expect_indices[] = { 0, 1, 0, 2, 3 };
+  BOOST_CHECK( equal(minors, minors + n, expect_minors) );
+  BOOST_CHECK( equal(indices, indices + n, expect_indices) );
+  BOOST_CHECK_EQUAL( dict.length, 4 );
+  BOOST_CHECK_EQUAL( string(dict.chars, dict.offsets[dict.length]),
+                     "USDJPYXXXEUR" );
+  for (int32_t i = 0; i < dict.length; ++i) {
+    BOOST_CHECK_EQUAL( dict.offsets[i + 1] - dict.offsets[i], 3 );
+  }
+
+  money back[5];
+  BOOST_CHECK( arrow_import(minors, indices, n, dict, back) );
+  BOOST_CHECK( equal(values, values + n, back) );
+
+  // dictionary keeps growing across batches
+  money more[] = { money(3, 0, "GBP"), money(4, 0, "USD") };
+  arrow_export(more, 2, minors, indices, dict);
+  BOOST_CHECK_EQUAL( indices[0], 4 );
+  BOOST_CHECK_EQUAL( indices[1], 0 );
+  BOOST_CHECK_EQUAL( dict.length, 5 );
+}
+
+BOOST_AUTO_TEST_CASE( arrow_import_test )
+{
+  // dictionary as some other Arrow producer might lay it out
+  int32_t offsets[] = { 0, 3, 6, 9 };
+  char const* chars = "eurKWDChf";
+  static arrow_currency_dict dict;
+  BOOST_CHECK( data::arrow_dict_import(&dict, offsets, chars, 3) );
+  BOOST_CHECK_EQUAL( string(dict.chars, 9), "EURKWDCHF" );
+
+  int64_t minors[] = { 1234, -5, 1LL << 60, 0 };
+  int16_t indices[] = { 2, 1, 0, 0 };
+  money out[4];
+  BOOST_CHECK( arrow_import(minors, indices, 4, dict, out) );
+  BOOST_CHECK_EQUAL( out[0], money(12, 34, "CHF") );
+  BOOST_CHECK_EQUAL( out[1], money(0, -5, "KWD") );
+  BOOST_CHECK_EQUAL( out[2], money::pos_infinity("EUR") );
+  BOOST_CHECK_EQUAL( out[3], money(0, 0, "EUR") );
+
+  int16_t bad_indices[] = { 0, 3 };
+  BOOST_CHECK( !arrow_import(minors, bad_indices, 2, dict, out) );
+
+  int32_t bad_offsets[] = { 0, 3, 7 };
+  BOOST_CHECK( !data::arrow_dict_import(&dict, bad_offsets, "EURUSDX", 2) );
+  BOOST_CHECK_EQUAL( dict.length, 0 );
+  BOOST_CHECK( !data::arrow_dict_import(&dict, offsets, "EURAAAUSD", 3) );
+  BOOST_CHECK( !data::arrow_dict_import(&dict, offsets, "EURUSDeur", 3) );
+  BOOST_CHECK_EQUAL( dict.length, 0 );
+}
+
+BOOST_AUTO_TEST_CASE( arrow_round_trip_test )
+{
+  vector<money> values;
+  for (int16_t i = 0; i < int16_t(ISOMON_ISONUM_COUNT); ++i) {
+    if (data::is_isonum(i)) values.push_back(money(0, i * 1000 - 7, i));
+  }
+  size_t n = values.size();
+  vector<int64_t> minors(n);
+  vector<int16_t> indices(n);
+  static arrow_currency_dict dict;
+  data::arrow_dict_clear(&dict);
+  arrow_export(&values[0], n, &minors[0], &indices[0], dict);
+
+  // pass dictionary through its raw Arrow buffers only
+  static arrow_currency_dict dict2;
+  BOOST_CHECK( data::arrow_dict_import(&dict2, dict.offsets, dict.chars,
+                                       dict.length) );
+  vector<money> back(n);
+  BOOST_CHECK( arrow_import(&minors[0], &indices[0], n, dict2, &back[0]) );
+  BOOST_CHECK( back == values );
+}
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef ISOMON_TEST_MONEY_BATCH_HPP
+#define ISOMON_TEST_MONEY_BATCH_HPP
+
+#include "money_batch.hpp"
+#include "test-amounts.hpp"
+
+#include <cstdlib>
+#include <limits>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace boost;
+using namespace boost::unit_test;
+using namespace isomon;
+
+// doubles near every kind of edge: halves, huge, infinite, NaN, tiny
+static vector<double> batch_test_values()
+{
+  vector<double> v;
+  double const inf = numeric_limits<double>::infinity();
+  double specials[] = {
+    0.0, -0.0, 0.005, -0.005, 0.015, -0.015, 0.025, 0.125, -0.125, 0.5, -0.5,
+    1.5, -1.5, 2.5, -2.5, 0.49999999999999994, -0.49999999999999994,
+    1e-300, -1e-300, 4503599627370495.5, 4503599627370496.0,
+    9007199254740991.0, 9007199254740992.0, -9007199254740992.0,
+    90071992547409.91, 90071992547409.92, -90071992547409.92,
+    90071992547409.93, -90071992547409.93, 1e20, -1e20, 1e300, -1e300,
+    inf, -inf, numeric_limits<double>::quiet_NaN()
+  };
+  v.assign(specials, specials + sizeof(specials) / sizeof(specials[0]));
+  srand(TEST_SEED);
+  for (int i = 0; i < 20000; ++i) {
+    double x = (rand() - RAND_MAX / 2) / 1000.0;
+    v.push_back(x);
+    v.push_back(int64_t(x * 2) / 2.0 / 100);        // exact half cents
+    v.push_back(x * (int64_t(1) << (rand() % 50)));  // all magnitudes
+  }
+  return v;
+}
+
+typedef void (*batch_one_unit)(double const*, size_t, currency, money *);
+typedef void (*batch_many_units)(double const*, currency const*, size_t,
+                                 money *);
+typedef money (*scalar_func)(double, currency);
+
+static void check_batch(batch_one_unit batch, batch_many_units batch_units,
+                        scalar_func scalar, char const* name)
+{
+  vector<double> values = batch_test_values();
+  char const* codes[] = { "USD", "JPY", "KWD", "XXX", "XAU", "CLF" };
+  size_t n = values.size();
+  vector<currency> units(n);
+  for (size_t i = 0; i < n; ++i) units[i] = codes[(i * 7) % 6];
+  for (size_t c = 0; c < 6; ++c) {
+    // odd counts and offsets exercise the scalar tail
+    for (size_t offset = 0; offset < 3; ++offset) {
+      vector<money> got(n - offset);
+      batch(&values[offset], n - offset, currency(codes[c]), &got[0]);
+      size_t bad = 0;
+      for (size_t i = 0; i < got.size(); ++i) {
+        if (got[i] != scalar(values[i + offset], currency(codes[c]))) ++bad;
+      }
+      BOOST_CHECK_MESSAGE( bad == 0, name << " " << codes[c] << " " << bad );
+    }
+  }
+  vector<money> got(n);
+  batch_units(&values[0], &units[0], n, &got[0]);
+  size_t bad = 0;
+  for (size_t i = 0; i < n; ++i) {
+    if (got[i] != scalar(values[i], units[i])) ++bad;
+  }
+  BOOST_CHECK_MESSAGE( bad == 0, name << " per value currency " << bad );
+}
+
+#define CHECK_BATCH(func) \
+  check_batch(batch_##func, batch_##func, func<double>, #func)
+
+#define CHECK_BATCH_POLICY(policy) \
+  check_batch(batch_convert<rounding::policy>, \
+              batch_convert<rounding::policy>, \
+              convert<rounding::policy, double>, #policy)
+
+BOOST_AUTO_TEST_CASE( batch_matches_scalar_test )
+{
+  CHECK_BATCH(floor);
+  CHECK_BATCH(ceil);
+  CHECK_BATCH(trunc);
+  CHECK_BATCH(round);
+  CHECK_BATCH(rounde);
+  CHECK_BATCH_POLICY(half_up);
+  CHECK_BATCH_POLICY(half_down);
+  CHECK_BATCH_POLICY(half_toward_zero);
+}
+
+BOOST_AUTO_TEST_CASE( batch_examples_test )
+{
+  double values[] = { 1.005, -2.5, 0.125, 1e300, -1e300,
+                      numeric_limits<double>::quiet_NaN(), 3.0 };
+  money out[7];
+  batch_rounde(values, 7, "USD", out);
+  BOOST_CHECK_EQUAL( out[0], money(1, 0, "USD") ); // 1.005 is below 1.005
+  BOOST_CHECK_EQUAL( out[1], money(-2, -50, "USD") );
+  BOOST_CHECK_EQUAL( out[2], money(0, 12, "USD") );
+  BOOST_CHECK_EQUAL( out[3], money::pos_infinity("USD") );
+  BOOST_CHECK_EQUAL( out[4], money::neg_infinity("USD") );
+  BOOST_CHECK_EQUAL( out[5], money() );
+  BOOST_CHECK_EQUAL( out[6], money(3, 0, "USD") );
+  batch_round(values, 7, "XAU", out);
+  for (int i = 0; i < 7; ++i) BOOST_CHECK_EQUAL( out[i], money() );
+}
+
+BOOST_AUTO_TEST_CASE( batch_convert_decimal_test )
+{
+  vector<int64_t> mantissas;
+  srand(TEST_SEED);
+  for (int i = 0; i < 10000; ++i) {
+    int64_t m = int64_t(rand()) << 31 ^ rand();
+    mantissas.push_back((m >> (rand() % 62)) * (rand() % 2 ? 1 : -1));
+  }
+  mantissas.push_back(numeric_limits<int64_t>::max());
+  mantissas.push_back(numeric_limits<int64_t>::min());
+  size_t n = mantissas.size();
+  char const* codes[] = { "USD", "JPY", "KWD", "XAU" };
+  for (int c = 0; c < 4; ++c) {
+    for (int e = -22; e < 18; ++e) {
+      vector<money> got(n);
+      batch_convert_decimal<rounding::half_even>(&mantissas[0], e, n,
+                                                 codes[c], &got[0]);
+      size_t bad = 0;
+      for (size_t i = 0; i < n; ++i) {
+        money expected = convert_decimal<rounding::half_even>(mantissas[i], e,
+                                                               codes[c]);
+        if (got[i] != expected) ++bad;
+      }
+      BOOST_CHECK_MESSAGE( bad == 0, codes[c] << " 10^" << e << " " << bad );
+    }
+  }
+}
+
+#endif
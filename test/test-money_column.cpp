@@ -0,0 +1,114 @@
+#ifndef ISOMON_TEST_MONEY_COLUMN_HPP
+#define ISOMON_TEST_MONEY_COLUMN_HPP
+
+#include "money_column.hpp"
+#include "test-amounts.hpp"
+
+#include <cstdlib>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace boost;
+using namespace boost::unit_test;
+using namespace isomon;
+
+BOOST_AUTO_TEST_CASE( money_column_rows_test )
+{
+  money_column c;
+  BOOST_CHECK( c.empty() && c.uniform() );
+  c.push_back(money(1, 50, "EUR"));
+  c.push_back(money(-2, 0, "EUR"));
+  BOOST_CHECK( c.uniform() );
+  BOOST_CHECK_EQUAL( c.unit(), currency("EUR") );
+  BOOST_CHECK( c.units() == 0 );
+  BOOST_CHECK_EQUAL( c.minors()[1], -200 );
+  BOOST_CHECK_EQUAL( c[0], money(1, 50, "EUR") );
+
+  c.push_back(money(3, 0, "USD"));
+  BOOST_CHECK( !c.uniform() );
+  BOOST_CHECK_EQUAL( c.units()[0], currency("EUR") );
+  BOOST_CHECK_EQUAL( c[2], money(3, 0, "USD") );
+  c.set(2, money(0, 7, "EUR"));
+  c.compact();
+  BOOST_CHECK( c.uniform() );
+  BOOST_CHECK_EQUAL( c[2], money(0, 7, "EUR") );
+
+  vector<money> rows(c.begin(), c.end());
+  BOOST_REQUIRE_EQUAL( rows.size(), 3u );
+  BOOST_CHECK_EQUAL( rows[1], money(-2, 0, "EUR") );
+  BOOST_CHECK_EQUAL( c.end() - c.begin(), 3 );
+  BOOST_CHECK_EQUAL( *(c.begin() + 2), money(0, 7, "EUR") );
+}
+
+static void check_column_ops(vector<money> const& rows)
+{
+  money_column c(&rows[0], rows.size());
+  size_t n = rows.size();
+
+  vector<money> copied(n);
+  c.copy_to(&copied[0]);
+  BOOST_REQUIRE( copied == rows );
+
+  money total(0, 0, rows[0].unit());
+  for (size_t i = 0; i < n; ++i) total += rows[i];
+  BOOST_REQUIRE_EQUAL( c.sum(), total );
+
+  vector<double> values(n);
+  c.values(&values[0]);
+  vector<int8_t> order(n);
+  money pivot(0, 1234, "EUR");
+  c.compare(pivot, &order[0]);
+  for (size_t i = 0; i < n; ++i) {
+    double v = rows[i].value();
+    BOOST_REQUIRE( values[i] == v || (isnan(values[i]) && isnan(v)) );
+    int64_t m = rows[i].total_minors();
+    int expected = (m > 1234) - (m < 1234);
+    if (rows[i].unit() != pivot.unit()) expected = 2;
+    BOOST_REQUIRE_EQUAL( int(order[i]), expected );
+  }
+
+  int32_t factors[] = { 3, -1, 1000, 1 << 20, -(1 << 30) };
+  for (int f = 0; f < 5; ++f) {
+    money_column scaled(c);
+    scaled.scale(factors[f]);
+    for (size_t i = 0; i < n; ++i) {
+      BOOST_REQUIRE_EQUAL( scaled[i], rows[i] * factors[f] );
+    }
+  }
+
+  double xs[] = { 1.0125, -0.5, 1e300, 0.0, NAN, INFINITY };
+  for (int f = 0; f < 6; ++f) {
+    money_column scaled(c);
+    scaled.scale<rounding::half_even>(xs[f]);
+    money_column converted(c);
+    converted.convert<rounding::floor>(xs[f], "JPY");
+    for (size_t i = 0; i < n; ++i) {
+      BOOST_REQUIRE_EQUAL( scaled[i], rounde(rows[i] * xs[f]) );
+      BOOST_REQUIRE_EQUAL( converted[i],
+                           floor(rows[i].value() * xs[f], "JPY") );
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( money_column_ops_test )
+{
+  currency const eur[] = { "EUR" };
+  currency const kwd[] = { "KWD" };
+  currency const mixed[] = { "EUR", "EUR", "EUR", "EUR", "JPY" };
+  check_column_ops(test_amounts(eur, 1, 5000, false));
+  check_column_ops(test_amounts(kwd, 1, 3000, false));
+  check_column_ops(test_amounts(mixed, 5, 5000, true));
+
+  // sums reaching infinity and coming back, as in a loop of +=
+  vector<money> rows(2000, money(0, 1LL << 44, "EUR"));
+  for (size_t i = 1000; i < rows.size(); ++i) rows[i] = -rows[i];
+  check_column_ops(rows);
+
+  money_column none;
+  BOOST_CHECK_EQUAL( none.sum(), money() );
+  vector<money> xxx(3, money());
+  BOOST_CHECK_EQUAL( money_column(&xxx[0], 3).sum(), money() );
+}
+
+#endif
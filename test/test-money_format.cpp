@@ -0,0 +1,99 @@
+#ifndef ISOMON_TEST_MONEY_FORMAT_HPP
+#define ISOMON_TEST_MONEY_FORMAT_HPP
+
+#include "money_format.hpp"
+
+#include <sstream>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace boost;
+using namespace boost::unit_test;
+using namespace isomon;
+
+// moneypunct like de_DE: 1.234.567,89 USD
+struct german_punct : moneypunct<char> {
+  char do_decimal_point() const { return ','; }
+  char do_thousands_sep() const { return '.'; }
+  string do_grouping() const { return "\3"; }
+  pattern do_pos_format() const {
+    pattern p = { { value, space, symbol, none } };
+    return p;
+  }
+  pattern do_neg_format() const {
+    pattern p = { { sign, value, space, symbol } };
+    return p;
+  }
+};
+
+// moneypunct with accounting parentheses and Indian style grouping
+struct paren_punct : moneypunct<char> {
+  char do_decimal_point() const { return '.'; }
+  char do_thousands_sep() const { return ','; }
+  string do_grouping() const { return "\3\2"; }
+  string_type do_negative_sign() const { return "()"; }
+  pattern do_pos_format() const {
+    pattern p = { { symbol, sign, none, value } };
+    return p;
+  }
+  pattern do_neg_format() const {
+    pattern p = { { sign, symbol, value, none } };
+    return p;
+  }
+};
+
+BOOST_AUTO_TEST_CASE( classic_format_test )
+{
+  money_formatter f;
+  BOOST_CHECK_EQUAL( f.str(money(2, 0, "USD")), "USD 2.00" );
+  BOOST_CHECK_EQUAL( f.str(money(-2, -5, "USD")), "USD -2.05" );
+  BOOST_CHECK_EQUAL( f.str(money(1234567, 0, "JPY")), "JPY 1234567" );
+  BOOST_CHECK_EQUAL( f.str(money(0, 1, "KWD")), "KWD 0.001" );
+
+  // same output as operator<< in the classic locale
+  money m(1234, 56, "EUR");
+  stringstream ss;
+  ss.imbue(locale::classic());
+  ss << m;
+  BOOST_CHECK_EQUAL( f.str(m), ss.str() );
+}
+
+BOOST_AUTO_TEST_CASE( german_format_test )
+{
+  money_formatter f(locale(locale::classic(), new german_punct));
+  BOOST_CHECK_EQUAL( f.str(money(2, 0, "USD")), "2,00 USD" );
+  BOOST_CHECK_EQUAL( f.str(money(2, 0, "JPY")), "2 JPY" );
+  BOOST_CHECK_EQUAL( f.str(money(1234567, 89, "EUR")), "1.234.567,89 EUR" );
+  BOOST_CHECK_EQUAL( f.str(money(-123456, -7, "EUR")), "-123.456,07 EUR" );
+  BOOST_CHECK_EQUAL( f.str(money(999, 0, "EUR")), "999,00 EUR" );
+  BOOST_CHECK_EQUAL( f.str(money(1000, 0, "EUR")), "1.000,00 EUR" );
+
+  money_formatter fs(locale(locale::classic(), new german_punct),
+                     currency_symbols::common());
+  BOOST_CHECK_EQUAL( fs.str(money(5, 0, "EUR")), "5,00 \xE2\x82\xAC" );
+  BOOST_CHECK_EQUAL( fs.str(money(5, 0, "SEK")), "5,00 SEK" );
+}
+
+BOOST_AUTO_TEST_CASE( paren_format_test )
+{
+  currency_symbols syms;
+  syms.set("INR", "Rs");
+  money_formatter f(locale(locale::classic(), new paren_punct), syms);
+  BOOST_CHECK_EQUAL( f.str(money(12345678, 0, "INR")), "Rs 1,23,45,678.00" );
+  BOOST_CHECK_EQUAL( f.str(money(-1234, -56, "INR")), "(Rs 1,234.56)" );
+  BOOST_CHECK_EQUAL( f.str(money(-1, 0, "USD")), "(USD 1.00)" );
+}
+
+BOOST_AUTO_TEST_CASE( bulk_format_test )
+{
+  money_formatter f;
+  money values[] = { money(1, 0, "USD"), money(0, -3, "EUR"), money() };
+  vector<char> buf(3 * (f.max_size() + 1));
+  char * end = f.format(&buf[0], values, 3, ';');
+  BOOST_CHECK_EQUAL( string(&buf[0], end), "USD 1.00;EUR -0.03;XXX 0;" );
+
+  money big = money::neg_infinity("USD");
+  BOOST_CHECK( f.str(big).size() <= f.max_size() );
+}
+
+#endif
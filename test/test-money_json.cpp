@@ -0,0 +1,207 @@
+#ifndef ISOMON_TEST_MONEY_JSON_HPP
+#define ISOMON_TEST_MONEY_JSON_HPP
+
+#include "money_json.hpp"
+
+#include <sstream>
+#include <cstring>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace boost;
+using namespace boost::unit_test;
+using namespace isomon;
+
+static string decimal_str(money m)
+{
+  char buf[decimal_max_size];
+  return string(buf, write_decimal(buf, m));
+}
+
+static money decimal_val(char const* s, currency unit)
+{
+  money ret(0, 12345, "CHF"); // sentinel
+  char const* end = s + strlen(s);
+  if (read_decimal(s, end, unit, ret) != end) return money(0, 54321, "CHF");
+  return ret;
+}
+
+BOOST_AUTO_TEST_CASE( write_decimal_test )
+{
+  BOOST_CHECK_EQUAL( decimal_str(money(1234, 56, "USD")), "1234.56" );
+  BOOST_CHECK_EQUAL( decimal_str(money(0, -5, "USD")), "-0.05" );
+  BOOST_CHECK_EQUAL( decimal_str(money(0, 0, "EUR")), "0.00" );
+  BOOST_CHECK_EQUAL( decimal_str(money(-7, 0, "JPY")), "-7" );
+  BOOST_CHECK_EQUAL( decimal_str(money(3, 7, "KWD")), "3.007" );
+  BOOST_CHECK_EQUAL( decimal_str(money()), "0" );
+  BOOST_CHECK_EQUAL( decimal_str(money::pos_infinity("USD")),
+                     "90071992547409.91" );
+  BOOST_CHECK_EQUAL( decimal_str(money::neg_infinity("USD")),
+                     "-90071992547409.92" );
+}
+
+BOOST_AUTO_TEST_CASE( read_decimal_test )
+{
+  BOOST_CHECK_EQUAL( decimal_val("1234.56", "USD"), money(1234, 56, "USD") );
+  BOOST_CHECK_EQUAL( decimal_val("-0.05", "USD"), money(0, -5, "USD") );
+  BOOST_CHECK_EQUAL( decimal_val("+3.5", "USD"), money(3, 50, "USD") );
+  BOOST_CHECK_EQUAL( decimal_val("3.", "USD"), money(3, 0, "USD") );
+  BOOST_CHECK_EQUAL( decimal_val(".25", "USD"), money(0, 25, "USD") );
+  BOOST_CHECK_EQUAL( decimal_val("1.2300000", "USD"), money(1, 23, "USD") );
+  BOOST_CHECK_EQUAL( decimal_val("42", "JPY"), money(42, 0, "JPY") );
+  BOOST_CHECK_EQUAL( decimal_val("42.0", "JPY"), money(42, 0, "JPY") );
+  BOOST_CHECK_EQUAL( decimal_val("99999999999999999999", "USD"),
+                     money::pos_infinity("USD") );
+  BOOST_CHECK_EQUAL( decimal_val("-99999999999999999999", "USD"),
+                     money::neg_infinity("USD") );
+  // leading zeros do not count as significant digits
+  BOOST_CHECK_EQUAL( decimal_val("0000000000000000000001.00", "USD"),
+                     money(1, 0, "USD") );
+  BOOST_CHECK_EQUAL( decimal_val("-0000000000000000000000.05", "USD"),
+                     money(0, -5, "USD") );
+
+  // not exact amounts or not numbers
+  money bad(0, 54321, "CHF");
+  BOOST_CHECK_EQUAL( decimal_val("1.234", "USD"), bad );
+  BOOST_CHECK_EQUAL( decimal_val("42.5", "JPY"), bad );
+  BOOST_CHECK_EQUAL( decimal_val("", "USD"), bad );
+  BOOST_CHECK_EQUAL( decimal_val(".", "USD"), bad );
+  BOOST_CHECK_EQUAL( decimal_val("-", "USD"), bad );
+  BOOST_CHECK_EQUAL( decimal_val("1", "XXX"), bad );
+}
+
+BOOST_AUTO_TEST_CASE( decimal_round_trip_test )
+{
+  char const* codes[] = { "USD", "JPY", "KWD", "EUR" };
+  int64_t minors[] = { 0, 1, -1, 99, -100, 123456789, (1LL << 53) - 2 };
+  for (size_t c = 0; c < 4; ++c) {
+    for (size_t i = 0; i < sizeof(minors)/sizeof(minors[0]); ++i) {
+      money m(0, minors[i], codes[c]);
+      BOOST_CHECK_EQUAL( decimal_val(decimal_str(m).c_str(), codes[c]), m );
+      BOOST_CHECK_EQUAL( decimal_val(decimal_str(-m).c_str(), codes[c]), -m );
+    }
+  }
+}
+
+static string json_str(money m, json_style style)
+{
+  char buf[json_max_size];
+  return string(buf, write_json(buf, m, style));
+}
+
+static bool json_val(string const& s, money & out)
+{
+  char const* end = s.data() + s.size();
+  return read_json(s.data(), end, out) == end;
+}
+
+BOOST_AUTO_TEST_CASE( write_json_test )
+{
+  money m(1234, 56, "EUR");
+  BOOST_CHECK_EQUAL( json_str(m, json_minors),
+                     "{\"ccy\":\"EUR\",\"minors\":123456}" );
+  BOOST_CHECK_EQUAL( json_str(m, json_decimal),
+                     "{\"ccy\":\"EUR\",\"amount\":\"1234.56\"}" );
+  BOOST_CHECK_EQUAL( json_str(-m, json_minors),
+                     "{\"ccy\":\"EUR\",\"minors\":-123456}" );
+  BOOST_CHECK_EQUAL( json_str(money(), json_minors),
+                     "{\"ccy\":\"XXX\",\"minors\":0}" );
+}
+
+BOOST_AUTO_TEST_CASE( read_json_test )
+{
+  money m;
+  BOOST_CHECK( json_val("{\"ccy\":\"EUR\",\"minors\":123456}", m) );
+  BOOST_CHECK_EQUAL( m, money(1234, 56, "EUR") );
+  BOOST_CHECK( json_val(" { \"minors\" : -5 ,\n\"ccy\" : \"usd\" }", m) );
+  BOOST_CHECK_EQUAL( m, money(0, -5, "USD") );
+  BOOST_CHECK( json_val("{\"amount\":\"-7\",\"ccy\":\"JPY\"}", m) );
+  BOOST_CHECK_EQUAL( m, money(-7, 0, "JPY") );
+  BOOST_CHECK( json_val("{\"ccy\":\"XXX\",\"minors\":0}", m) );
+  BOOST_CHECK_EQUAL( m, money() );
+  BOOST_CHECK( json_val("{\"ccy\":\"EUR\",\"minors\":0000000000000000000005}",
+                        m) );
+  BOOST_CHECK_EQUAL( m, money(0, 5, "EUR") );
+
+  BOOST_CHECK( !json_val("{\"ccy\":\"EUR\"}", m) );
+  BOOST_CHECK( !json_val("{\"minors\":5}", m) );
+  BOOST_CHECK( !json_val("{\"ccy\":\"AAA\",\"minors\":5}", m) );
+  BOOST_CHECK( !json_val("{\"ccy\":\"EUR\",\"minors\":}", m) );
+  BOOST_CHECK( !json_val("{\"ccy\":\"EUR\",\"ccy\":\"EUR\"}", m) );
+  BOOST_CHECK( !json_val("{\"ccy\":\"EUR\",\"cents\":5}", m) );
+  BOOST_CHECK( !json_val("{\"ccy\":\"EUR\",\"amount\":\"1.005\"}", m) );
+  BOOST_CHECK( !json_val("{\"ccy\":\"EUR\",\"amount\":\"1.00", m) );
+}
+
+BOOST_AUTO_TEST_CASE( json_array_round_trip_test )
+{
+  vector<money> values;
+  for (int i = -500; i < 500; ++i) {
+    values.push_back(money(i, i % 100, "USD"));
+    values.push_back(money(i * 1000, 0, "JPY"));
+    values.push_back(money(0, i * 7, "KWD"));
+  }
+  json_style styles[] = { json_minors, json_decimal };
+  for (size_t s = 0; s < 2; ++s) {
+    stringstream ss;
+    {
+      json_writer w(ss, styles[s]);
+      w.write(&values[0], values.size());
+      w << money(1, 0, "GBP");
+    }
+    values.push_back(money(1, 0, "GBP"));
+    string text = ss.str();
+    json_reader r(text.data(), text.data() + text.size());
+    vector<money> got(values.size() + 1);
+    BOOST_CHECK_EQUAL( r.read(&got[0], got.size()), values.size() );
+    BOOST_CHECK( !r.fail() );
+    BOOST_CHECK( r.position() == text.data() + text.size() );
+    got.resize(values.size());
+    BOOST_CHECK( got == values );
+    values.pop_back();
+  }
+}
+
+BOOST_AUTO_TEST_CASE( json_reader_empty_and_bad_test )
+{
+  money m;
+  string empty = " [ ] ";
+  json_reader r(empty.data(), empty.data() + empty.size());
+  BOOST_CHECK( !r.next(m) );
+  BOOST_CHECK( !r.fail() );
+
+  string bad = "[{\"ccy\":\"EUR\",\"minors\":1} {\"ccy\":\"EUR\",\"minors\":2}]";
+  json_reader rb(bad.data(), bad.data() + bad.size());
+  BOOST_CHECK( rb.next(m) );
+  BOOST_CHECK( !rb.next(m) );
+  BOOST_CHECK( rb.fail() );
+}
+
+// stream buffer that takes only the first few chars written to it
+class short_buf : public streambuf
+{
+public:
+  short_buf() : room_(3) {}
+protected:
+  int overflow(int ch)
+  {
+    if (room_ == 0 || ch == traits_type::eof()) return traits_type::eof();
+    --room_;
+    return ch;
+  }
+private:
+  int room_;
+};
+
+BOOST_AUTO_TEST_CASE( json_writer_short_write_test )
+{
+  short_buf sb;
+  ostream os(&sb);
+  {
+    json_writer w(os);
+    w << money(1, 0, "EUR");
+  }
+  BOOST_CHECK( os.bad() );
+}
+
+#endif
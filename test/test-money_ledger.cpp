@@ -0,0 +1,118 @@
+#ifndef ISOMON_TEST_MONEY_LEDGER_HPP
+#define ISOMON_TEST_MONEY_LEDGER_HPP
+
+#include "money_ledger.hpp"
+#include "test-amounts.hpp"
+
+#include <cstdlib>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace boost;
+using namespace boost::unit_test;
+using namespace isomon;
+
+BOOST_AUTO_TEST_CASE( money_ledger_examples_test )
+{
+  currency const common[] = { "EUR", "USD", "EUR", "XXX" };
+  money_ledger book(1000, common, 4);
+  BOOST_CHECK_EQUAL( book.num_accounts(), 1000u );
+  BOOST_CHECK_EQUAL( book.balance(7, "EUR"), money(0, 0, "EUR") );
+  BOOST_CHECK_EQUAL( book.balance(7, "JPY"), money(0, 0, "JPY") );
+  BOOST_CHECK_EQUAL( book.balance(1000, "EUR"), money() );
+  BOOST_CHECK_EQUAL( book.balance(7, "XXX"), money() );
+
+  BOOST_CHECK( book.set_limit(7, money(-100, 0, "EUR")) );
+  BOOST_CHECK( !book.set_limit(1000, money(-100, 0, "EUR")) );
+  BOOST_CHECK( !book.set_limit(7, money()) );
+  BOOST_CHECK_EQUAL( book.post(7, money(-50, 0, "EUR")), money_ledger::posted );
+  BOOST_CHECK_EQUAL( book.post(7, money(-60, 0, "EUR")),
+                     money_ledger::over_limit );
+  BOOST_CHECK_EQUAL( book.balance(7, "EUR"), money(-50, 0, "EUR") );
+  BOOST_CHECK_EQUAL( book.post(7, money(-50, 0, "EUR")), money_ledger::posted );
+  BOOST_CHECK_EQUAL( book.post(1000, money(1, 0, "EUR")),
+                     money_ledger::no_account );
+  BOOST_CHECK_EQUAL( book.post(7, money()), money_ledger::no_currency );
+
+  // a raised limit rejects debits but not credits
+  BOOST_CHECK( book.set_limit(7, money(0, 0, "EUR")) );
+  BOOST_CHECK_EQUAL( book.post(7, money(0, -1, "EUR")),
+                     money_ledger::over_limit );
+  BOOST_CHECK_EQUAL( book.post(7, money(1, 0, "EUR")), money_ledger::posted );
+
+  // sparse currencies
+  BOOST_CHECK( book.set_limit(7, money(-5, 0, "GBP")) );
+  BOOST_CHECK_EQUAL( book.post(7, money(-6, 0, "GBP")),
+                     money_ledger::over_limit );
+  BOOST_CHECK_EQUAL( book.post(7, money(-5, 0, "GBP")), money_ledger::posted );
+  BOOST_CHECK_EQUAL( book.post(7, money(300, 0, "JPY")), money_ledger::posted );
+  BOOST_CHECK_EQUAL( book.post(8, money(2, 0, "USD")), money_ledger::posted );
+  BOOST_CHECK_EQUAL( book.post(8, money(-3, 0, "GBP")), money_ledger::posted );
+
+  // in order of ISO numeric code, JPY 392, GBP 826, EUR 978
+  vector<money> b = book.balances(7);
+  BOOST_REQUIRE_EQUAL( b.size(), 3u );
+  BOOST_CHECK_EQUAL( b[0], money(300, 0, "JPY") );
+  BOOST_CHECK_EQUAL( b[1], money(-5, 0, "GBP") );
+  BOOST_CHECK_EQUAL( b[2], money(-99, 0, "EUR") );
+  BOOST_CHECK_EQUAL( book.balances(8).size(), 2u );
+  BOOST_CHECK( book.balances(9).empty() );
+  BOOST_CHECK_EQUAL( book.total("GBP"), money(-8, 0, "GBP") );
+  BOOST_CHECK_EQUAL( book.total("EUR"), money(-99, 0, "EUR") );
+  BOOST_CHECK_EQUAL( book.total("XXX"), money() );
+
+  // a copy is a snapshot
+  money_ledger snapshot(book);
+  book.post(7, money(1, 0, "EUR"));
+  BOOST_CHECK_EQUAL( snapshot.balance(7, "EUR"), money(-99, 0, "EUR") );
+}
+
+BOOST_AUTO_TEST_CASE( money_ledger_batch_test )
+{
+  srand(TEST_SEED);
+  currency const common[] = { "EUR", "USD" };
+  char const* codes[] = { "EUR", "USD", "JPY", "GBP", "XXX" };
+  size_t const num_accounts = 500;
+  money_ledger batched(num_accounts, common, 2);
+  for (size_t a = 0; a < num_accounts; a += 3) {
+    batched.set_limit(a, money(-(rand() % 1000), 0, codes[rand() % 4]));
+  }
+  money_ledger one_by_one(batched);
+
+  vector<money_ledger::posting> postings(200000);
+  for (size_t i = 0; i < postings.size(); ++i) {
+    postings[i].account = rand() % (num_accounts + 5);
+    postings[i].amount = money(0, rand() % 20001 - 10000, codes[rand() % 5]);
+  }
+  vector<money_ledger::status> results(postings.size());
+  size_t num_posted = batched.post(&postings[0], postings.size(),
+                                   &results[0]);
+
+  size_t expected_posted = 0;
+  for (size_t i = 0; i < postings.size(); ++i) {
+    money_ledger::status s = one_by_one.post(postings[i].account,
+                                             postings[i].amount);
+    BOOST_REQUIRE_EQUAL( results[i], s );
+    expected_posted += (s == money_ledger::posted);
+  }
+  BOOST_CHECK_EQUAL( num_posted, expected_posted );
+  BOOST_CHECK( num_posted < postings.size() );
+  for (size_t a = 0; a < num_accounts; ++a) {
+    BOOST_REQUIRE( batched.balances(a) == one_by_one.balances(a) );
+  }
+
+  // posted amounts add up to the totals
+  for (size_t c = 0; c < 4; ++c) {
+    money sum(0, 0, codes[c]);
+    for (size_t i = 0; i < postings.size(); ++i) {
+      if (results[i] == money_ledger::posted
+          && postings[i].amount.unit() == currency(codes[c])) {
+        sum += postings[i].amount;
+      }
+    }
+    BOOST_CHECK_EQUAL( batched.total(codes[c]), sum );
+  }
+}
+
+#endif
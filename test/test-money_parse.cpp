@@ -0,0 +1,142 @@
+#ifndef ISOMON_TEST_MONEY_PARSE_HPP
+#define ISOMON_TEST_MONEY_PARSE_HPP
+
+#include "money_parse.hpp"
+
+#include <cstring>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace boost;
+using namespace boost::unit_test;
+using namespace isomon;
+
+static bool parse_all(money_parser const& p, char const* text, money & out)
+{
+  char const* end = text + strlen(text);
+  return p.parse(text, end, out) == end;
+}
+
+BOOST_AUTO_TEST_CASE( parse_european_test )
+{
+  money_parser p(amount_format(',', '.'));
+  money m;
+  BOOST_CHECK( parse_all(p, "1.234.567,89 EUR", m) );
+  BOOST_CHECK_EQUAL( m, money(1234567, 89, "EUR") );
+  BOOST_CHECK( parse_all(p, "-1.234,5 EUR", m) );
+  BOOST_CHECK_EQUAL( m, money(-1234, -50, "EUR") );
+  BOOST_CHECK( parse_all(p, "EUR 0,07", m) );
+  BOOST_CHECK_EQUAL( m, money(0, 7, "EUR") );
+  BOOST_CHECK( parse_all(p, "  12 jpy ", m) );
+  BOOST_CHECK_EQUAL( m, money(12, 0, "JPY") );
+
+  BOOST_CHECK( !parse_all(p, "1.234.567,89", m) ); // no currency
+  BOOST_CHECK( !parse_all(p, "1,234 EUR", m) );    // not exact
+  BOOST_CHECK( !parse_all(p, "1..234 EUR", m) );
+  BOOST_CHECK( !parse_all(p, ".234 EUR", m) );
+  BOOST_CHECK( !parse_all(p, "EUR", m) );
+  BOOST_CHECK( !parse_all(p, "12 EURO", m) );
+
+  // group marks only between groups of 3 digits
+  BOOST_CHECK( !parse_all(p, "1.5 EUR", m) );
+  BOOST_CHECK( parse_all(p, "1,5 EUR", m) );
+  BOOST_CHECK_EQUAL( m, money(1, 50, "EUR") );
+  BOOST_CHECK( !parse_all(p, "1.23.456 EUR", m) );
+  BOOST_CHECK( !parse_all(p, "1234.567 EUR", m) );
+  BOOST_CHECK( !parse_all(p, "1.2345 EUR", m) );
+  BOOST_CHECK( !parse_all(p, "1.2345,00 EUR", m) );
+  BOOST_CHECK( parse_all(p, "123.456 EUR", m) );
+  BOOST_CHECK_EQUAL( m, money(123456, 0, "EUR") );
+}
+
+BOOST_AUTO_TEST_CASE( parse_group_size_test )
+{
+  money_parser p(amount_format('.', ','));
+  money m;
+  BOOST_CHECK( !parse_all(p, "1,5 USD", m) );
+  BOOST_CHECK( parse_all(p, "1.5 USD", m) );
+  BOOST_CHECK_EQUAL( m, money(1, 50, "USD") );
+  BOOST_CHECK( !parse_all(p, "1,23,456 USD", m) );
+  BOOST_CHECK( !parse_all(p, "1,23,456.00 USD", m) );
+  BOOST_CHECK( !parse_all(p, "1,2345 USD", m) );
+  BOOST_CHECK( parse_all(p, "1,234,567.5 USD", m) );
+  BOOST_CHECK_EQUAL( m, money(1234567, 50, "USD") );
+  BOOST_CHECK( parse_all(p, "12,345 USD", m) );
+  BOOST_CHECK_EQUAL( m, money(12345, 0, "USD") );
+}
+
+BOOST_AUTO_TEST_CASE( parse_parentheses_test )
+{
+  money_parser p(amount_format('.', ','));
+  money m;
+  BOOST_CHECK( parse_all(p, "(1,234.56) USD", m) );
+  BOOST_CHECK_EQUAL( m, money(-1234, -56, "USD") );
+  BOOST_CHECK( parse_all(p, "(USD 1,234.56)", m) );
+  BOOST_CHECK_EQUAL( m, money(-1234, -56, "USD") );
+  BOOST_CHECK( parse_all(p, "1,234.56- USD", m) );
+  BOOST_CHECK_EQUAL( m, money(-1234, -56, "USD") );
+  BOOST_CHECK( parse_all(p, "USD -5", m) );
+  BOOST_CHECK_EQUAL( m, money(-5, 0, "USD") );
+  BOOST_CHECK( parse_all(p, "-USD 5", m) );
+  BOOST_CHECK_EQUAL( m, money(-5, 0, "USD") );
+
+  // overlong amounts saturate to the infinity of their sign
+  BOOST_CHECK( parse_all(p, "-99999999999999999999 USD", m) );
+  BOOST_CHECK_EQUAL( m, money::neg_infinity("USD") );
+  BOOST_CHECK( parse_all(p, "(99999999999999999999) USD", m) );
+  BOOST_CHECK_EQUAL( m, money::neg_infinity("USD") );
+  BOOST_CHECK( parse_all(p, "99999999999999999999 USD", m) );
+  BOOST_CHECK_EQUAL( m, money::pos_infinity("USD") );
+
+  BOOST_CHECK( !parse_all(p, "(1.00 USD", m) );
+  BOOST_CHECK( !parse_all(p, "(-1.00) USD", m) );
+  BOOST_CHECK( !parse_all(p, "--1.00 USD", m) );
+
+  money_parser strict(amount_format('.', ',', amount_format::parentheses,
+                                    amount_format::unit_after));
+  BOOST_CHECK( parse_all(strict, "(1.00) GBP", m) );
+  BOOST_CHECK_EQUAL( m, money(-1, 0, "GBP") );
+  BOOST_CHECK( !parse_all(strict, "-1.00 GBP", m) );
+  BOOST_CHECK( !parse_all(strict, "GBP 1.00", m) );
+}
+
+BOOST_AUTO_TEST_CASE( parse_default_and_symbols_test )
+{
+  money_parser p(amount_format('.', '\'', amount_format::minus_before,
+                               amount_format::unit_none), "CHF");
+  money m;
+  BOOST_CHECK( parse_all(p, "1'000'000.05", m) );
+  BOOST_CHECK_EQUAL( m, money(1000000, 5, "CHF") );
+  BOOST_CHECK( !parse_all(p, "1.00 CHF", m) );
+
+  money_parser ps(amount_format(',', ' '), currency_symbols::common());
+  BOOST_CHECK( parse_all(ps, "1 234,50 \xE2\x82\xAC", m) );
+  BOOST_CHECK_EQUAL( m, money(1234, 50, "EUR") );
+  BOOST_CHECK( parse_all(ps, "-$3", m) );
+  BOOST_CHECK_EQUAL( m, money(-3, 0, "USD") );
+  BOOST_CHECK( parse_all(ps, "\xC2\xA3 2,5", m) );
+  BOOST_CHECK_EQUAL( m, money(2, 50, "GBP") );
+}
+
+BOOST_AUTO_TEST_CASE( parse_bulk_test )
+{
+  money_parser p(amount_format(',', '.'));
+  string text = "1.234,56 EUR;(2,00) USD; 3 JPY;-0,5 GBP";
+  money out[8];
+  char const* stop;
+  size_t n = p.parse(text.data(), text.data() + text.size(), ';',
+                     out, 8, &stop);
+  BOOST_CHECK_EQUAL( n, 4u );
+  BOOST_CHECK( stop == text.data() + text.size() );
+  BOOST_CHECK_EQUAL( out[0], money(1234, 56, "EUR") );
+  BOOST_CHECK_EQUAL( out[1], money(-2, 0, "USD") );
+  BOOST_CHECK_EQUAL( out[2], money(3, 0, "JPY") );
+  BOOST_CHECK_EQUAL( out[3], money(0, -50, "GBP") );
+
+  string bad = "1,00 EUR;oops;2,00 EUR";
+  n = p.parse(bad.data(), bad.data() + bad.size(), ';', out, 8, &stop);
+  BOOST_CHECK_EQUAL( n, 1u );
+  BOOST_CHECK( stop == bad.data() + 9 );
+}
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef ISOMON_TEST_MONEY_SKETCH_HPP
+#define ISOMON_TEST_MONEY_SKETCH_HPP
+
+#include "money_sketch.hpp"
+#include "test-amounts.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace boost;
+using namespace boost::unit_test;
+using namespace isomon;
+
+BOOST_AUTO_TEST_CASE( money_sketch_examples_test )
+{
+  money_sketch<> sizes;
+  BOOST_CHECK_EQUAL( money_sketch<>::num_buckets, 47u * 128 + 1 );
+  for (int i = 1; i <= 100; ++i) sizes.insert(money(0, -i, "EUR"));
+  sizes.insert(money());
+  sizes.insert(money(1000, 0, "USD"));
+  BOOST_CHECK_EQUAL( sizes.count("EUR"), 100u );
+  BOOST_CHECK_EQUAL( sizes.count("USD"), 1u );
+  BOOST_CHECK_EQUAL( sizes.count("JPY"), 0u );
+
+  // magnitudes below 128 are exact
+  BOOST_CHECK_EQUAL( sizes.quantile("EUR", 0), money(0, 1, "EUR") );
+  BOOST_CHECK_EQUAL( sizes.quantile("EUR", 0.5), money(0, 50, "EUR") );
+  BOOST_CHECK_EQUAL( sizes.quantile("EUR", 0.99), money(0, 99, "EUR") );
+  BOOST_CHECK_EQUAL( sizes.quantile("EUR", 1), money(0, 100, "EUR") );
+  BOOST_CHECK_EQUAL( sizes.quantile("USD", 0.5), money(1000, 0, "USD") );
+  BOOST_CHECK_EQUAL( sizes.quantile("JPY", 0.5), money() );
+  BOOST_CHECK_EQUAL( sizes.quantile("EUR", 1.5), money() );
+  BOOST_CHECK_EQUAL( sizes.quantile("EUR", NAN), money() );
+
+  vector<pair<money, uint64_t> > h = sizes.histogram("EUR");
+  BOOST_REQUIRE_EQUAL( h.size(), 100u );
+  BOOST_CHECK_EQUAL( h[0].first, money(0, 1, "EUR") );
+  BOOST_CHECK_EQUAL( h[0].second, 1u );
+
+  // above 128, buckets 1/128 as wide as their lower bound
+  money_sketch<> big;
+  big.insert(money(0, 1000, "EUR"));
+  big.insert(money(0, 1003, "EUR"));
+  big.insert(money(0, 1009, "EUR"));
+  h = big.histogram("EUR");
+  BOOST_REQUIRE_EQUAL( h.size(), 2u );
+  BOOST_CHECK_EQUAL( h[0].first, money(0, 1000, "EUR") );
+  BOOST_CHECK_EQUAL( h[0].second, 2u );
+  BOOST_CHECK_EQUAL( h[1].first, money(0, 1008, "EUR") );
+  BOOST_CHECK_EQUAL( big.quantile("EUR", 0.5), money(0, 1002, "EUR") );
+
+  big.insert(money::neg_infinity("EUR"));
+  BOOST_CHECK_EQUAL( big.quantile("EUR", 1), money::pos_infinity("EUR") );
+
+  big.merge(sizes);
+  BOOST_CHECK_EQUAL( big.count("EUR"), 104u );
+  BOOST_CHECK_EQUAL( big.count("USD"), 1u );
+  big.clear();
+  BOOST_CHECK_EQUAL( big.count("EUR"), 0u );
+}
+
+template <int _Bits>
+static void check_quantiles(vector<money> const& amounts, currency unit)
+{
+  money_sketch<_Bits> whole, parts[3];
+  whole.insert(&amounts[0], amounts.size());
+  for (size_t i = 0; i < amounts.size(); ++i) parts[i % 3].insert(amounts[i]);
+  money_sketch<_Bits> merged;
+  for (int p = 0; p < 3; ++p) merged.merge(parts[p]);
+
+  vector<int64_t> exact;
+  for (size_t i = 0; i < amounts.size(); ++i) {
+    if (amounts[i].unit() == unit) {
+      exact.push_back(llabs(amounts[i].total_minors()));
+    }
+  }
+  sort(exact.begin(), exact.end());
+  BOOST_REQUIRE_EQUAL( whole.count(unit), exact.size() );
+  double const bound = ldexp(1.0, -(_Bits + 1));
+  double const qs[] = { 0, 0.001, 0.1, 0.5, 0.9, 0.99, 0.999, 1 };
+  for (size_t k = 0; k < sizeof(qs) / sizeof(qs[0]); ++k) {
+    int64_t x = exact[size_t(qs[k] * (exact.size() - 1))];
+    money q = whole.quantile(unit, qs[k]);
+    BOOST_CHECK_EQUAL( q, merged.quantile(unit, qs[k]) );
+    BOOST_CHECK_EQUAL( q.unit(), unit );
+    BOOST_CHECK_LE( fabs(double(q.total_minors() - x)), bound * x );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( money_sketch_random_test )
+{
+  srand(TEST_SEED);
+  char const* codes[] = { "EUR", "USD", "JPY", "XXX" };
+  vector<money> amounts;
+  for (int i = 0; i < 30000; ++i) {
+    // sizes spread over many orders of magnitude
+    int64_t minors = int64_t(exp(rand() / (RAND_MAX + 1.0) * 30));
+    if (rand() % 2) minors = -minors;
+    amounts.push_back(money(0, minors, codes[rand() % 4]));
+  }
+  for (int c = 0; c < 3; ++c) {
+    check_quantiles<7>(amounts, codes[c]);
+    check_quantiles<3>(amounts, codes[c]);
+    check_quantiles<10>(amounts, codes[c]);
+  }
+}
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef ISOMON_TEST_MONEY_WIRE_HPP
+#define ISOMON_TEST_MONEY_WIRE_HPP
+
+#include "money_wire.hpp"
+#include "test-amounts.hpp"
+
+#include <vector>
+#include <cstdlib>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace boost;
+using namespace boost::unit_test;
+using namespace isomon;
+
+static vector<money> wire_round_trip(vector<money> const& values,
+                                     size_t * encoded_size = 0)
+{
+  vector<uint8_t> buf(wire_max_size(values.size()));
+  size_t n = wire_encode(values.empty() ? 0 : &values[0], values.size(),
+                         &buf[0]);
+  BOOST_CHECK( n <= buf.size() );
+  if (encoded_size) *encoded_size = n;
+  size_t count = 12345;
+  BOOST_CHECK( wire_count(&buf[0], n, &count) );
+  BOOST_CHECK_EQUAL( count, values.size() );
+  vector<money> got(count + 1);
+  BOOST_CHECK( wire_decode(&buf[0], n, &got[0]) );
+  got.resize(count);
+  return got;
+}
+
+BOOST_AUTO_TEST_CASE( zigzag_test )
+{
+  int64_t vals[] = { 0, 1, -1, 63, -64, 64, (1LL << 53) - 1, -(1LL << 53),
+                     numeric_limits<int64_t>::max(),
+                     numeric_limits<int64_t>::min() };
+  for (size_t i = 0; i < sizeof(vals)/sizeof(vals[0]); ++i) {
+    BOOST_CHECK_EQUAL( isomon::detail::unzigzag(isomon::detail::zigzag(vals[i])),
+                       vals[i] );
+  }
+  BOOST_CHECK_EQUAL( isomon::detail::zigzag(-1), 1u );
+  BOOST_CHECK_EQUAL( isomon::detail::zigzag(1), 2u );
+  BOOST_CHECK_EQUAL( isomon::detail::byte_length(0), 1u );
+  BOOST_CHECK_EQUAL( isomon::detail::byte_length(255), 1u );
+  BOOST_CHECK_EQUAL( isomon::detail::byte_length(256), 2u );
+  BOOST_CHECK_EQUAL( isomon::detail::byte_length(~0ULL), 8u );
+}
+
+BOOST_AUTO_TEST_CASE( wire_single_currency_test )
+{
+  vector<money> values;
+  for (int i = -300; i < 300; ++i) values.push_back(money(0, i, "USD"));
+  values.push_back(money::pos_infinity("USD"));
+  values.push_back(money::neg_infinity("USD"));
+  size_t size;
+  BOOST_CHECK( wire_round_trip(values, &size) == values );
+  // no per value currency bytes: 1 or 2 data bytes plus half a nibble byte
+  BOOST_CHECK( 2 * size < 5 * values.size() + 64 );
+}
+
+BOOST_AUTO_TEST_CASE( wire_multi_currency_test )
+{
+  char const* codes[] = { "USD", "EUR", "JPY", "KWD", "XXX" };
+  vector<money> values;
+  srand(TEST_SEED);
+  for (int i = 0; i < 1001; ++i) {
+    int64_t minors = (int64_t(rand()) << 31 | rand()) >> (rand() % 60);
+    values.push_back(money(0, (i % 2) ? minors : -minors, codes[i % 5]));
+  }
+  BOOST_CHECK( wire_round_trip(values) == values );
+  values.resize(3);
+  BOOST_CHECK( wire_round_trip(values) == values );
+  values.clear();
+  BOOST_CHECK( wire_round_trip(values) == values );
+}
+
+BOOST_AUTO_TEST_CASE( wire_large_dictionary_test )
+{
+  vector<money> values;
+  for (int16_t num = 0; num < 1000; ++num) {
+    currency c(num);
+    if (c.isonum() == num && c.num_minors() > 0) {
+      values.push_back(money(0, num, c));
+      values.push_back(money(0, -num, c));
+    }
+  }
+  BOOST_CHECK( wire_round_trip(values) == values );
+}
+
+BOOST_AUTO_TEST_CASE( wire_added_currencies_test )
+{
+  // currencies added with fake codes so that more than 256 are in use,
+  // for 2 byte indexes into the dictionary, numbered down from the top
+  // except 1000, which test-currency checks is not a currency
+  char code[4] = "QAA";
+  size_t num_added = 0;
+  for (int16_t num = ISOMON_ISONUM_COUNT - 1; num_added < 120; --num) {
+    if (data::is_isonum(num) || num == 1000) continue;
+    while (code[1] <= 'Z' && !data::add_currency(num, code)) {
+      if (++code[2] > 'Z') { code[2] = 'A'; ++code[1]; }
+    }
+    BOOST_REQUIRE( data::set_num_minors(num, 100, 2) );
+    ++num_added;
+  }
+  vector<money> values;
+  for (int16_t num = 0; num < ISOMON_ISONUM_COUNT; ++num) {
+    currency c(num);
+    if (c.isonum() == num && c.num_minors() > 0) {
+      values.push_back(money(0, num, c));
+      values.push_back(money(0, -num, c));
+    }
+  }
+  BOOST_REQUIRE_GT( values.size() / 2, 256u );
+  vector<uint8_t> buf(wire_max_size(values.size()));
+  size_t n = wire_encode(&values[0], values.size(), &buf[0]);
+  BOOST_CHECK_LE( n, buf.size() );
+  BOOST_CHECK( wire_round_trip(values) == values );
+}
+
+BOOST_AUTO_TEST_CASE( wire_bad_input_test )
+{
+  vector<money> values(10, money(0, 1234567, "EUR"));
+  vector<uint8_t> buf(wire_max_size(values.size()));
+  size_t n = wire_encode(&values[0], values.size(), &buf[0]);
+  vector<money> got(values.size());
+  for (size_t cut = 0; cut < n; ++cut) {
+    BOOST_CHECK( !wire_decode(&buf[0], cut, &got[0]) );
+  }
+  BOOST_CHECK( !wire_decode(&buf[0], n + 1, &got[0]) );
+  BOOST_CHECK( wire_decode(&buf[0], n, &got[0]) );
+}
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef ISOMON_TEST_SHARDED_MONEY_HPP
+#define ISOMON_TEST_SHARDED_MONEY_HPP
+
+#include "sharded_money.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace boost;
+using namespace boost::unit_test;
+using namespace isomon;
+
+BOOST_AUTO_TEST_CASE( sharded_money_basic_test )
+{
+  sharded_money s(3);
+  BOOST_CHECK_EQUAL( s.num_shards(), 4u );
+  BOOST_CHECK( sharded_money().num_shards() >= 1 );
+  BOOST_CHECK_EQUAL( s.read("EUR"), money(0, 0, "EUR") );
+  BOOST_CHECK( s.read_all().empty() );
+
+  s.add(money(1, 50, "EUR"));
+  s.add(money(0, -25, "EUR"));
+  s.add(money(7, 0, "JPY"));
+  s.add(money());
+  BOOST_CHECK_EQUAL( s.read("EUR"), money(1, 25, "EUR") );
+  BOOST_CHECK_EQUAL( s.read("JPY"), money(7, 0, "JPY") );
+  BOOST_CHECK_EQUAL( s.read("USD"), money(0, 0, "USD") );
+  BOOST_CHECK_EQUAL( s.read("XXX"), money() );
+  BOOST_CHECK_EQUAL( s.read("XAU"), money() );
+  vector<money> all = s.read_all();
+  BOOST_REQUIRE_EQUAL( all.size(), 2u );
+  BOOST_CHECK_EQUAL( all[0], money(7, 0, "JPY") );  // 392
+  BOOST_CHECK_EQUAL( all[1], money(1, 25, "EUR") ); // 978
+
+  s.add(money::pos_infinity("EUR"));
+  BOOST_CHECK_EQUAL( s.read("EUR"), money::pos_infinity("EUR") );
+  s.reset();
+  BOOST_CHECK( s.read_all().empty() );
+}
+
+// a currency added after the sharded_money was made, at a free number
+// from the top except 1000, which test-currency checks is not a currency
+BOOST_AUTO_TEST_CASE( sharded_money_added_currency_test )
+{
+  sharded_money s(2);
+  s.add(money(1, 0, "EUR"));
+  int16_t num = ISOMON_ISONUM_COUNT - 1;
+  while (data::is_isonum(num) || num == 1000) --num;
+  char code[4] = "QZZ";
+  while (!data::add_currency(num, code)) --code[2];
+  BOOST_REQUIRE( data::set_num_minors(num, 100, 2) );
+  currency added(num);
+  BOOST_REQUIRE_EQUAL( added.isonum(), num );
+  BOOST_CHECK_EQUAL( s.read(added), money(0, 0, added) );
+  s.add(money(2, 50, added));
+  s.add(money(0, -25, added));
+  BOOST_CHECK_EQUAL( s.read(added), money(2, 25, added) );
+  BOOST_CHECK_EQUAL( s.read("EUR"), money(1, 0, "EUR") );
+  vector<money> all = s.read_all();
+  BOOST_REQUIRE_EQUAL( all.size(), 2u );
+  BOOST_CHECK( find(all.begin(), all.end(), money(2, 25, added))
+               != all.end() );
+  s.reset();
+  BOOST_CHECK( s.read_all().empty() );
+}
+
+static void add_fees(sharded_money * s, int seed, int times)
+{
+  char const* codes[] = { "EUR", "USD", "JPY" };
+  for (int i = 0; i < times; ++i) {
+    s->add(money(0, (seed + i) % 100 - 40, codes[(seed + i) % 3]));
+  }
+}
+
+// more threads than shards, so some share one
+BOOST_AUTO_TEST_CASE( sharded_money_threads_test )
+{
+  sharded_money s(4);
+  int const num_threads = 10;
+  int const times = 30000;
+  vector<thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.push_back(thread(add_fees, &s, t, times));
+  }
+  for (size_t t = 0; t < threads.size(); ++t) threads[t].join();
+
+  char const* codes[] = { "EUR", "USD", "JPY" };
+  int64_t sums[3] = { 0, 0, 0 };
+  for (int t = 0; t < num_threads; ++t) {
+    for (int i = 0; i < times; ++i) sums[(t + i) % 3] += (t + i) % 100 - 40;
+  }
+  for (int c = 0; c < 3; ++c) {
+    BOOST_CHECK_EQUAL( s.read(codes[c]), money(0, sums[c], codes[c]) );
+  }
+}
+
+#endif
@@ -0,0 +1,385 @@
+#ifndef ISOMON_BENCH_HPP
+#define ISOMON_BENCH_HPP
+
+/** @file bench.hpp
+    @brief Small micro-benchmark harness for the timing programs
+*/
+
+#include <stdint.h>
+#include <time.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+/// Make the compiler assume value is used so computing it is not removed
+template <class T>
+inline void keep(T const& value)
+{
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/// Make the compiler assume all memory may have been read and written
+inline void clobber()
+{
+  asm volatile("" : : : "memory");
+}
+
+/// Monotonic clock in nanoseconds
+inline double now_ns()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/// Hardware performance counters of the calling thread, via perf_event_open.
+/** Each counter is opened on its own so that those the kernel or hardware
+    does support still work when others do not, as in most containers and
+    virtual machines. Counts are scaled if the kernel had to multiplex.
+*/
+class perf_counters
+{
+public:
+  enum event {
+    cycles, instructions, branch_misses, l1d_misses, llc_misses, num_events
+  };
+
+  perf_counters();
+  ~perf_counters();
+
+  /// Name of counter like "branch-misses"
+  static char const* name(int e);
+
+  bool available(int e) const { return fd_[e] >= 0; }
+  bool any_available() const;
+
+  /// Reset and start counting
+  void start();
+
+  /// Stop counting and add counts since start to totals
+  void stop(double * totals) const;
+
+private:
+  perf_counters(perf_counters const&);
+  void operator = (perf_counters const&);
+
+  int fd_[num_events];
+};
+
+/// Benchmark body performing the operation iterations times
+typedef void (*kernel)(size_t iterations);
+
+/// Check that a kernel computes what it should, false if it does not
+typedef bool (*check)();
+
+/// Statistics of one benchmark, in nanoseconds per operation
+struct result
+{
+  std::string name;
+  size_t iterations;   ///< operations per sample
+  size_t samples;
+  double mean;
+  double stddev;
+  double min;
+  double median;
+  int checked;         ///< 1 if check passed, 0 if it failed, -1 if none
+  double per_op[perf_counters::num_events]; ///< NaN if not counted
+};
+
+/// Runs kernels and reports ns/op with variance, as text or JSON.
+/** Each kernel is first run with doubling iteration counts until one call
+    takes at least the minimum sample time, which doubles as a warm-up.
+    Then that many iterations are timed repeatedly with a monotonic clock.
+    A check given with the kernel is run once after the timing, and any
+    failed check is reported and makes finish() return 1.
+    Command line options:
+    - --json            print JSON instead of a table
+    - --filter=TEXT     run only benchmarks with TEXT in their name
+    - --samples=N       number of timed samples (default 15)
+    - --min-ms=X        minimum milliseconds per sample (default 10)
+    - --perf            also count cycles, instructions, branch misses and
+                        L1 data and last level cache misses with
+                        perf_event_open, reported per operation with IPC
+*/
+class runner
+{
+public:
+  runner(int argc, char * argv[]);
+  ~runner();
+
+  /// Time kernel k and run check c unless filtered out
+  void run(char const* name, kernel k, check c = 0);
+
+  /// Print all results, returns exit status for main
+  int finish() const;
+
+  std::vector<result> const& results() const { return results_; }
+
+private:
+  static double time_ns(kernel k, size_t iterations);
+  void print_text() const;
+  void print_json() const;
+
+  runner(runner const&);
+  void operator = (runner const&);
+
+  bool json_;
+  perf_counters * perf_;
+  std::string filter_;
+  size_t samples_;
+  double min_ns_;
+  std::vector<result> results_;
+};
+
+/////////////////////////////////////////////////////////////////////
+
+#ifdef __linux__
+
+inline perf_counters::perf_counters()
+{
+  static const uint64_t configs[num_events][2] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+                          | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                          | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES }
+  };
+  for (int e = 0; e < num_events; ++e) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = configs[e][0];
+    attr.config = configs[e][1];
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+                       | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    fd_[e] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+}
+
+inline perf_counters::~perf_counters()
+{
+  for (int e = 0; e < num_events; ++e) {
+    if (fd_[e] >= 0) close(fd_[e]);
+  }
+}
+
+inline void perf_counters::start()
+{
+  for (int e = 0; e < num_events; ++e) {
+    if (fd_[e] >= 0) ioctl(fd_[e], PERF_EVENT_IOC_RESET, 0);
+  }
+  for (int e = 0; e < num_events; ++e) {
+    if (fd_[e] >= 0) ioctl(fd_[e], PERF_EVENT_IOC_ENABLE, 0);
+  }
+}
+
+inline void perf_counters::stop(double * totals) const
+{
+  for (int e = 0; e < num_events; ++e) {
+    if (fd_[e] >= 0) ioctl(fd_[e], PERF_EVENT_IOC_DISABLE, 0);
+  }
+  for (int e = 0; e < num_events; ++e) {
+    uint64_t buf[3]; // value, time enabled, time running
+    if (fd_[e] < 0) continue;
+    if (read(fd_[e], buf, sizeof(buf)) != sizeof(buf)) continue;
+    if (buf[2] > 0) totals[e] += double(buf[0]) * buf[1] / buf[2];
+  }
+}
+
+#else // no perf_event_open, counters are never available
+
+inline perf_counters::perf_counters()
+{
+  for (int e = 0; e < num_events; ++e) fd_[e] = -1;
+}
+
+inline perf_counters::~perf_counters() {}
+inline void perf_counters::start() {}
+inline void perf_counters::stop(double *) const {}
+
+#endif
+
+inline char const* perf_counters::name(int e)
+{
+  static char const* const names[num_events] = {
+    "cycles", "instructions", "branch-misses", "L1d-misses", "LLC-misses"
+  };
+  return names[e];
+}
+
+inline bool perf_counters::any_available() const
+{
+  for (int e = 0; e < num_events; ++e) {
+    if (available(e)) return true;
+  }
+  return false;
+}
+
+inline runner::runner(int argc, char * argv[])
+  : json_(false), perf_(0), samples_(15), min_ns_(10e6)
+{
+  for (int i = 1; i < argc; ++i) {
+    char const* arg = argv[i];
+    if (std::strcmp(arg, "--json") == 0) {
+      json_ = true;
+    } else if (std::strcmp(arg, "--perf") == 0) {
+      if (!perf_) perf_ = new perf_counters;
+    } else if (std::strncmp(arg, "--filter=", 9) == 0) {
+      filter_ = arg + 9;
+    } else if (std::strncmp(arg, "--samples=", 10) == 0) {
+      samples_ = std::max(2, std::atoi(arg + 10));
+    } else if (std::strncmp(arg, "--min-ms=", 9) == 0) {
+      min_ns_ = std::atof(arg + 9) * 1e6;
+    } else {
+      std::fprintf(stderr, "usage: %s [--json] [--filter=TEXT] "
+                   "[--samples=N] [--min-ms=X] [--perf]\n", argv[0]);
+      std::exit(2);
+    }
+  }
+  if (perf_ && !perf_->any_available()) {
+    std::fprintf(stderr, "perf_event_open counters not available, "
+                 "reporting timings only\n");
+    delete perf_;
+    perf_ = 0;
+  }
+}
+
+inline runner::~runner()
+{
+  delete perf_;
+}
+
+inline double runner::time_ns(kernel k, size_t iterations)
+{
+  double t0 = now_ns();
+  k(iterations);
+  clobber();
+  return now_ns() - t0;
+}
+
+inline void runner::run(char const* name, kernel k, check c)
+{
+  if (!filter_.empty() && !std::strstr(name, filter_.c_str())) return;
+  size_t iterations = 1;
+  while (time_ns(k, iterations) < min_ns_ && iterations < (size_t(1) << 40)) {
+    iterations *= 2;
+  }
+  std::vector<double> ns(samples_);
+  double counts[perf_counters::num_events] = { 0 };
+  for (size_t s = 0; s < samples_; ++s) {
+    if (perf_) perf_->start();
+    ns[s] = time_ns(k, iterations) / iterations;
+    if (perf_) perf_->stop(counts);
+  }
+  result r;
+  for (int e = 0; e < perf_counters::num_events; ++e) {
+    bool counted = perf_ && perf_->available(e);
+    r.per_op[e] = counted ? counts[e] / (double(iterations) * samples_) : NAN;
+  }
+  r.name = name;
+  r.iterations = iterations;
+  r.samples = samples_;
+  r.mean = 0;
+  for (size_t s = 0; s < samples_; ++s) r.mean += ns[s];
+  r.mean /= samples_;
+  double var = 0;
+  for (size_t s = 0; s < samples_; ++s) {
+    var += (ns[s] - r.mean) * (ns[s] - r.mean);
+  }
+  r.stddev = std::sqrt(var / (samples_ - 1));
+  std::sort(ns.begin(), ns.end());
+  r.min = ns[0];
+  r.median = (ns[(samples_ - 1) / 2] + ns[samples_ / 2]) / 2;
+  r.checked = c ? int(c()) : -1;
+  if (r.checked == 0) std::fprintf(stderr, "\n%s: WRONG RESULT\n", name);
+  results_.push_back(r);
+  if (!json_) std::fprintf(stderr, ".");
+}
+
+inline int runner::finish() const
+{
+  if (json_) {
+    print_json();
+  } else {
+    std::fprintf(stderr, "\n");
+    print_text();
+  }
+  for (size_t i = 0; i < results_.size(); ++i) {
+    if (results_[i].checked == 0) return 1;
+  }
+  return 0;
+}
+
+inline void runner::print_text() const
+{
+  std::printf("%-28s %10s %10s %8s %10s %12s %6s", "benchmark", "ns/op",
+              "median", "+/-%", "min", "iterations", "result");
+  if (perf_) {
+    std::printf(" %6s %10s %12s %12s", "IPC", "cycles/op", "br-miss/op",
+                "L1d-miss/op");
+    std::printf(" %12s", "LLC-miss/op");
+  }
+  std::printf("\n");
+  for (size_t i = 0; i < results_.size(); ++i) {
+    result const& r = results_[i];
+    std::printf("%-28s %10.2f %10.2f %8.2f %10.2f %12lu %6s", r.name.c_str(),
+                r.mean, r.median, 100 * r.stddev / r.mean, r.min,
+                (unsigned long)r.iterations,
+                r.checked < 0 ? "-" : (r.checked ? "Equal" : "WRONG"));
+    if (perf_) {
+      std::printf(" %6.2f %10.2f %12.4f %12.4f %12.4f",
+                  r.per_op[perf_counters::instructions]
+                  / r.per_op[perf_counters::cycles],
+                  r.per_op[perf_counters::cycles],
+                  r.per_op[perf_counters::branch_misses],
+                  r.per_op[perf_counters::l1d_misses],
+                  r.per_op[perf_counters::llc_misses]);
+    }
+    std::printf("\n");
+  }
+}
+
+inline void runner::print_json() const
+{
+  std::printf("{\n  \"unit\": \"ns/op\",\n  \"benchmarks\": [");
+  for (size_t i = 0; i < results_.size(); ++i) {
+    result const& r = results_[i];
+    std::printf("%s\n    {\"name\": \"%s\", \"iterations\": %lu, "
+                "\"samples\": %lu, \"mean\": %.4f, \"stddev\": %.4f, "
+                "\"min\": %.4f, \"median\": %.4f",
+                (i ? "," : ""), r.name.c_str(), (unsigned long)r.iterations,
+                (unsigned long)r.samples, r.mean, r.stddev, r.min, r.median);
+    if (r.checked >= 0) {
+      std::printf(", \"check\": %s", r.checked ? "true" : "false");
+    }
+    for (int e = 0; perf_ && e < perf_counters::num_events; ++e) {
+      if (std::isnan(r.per_op[e])) continue; // counter not available
+      std::printf(", \"%s_per_op\": %.4f", perf_counters::name(e),
+                  r.per_op[e]);
+    }
+    std::printf("}");
+  }
+  std::printf("\n  ]\n}\n");
+}
+
+} // namespace bench
+
+#endif
@@ -0,0 +1,98 @@
+#include "bench.hpp"
+
+#include "money_accrue.hpp"
+
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+using namespace isomon;
+
+// A year of daily interest on many accounts, as in the money_interest case
+// of time-isomon but over the whole book. The money loop is the one accrue
+// replaces, m += trunc(m * rate) account by account, and is timed on one
+// thread only. Balances from accrue are checked against it.
+
+currency const eur("EUR");
+
+vector<money> start;
+vector<double> rates;
+vector<fixed_decimal<10> > fixed_rates;
+vector<money> expected;
+
+void money_loop(money * b, size_t n, int days)
+{
+  for (size_t i = 0; i < n; ++i) {
+    for (int d = 0; d < days; ++d) b[i] += trunc(b[i] * rates[i]);
+  }
+}
+
+// ns per account and day of run(balances, count, days, threads) with each
+// number of threads, best of reps runs, balances checked if expected is set
+template <class _Run>
+void row(char const* name, _Run run, vector<int> const& counts, int days,
+         int reps)
+{
+  bool correct = true;
+  cout << setw(26) << left << name << right;
+  vector<money> b;
+  for (size_t i = 0; i < counts.size(); ++i) {
+    double best = 1e300;
+    for (int r = 0; r < reps; ++r) {
+      b = start;
+      double t0 = bench::now_ns();
+      run(&b[0], b.size(), days, counts[i]);
+      best = min(best, (bench::now_ns() - t0) / (double(b.size()) * days));
+      if (!expected.empty() && b != expected) correct = false;
+    }
+    cout << setw(10) << best;
+  }
+  cout << (correct ? "" : "  WRONG BALANCES") << endl;
+  if (expected.empty()) expected = b;
+}
+
+int main(int argc, char* argv[])
+{
+  // default 10 million accounts for 365 days, up to all hardware threads
+  size_t count = (argc > 1 ? atof(argv[1]) : 10) * 1e6;
+  int days = (argc > 2 ? atoi(argv[2]) : 365);
+  int reps = (argc > 3 ? atoi(argv[3]) : 1);
+  int max_threads = (argc > 4 ? atoi(argv[4])
+                              : max(1u, thread::hardware_concurrency()));
+
+  vector<int> counts;
+  for (int t = 1; t < max_threads; t *= 2) counts.push_back(t);
+  counts.push_back(max_threads);
+
+  srand(12345);
+  for (size_t i = 0; i < count; ++i) {
+    start.push_back(money(rand() % 1000000, rand() % 100, eur));
+    rates.push_back((rand() % 500) * 1e-4 / 365);
+  }
+  fixed_rates.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    fixed_rates[i].mantissa = (rand() % 500) * 10000000LL / 365;
+  }
+
+  cout << count << " accounts, " << days << " days, best of " << reps
+       << " runs, ns per account and day" << endl;
+  cout << fixed << setprecision(2) << setw(26) << left << "threads" << right;
+  for (size_t i = 0; i < counts.size(); ++i) cout << setw(10) << counts[i];
+  cout << endl;
+
+  vector<int> one(1, 1);
+  row("money += trunc(m * rate)",
+      [](money * b, size_t n, int d, int) { money_loop(b, n, d); },
+      one, days, reps);
+  row("accrue<trunc>, rates[i]",
+      [](money * b, size_t n, int d, int t) {
+        accrue<rounding::trunc>(b, n, &rates[0], d, t);
+      }, counts, days, reps);
+  expected.clear(); // other rounding
+  row("accrue<half_even>, fixed",
+      [](money * b, size_t n, int d, int t) {
+        accrue<rounding::half_even>(b, n, &fixed_rates[0], d, t);
+      }, counts, days, reps);
+  return 0;
+}
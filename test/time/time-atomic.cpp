@@ -0,0 +1,155 @@
+#include "bench.hpp"
+
+#include "sharded_money.hpp"
+
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+using namespace isomon;
+
+// Threads all posting into one shared balance, so every add contends for
+// the same cache line, except with sharded_money. Each way of adding is
+// timed with 1, 2, 4, ... up to the number of hardware threads, and the
+// final balance is checked.
+
+currency const eur("EUR");
+int64_t const small = 123;             // far from infinity
+int64_t const large = 1LL << 40;       // nearer, checked the same way
+
+struct shared_int64
+{
+  static char const* name() { return "atomic<int64_t>"; }
+  std::atomic<int64_t> balance;
+  int64_t amounts[2];
+  void reset(int64_t amount) {
+    balance.store(0);
+    amounts[0] = amount;
+    amounts[1] = -amount;
+  }
+  void add(int sign) { balance.fetch_add(amounts[sign]); }
+  int64_t minors() const { return balance.load(); }
+};
+
+struct shared_money_mutex
+{
+  static char const* name() { return "mutex money"; }
+  std::mutex lock;
+  money balance;
+  money amounts[2];
+  void reset(int64_t amount) {
+    balance = money(0, 0, eur);
+    amounts[0] = money(0, amount, eur);
+    amounts[1] = -amounts[0];
+  }
+  void add(int sign) {
+    std::lock_guard<std::mutex> guard(lock);
+    balance += amounts[sign];
+  }
+  int64_t minors() const { return balance.total_minors(); }
+};
+
+struct shared_atomic_money
+{
+  static char const* name() { return "atomic_money"; }
+  atomic_money balance;
+  money amounts[2];
+  void reset(int64_t amount) {
+    balance.store(money(0, 0, eur));
+    amounts[0] = money(0, amount, eur);
+    amounts[1] = -amounts[0];
+  }
+  void add(int sign) { balance.fetch_add(amounts[sign]); }
+  int64_t minors() const { return balance.load().total_minors(); }
+};
+
+struct shared_sharded_money
+{
+  static char const* name() { return "sharded_money"; }
+  sharded_money balance;
+  money amounts[2];
+  void reset(int64_t amount) {
+    balance.reset();
+    amounts[0] = money(0, amount, eur);
+    amounts[1] = -amounts[0];
+  }
+  void add(int sign) { balance.add(amounts[sign]); }
+  int64_t minors() const { return balance.read(eur).total_minors(); }
+};
+
+std::atomic<int> ready;
+std::atomic<bool> go;
+
+// adds +amount and -amount alternately, so the balance stays small
+template <class S>
+void post(S * s, size_t count)
+{
+  ready.fetch_add(1);
+  while (!go.load()) {}
+  for (size_t i = 0; i < count; ++i) s->add(i % 2);
+}
+
+// ns per add of all threads together, best of reps runs
+template <class S>
+double run(S & s, int threads, int64_t amount, size_t count, int reps,
+           bool & correct)
+{
+  double best = 1e300;
+  for (int r = 0; r < reps; ++r) {
+    s.reset(amount);
+    ready.store(0);
+    go.store(false);
+    vector<thread> pool;
+    for (int t = 0; t < threads; ++t) {
+      pool.push_back(thread(post<S>, &s, count));
+    }
+    while (ready.load() < threads) {}
+    double t0 = bench::now_ns();
+    go.store(true);
+    for (int t = 0; t < threads; ++t) pool[t].join();
+    best = min(best, (bench::now_ns() - t0) / (double(count) * threads));
+    int64_t expected = (count % 2 ? amount * threads : 0);
+    if (s.minors() != expected) correct = false;
+  }
+  return best;
+}
+
+template <class S>
+void row(int64_t amount, char const* label, vector<int> const& counts,
+         size_t count, int reps)
+{
+  static S s;
+  bool correct = true;
+  cout << setw(16) << left << S::name() << setw(6) << label << right;
+  for (size_t i = 0; i < counts.size(); ++i) {
+    cout << setw(10) << run(s, counts[i], amount, count, reps, correct);
+  }
+  cout << (correct ? "" : "  WRONG BALANCE") << endl;
+}
+
+int main(int argc, char* argv[])
+{
+  // default 1 million adds per thread, up to one thread per hardware thread
+  size_t count = (argc > 1 ? atof(argv[1]) : 1) * 1e6;
+  int reps = (argc > 2 ? atoi(argv[2]) : 3);
+  int max_threads = (argc > 3 ? atoi(argv[3])
+                              : max(1u, thread::hardware_concurrency()));
+
+  vector<int> counts;
+  for (int t = 1; t < max_threads; t *= 2) counts.push_back(t);
+  counts.push_back(max_threads);
+
+  cout << count << " adds per thread, best of " << reps << " runs,"
+       << " ns per add of all threads together" << endl;
+  cout << fixed << setprecision(2) << setw(22) << left << "threads" << right;
+  for (size_t i = 0; i < counts.size(); ++i) cout << setw(10) << counts[i];
+  cout << endl;
+  row<shared_int64>(small, "small", counts, count, reps);
+  row<shared_atomic_money>(small, "small", counts, count, reps);
+  row<shared_atomic_money>(large, "large", counts, count, reps);
+  row<shared_money_mutex>(small, "small", counts, count, reps);
+  row<shared_sharded_money>(small, "small", counts, count, reps);
+  return 0;
+}
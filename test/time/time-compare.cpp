@@ -0,0 +1,215 @@
+#include "bench.hpp"
+
+#include "money.hpp"
+#include "money_calc.hpp"
+
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+using namespace isomon;
+
+// The same workloads run over arrays of each representation of EUR
+// amounts: int64_t minors, double majors, money and money_calc<double>.
+// Every result is turned back into int64_t minors and compared with the
+// int64_t result, so a faster representation can not hide a wrong answer.
+
+currency const eur("EUR");
+currency const jpy("JPY");
+double const monthly = 1 + 0.05 / 12;  // 5% a year, compounded monthly
+double const eur_jpy = 161.37;
+
+struct rep_int64
+{
+  typedef int64_t value_type;
+  static char const* name() { return "int64_t"; }
+  static value_type make(int64_t minors) { return minors; }
+  static int64_t minors(value_type x) { return x; }
+  static value_type zero() { return 0; }
+  static void add(value_type & s, value_type x) { s += x; }
+  static value_type grow(value_type x) { return llrounde(x * monthly); }
+  static int64_t fx(value_type x) {
+    return std::llround(x / 100.0 * eur_jpy);
+  }
+  static bool less(value_type a, value_type b) { return a < b; }
+};
+
+struct rep_double
+{
+  typedef double value_type;
+  static char const* name() { return "double"; }
+  static value_type make(int64_t minors) { return minors / 100.0; }
+  static int64_t minors(value_type x) { return std::llround(x * 100); }
+  static value_type zero() { return 0; }
+  static void add(value_type & s, value_type x) { s += x; }
+  static value_type grow(value_type x) {
+    return std::nearbyint(x * monthly * 100) / 100;
+  }
+  static int64_t fx(value_type x) { return std::llround(x * eur_jpy); }
+  static bool less(value_type a, value_type b) { return a < b; }
+};
+
+struct rep_money
+{
+  typedef money value_type;
+  static char const* name() { return "money"; }
+  static value_type make(int64_t minors) { return money(0, minors, eur); }
+  static int64_t minors(value_type x) { return x.total_minors(); }
+  static value_type zero() { return money(0, 0, eur); }
+  static void add(value_type & s, value_type x) { s += x; }
+  static value_type grow(value_type x) { return rounde(x * monthly); }
+  static int64_t fx(value_type x) {
+    return round(x.value() * eur_jpy, jpy).total_minors();
+  }
+  static bool less(value_type a, value_type b) {
+    return a.total_minors() < b.total_minors();
+  }
+};
+
+struct rep_calc
+{
+  typedef money_calc<double> value_type;
+  static char const* name() { return "money_calc"; }
+  static value_type make(int64_t minors) { return money(0, minors, eur); }
+  static int64_t minors(value_type x) { return std::llround(x.minors); }
+  static value_type zero() { return money(0, 0, eur); }
+  static void add(value_type & s, value_type const& x) { s += x; }
+  static value_type grow(value_type const& x) { return rounde(x * monthly); }
+  static int64_t fx(value_type const& x) {
+    money_calc<double> converted(x.value() * eur_jpy, jpy);
+    return round(converted).total_minors();
+  }
+  static bool less(value_type const& a, value_type const& b) { return a < b; }
+};
+
+// Each workload reads input and writes the minors of its answer to out.
+
+template <class R>
+void ledger_sum(vector<typename R::value_type> const& in,
+                vector<int64_t> & out)
+{
+  typename R::value_type s = R::zero();
+  for (size_t i = 0; i < in.size(); ++i) R::add(s, in[i]);
+  out.assign(1, R::minors(s));
+}
+
+template <class R>
+void compound_interest(vector<typename R::value_type> const& in,
+                       vector<int64_t> & out)
+{
+  for (size_t i = 0; i < in.size(); ++i) {
+    typename R::value_type x = in[i];
+    for (int month = 0; month < 12; ++month) x = R::grow(x);
+    out[i] = R::minors(x);
+  }
+}
+
+template <class R>
+void fx_convert(vector<typename R::value_type> const& in,
+                vector<int64_t> & out)
+{
+  for (size_t i = 0; i < in.size(); ++i) out[i] = R::fx(in[i]);
+}
+
+template <class R>
+void sort_amounts(vector<typename R::value_type> const& in,
+                  vector<int64_t> & out)
+{
+  static vector<typename R::value_type> work;
+  work = in;                  // copying is timed too, same for every type
+  sort(work.begin(), work.end(), R::less);
+  for (size_t i = 0; i < work.size(); ++i) out[i] = R::minors(work[i]);
+}
+
+struct timing
+{
+  double ns_per_value;
+  size_t num_differ;
+};
+
+// best of reps runs, then compare answer with reference if there is one
+template <class R>
+timing run(void (*workload)(vector<typename R::value_type> const&,
+                            vector<int64_t> &),
+           vector<typename R::value_type> const& in, int reps,
+           vector<int64_t> & answer, vector<int64_t> const* reference)
+{
+  answer.assign(in.size(), 0);
+  double best = 1e300;
+  for (int r = 0; r < reps; ++r) {
+    double t0 = bench::now_ns();
+    workload(in, answer);
+    bench::clobber();
+    best = min(best, bench::now_ns() - t0);
+  }
+  timing ret = { best / in.size(), 0 };
+  if (reference) {
+    for (size_t i = 0; i < answer.size(); ++i) {
+      if (answer[i] != (*reference)[i]) ++ret.num_differ;
+    }
+  }
+  return ret;
+}
+
+struct inputs
+{
+  vector<int64_t> as_int64;
+  vector<double> as_double;
+  vector<money> as_money;
+  vector<money_calc<double> > as_calc;
+};
+
+void print_cell(timing t)
+{
+  cout << setw(10) << t.ns_per_value;
+  if (t.num_differ) {
+    cout << " !=" << setw(8) << left << t.num_differ << right;
+  } else {
+    cout << "           ";
+  }
+}
+
+#define COMPARE(workload) \
+  { \
+    vector<int64_t> ref, got; \
+    cout << setw(20) << left << #workload << right; \
+    print_cell(run<rep_int64>(workload<rep_int64>, in.as_int64, reps, \
+                              ref, 0)); \
+    print_cell(run<rep_double>(workload<rep_double>, in.as_double, reps, \
+                               got, &ref)); \
+    print_cell(run<rep_money>(workload<rep_money>, in.as_money, reps, \
+                              got, &ref)); \
+    print_cell(run<rep_calc>(workload<rep_calc>, in.as_calc, reps, \
+                             got, &ref)); \
+    cout << endl; \
+  }
+
+int main(int argc, char* argv[])
+{
+  // default 16 million values, 128 MB per 8 byte array, beyond most caches
+  size_t count = (argc > 1 ? atof(argv[1]) : 16) * 1e6;
+  int reps = (argc > 2 ? atoi(argv[2]) : 3);
+
+  inputs in;
+  srand(2718);
+  for (size_t i = 0; i < count; ++i) {
+    int64_t minors = int64_t(rand() % 2000000) - 1000000; // +/- 10000 EUR
+    in.as_int64.push_back(rep_int64::make(minors));
+    in.as_double.push_back(rep_double::make(minors));
+    in.as_money.push_back(rep_money::make(minors));
+    in.as_calc.push_back(rep_calc::make(minors));
+  }
+
+  cout << count << " values, best of " << reps << " runs, ns per value"
+       << " (!= N: N answers differ from int64_t)" << endl;
+  cout << fixed << setprecision(2) << setw(20) << left << "workload" << right;
+  cout << setw(10) << rep_int64::name() << "           "
+       << setw(10) << rep_double::name() << "           "
+       << setw(10) << rep_money::name() << "           "
+       << setw(10) << rep_calc::name() << endl;
+  COMPARE(ledger_sum);
+  COMPARE(compound_interest);
+  COMPARE(fx_convert);
+  COMPARE(sort_amounts);
+  return 0;
+}
@@ -0,0 +1,132 @@
+#include "bench.hpp"
+
+#include "money.hpp"
+
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <unordered_set>
+
+using namespace std;
+using namespace isomon;
+
+// Hashing of money as found in trades and ledgers: mostly one or two
+// currencies, amounts of whole cents, whole units and round numbers, and
+// many repeats. Each hasher is timed inserting into and finding in an
+// unordered_set, and its spread is measured by the bucket lengths of that
+// set and the probe lengths of a linear probing table indexed by the low
+// bits, as open addressing tables sized by powers of 2 are.
+
+// what people write when there is no std::hash<money>
+struct minors_xor_currency
+{
+  static char const* name() { return "minors ^ isonum"; }
+  size_t operator () (money m) const {
+    return std::hash<int64_t>()(m.total_minors()) ^ m.unit().isonum();
+  }
+};
+
+// the packed bits as they are, minors << 10 | ISO numeric
+struct packed_bits
+{
+  static char const* name() { return "packed bits"; }
+  size_t operator () (money m) const {
+    int64_t bits;
+    memcpy(&bits, &m, sizeof bits);
+    return std::hash<int64_t>()(bits);
+  }
+};
+
+struct std_hash
+{
+  static char const* name() { return "std::hash<money>"; }
+  size_t operator () (money m) const { return std::hash<money>()(m); }
+};
+
+vector<money> make_amounts(size_t n)
+{
+  vector<money> v;
+  srand(12345);
+  for (size_t i = 0; i < n; ++i) {
+    int kind = rand() % 10;
+    int64_t r = rand() % 100000;
+    if (kind < 4) v.push_back(money(0, r, "EUR"));                 // prices
+    else if (kind < 6) v.push_back(money(r % 10000, 0, "EUR"));    // whole
+    else if (kind < 8) v.push_back(money(r % 1000 * 5, 0, "USD")); // round
+    else if (kind < 9) v.push_back(money(r * 100, 0, "JPY"));
+    else v.push_back(money(0, -r, "GBP"));                         // refunds
+  }
+  return v;
+}
+
+// average and longest probe of a linear probing table of 2^k slots at most
+// half full, for finding every distinct amount
+template <class H>
+void probe_lengths(vector<money> const& distinct, double & mean, size_t & most)
+{
+  size_t size = 1;
+  while (size < 2 * distinct.size()) size *= 2;
+  vector<bool> used(size);
+  size_t total = 0;
+  most = 0;
+  for (size_t i = 0; i < distinct.size(); ++i) {
+    size_t probes = 1;
+    size_t s = H()(distinct[i]) & (size - 1);
+    while (used[s]) { s = (s + 1) & (size - 1); ++probes; }
+    used[s] = true;
+    total += probes;
+    most = max(most, probes);
+  }
+  mean = double(total) / distinct.size();
+}
+
+template <class H>
+void row(vector<money> const& amounts, vector<money> const& distinct)
+{
+  unordered_set<money, H> set;
+  double t0 = bench::now_ns();
+  for (size_t i = 0; i < amounts.size(); ++i) set.insert(amounts[i]);
+  double t1 = bench::now_ns();
+  size_t found = 0;
+  for (size_t i = 0; i < amounts.size(); ++i) found += set.count(amounts[i]);
+  double t2 = bench::now_ns();
+  bench::keep(found);
+
+  size_t nonempty = 0, longest = 0;
+  for (size_t b = 0; b < set.bucket_count(); ++b) {
+    size_t len = set.bucket_size(b);
+    nonempty += (len > 0);
+    longest = max(longest, len);
+  }
+  double mean_probe;
+  size_t most_probes;
+  probe_lengths<H>(distinct, mean_probe, most_probes);
+
+  cout << setw(18) << left << H::name() << right
+       << setw(10) << (t1 - t0) / amounts.size()
+       << setw(10) << (t2 - t1) / amounts.size()
+       << setw(8) << set.load_factor()
+       << setw(8) << double(set.size()) / nonempty
+       << setw(8) << longest
+       << setw(10) << mean_probe
+       << setw(8) << most_probes << endl;
+}
+
+int main(int argc, char* argv[])
+{
+  // default 1 million amounts
+  size_t count = (argc > 1 ? atof(argv[1]) : 1) * 1e6;
+  vector<money> amounts = make_amounts(count);
+  unordered_set<money> unique(amounts.begin(), amounts.end());
+  vector<money> distinct(unique.begin(), unique.end());
+
+  cout << count << " amounts, " << distinct.size() << " distinct" << endl;
+  cout << fixed << setprecision(2) << setw(18) << left << "hash" << right
+       << setw(10) << "insert ns" << setw(10) << "find ns"
+       << setw(8) << "load" << setw(8) << "chain" << setw(8) << "max"
+       << setw(10) << "probes" << setw(8) << "max" << endl;
+  row<minors_xor_currency>(amounts, distinct);
+  row<packed_bits>(amounts, distinct);
+  row<std_hash>(amounts, distinct);
+  return 0;
+}
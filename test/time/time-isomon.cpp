@@ -1,109 +1,1138 @@
+#include "bench.hpp"
+
 #include "money.hpp"
 #include "money_calc.hpp"
+#include "money_text.hpp"
+#include "money_format.hpp"
+#include "money_parse.hpp"
+#include "money_batch.hpp"
+#include "money_column.hpp"
+#include "money_allocate.hpp"
+#include "money_accrue.hpp"
+#include "fee_schedule.hpp"
+#include "money_aggregate.hpp"
 
-#include <tr1/ctime>
-#include <tr1/cmath>
-#include <cstdlib>
+#include <cstdio>
 #include <iostream>
-#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
 
 using namespace std;
 using namespace isomon;
+using bench::keep;
+using bench::kernel;
+
+// Inputs are read from arrays filled at run time so the compiler can not
+// fold them, and cycle through a power of 2 entries that stay in L1 cache.
+
+const size_t N = 1024;
+const size_t MASK = N - 1;
+
+char const* codes[N];
+isonum_t isonums[N];
+currency units[N];
+int64_t majors[N];
+int64_t minors[N];
+int32_t factors[N];
+double reals[N];
+int64_t mantissas[N];     // of 10^-3 major units
+money values[N];          // all EUR
+money mixed[N];           // in units
+money_column column;      // values as a column
+money_calc<double> calcs[N];
+char decimals[N][decimal_max_size];
+size_t decimal_sizes[N];
+char texts[N][32];
+size_t text_sizes[N];
 
-template<class Quant, class Test>
-void clockit(long rep, Quant tot, Quant final, Test t, char const* name)
+currency const eur("EUR");
+money const fee_t1(1000, 0, "EUR");
+money const fee_t2(5000, 0, "EUR");
+money const fee_min(2, 50, "EUR");
+fee_schedule<4> tax;
+money_formatter const* formatter;
+money_parser const* parser;
+
+void init_inputs()
 {
-  clock_t t0 = clock();
-  for (long i=0; i < rep/10; ++i) {
-    tot = t.calc(tot);
-    tot = t.calc(tot);
-    tot = t.calc(tot);
-    tot = t.calc(tot);
-    tot = t.calc(tot);
-    tot = t.calc(tot);
-    tot = t.calc(tot);
-    tot = t.calc(tot);
-    tot = t.calc(tot);
-    tot = t.calc(tot);
+  vector<isonum_t> all;
+  for (int16_t i = 0; i < int16_t(ISOMON_ISONUM_COUNT); ++i) {
+    if (data::is_isonum(i) && data::num_minors(i) > 0) all.push_back(i);
+  }
+  srand(12345);
+  for (size_t i = 0; i < N; ++i) {
+    isonums[i] = all[rand() % all.size()];
+    codes[i] = data::isonum2code(isonums[i]);
+    units[i] = isonums[i];
+    majors[i] = rand() % 2000000 - 1000000;
+    minors[i] = rand() % 100;
+    factors[i] = rand() % 200 - 100;
+    reals[i] = (rand() - RAND_MAX / 2) / 1000.0;
+    mantissas[i] = rand() - RAND_MAX / 2;
+    values[i] = money(majors[i], minors[i], "EUR");
+    mixed[i] = money(majors[i], minors[i], units[i]);
+    calcs[i] = money_calc<double>(values[i]);
+    decimal_sizes[i] = write_decimal(decimals[i], values[i]) - decimals[i];
+    text_sizes[i] = formatter->format(texts[i], values[i]) - texts[i];
   }
-  clock_t diff = clock() - t0;
+  column = money_column(values, N);
+  fee_schedule<4>::rate_type ten = { 1000 }, twenty = { 2000 };
+  tax.add_bracket(fee_t1, ten);
+  tax.add_bracket(fee_t2, twenty);
+  tax.set_minimum(fee_min);
+}
+
+// Each check runs its kernel for CHECK_N operations, a multiple of N and
+// of 10, and compares the result the kernel leaves in one of the *_out
+// variables with the same operations done plainly, printing both if they
+// differ.
+
+size_t const CHECK_N = 10 * N;
+size_t const LAST = (CHECK_N - 1) & MASK;
+
+currency unit_out;
+isonum_t isonum_out;
+char const* code_out;
+money money_out;
+double double_out;
+int64_t int_out;
+string text_out;
+
+template <class T>
+bool same(T const& got, T const& want)
+{
+  if (got == want) return true;
+  cerr << got << " != " << want << endl;
+  return false;
+}
 
-  double denom = double(rep)*double(CLOCKS_PER_SEC)/1e9;
-  cout << diff/denom << "ns | " << name << " | ";
-  if (t.equal(tot, final)) {
-    cout << "Equal" << endl;
-  } else {
-    cout << tot << " != " << final << endl;
+money eur_minors(int64_t minors)
+{
+  return money(0, minors, eur);
+}
+
+// num / den rounded half to even
+int64_t div_half_even(int64_t num, int64_t den)
+{
+  int64_t q = num / den;
+  int64_t r2 = 2 * (num % den < 0 ? -(num % den) : num % den);
+  if (r2 > den || (r2 == den && q % 2 != 0)) q += (num < 0 ? -1 : 1);
+  return q;
+}
+
+// like "-1234.56", for EUR
+string plain_decimal(int64_t minors)
+{
+  char buf[32];
+  unsigned long long mag = (minors < 0 ? -minors : minors);
+  snprintf(buf, sizeof(buf), "%s%llu.%02llu", (minors < 0 ? "-" : ""),
+           mag / 100, mag % 100);
+  return buf;
+}
+
+// currency and ISO code lookups
+
+void currency_from_code(size_t n)
+{
+  currency c;
+  for (size_t i = 0; i < n; ++i) {
+    c = currency(codes[i & MASK]);
+    keep(c);
   }
+  unit_out = c;
 }
 
-#define CLOCKIT(rep, tot, end, func) clockit(rep, tot, end, func, #func)
+bool check_currency_from_code()
+{
+  currency_from_code(CHECK_N);
+  return same(string(unit_out.c_str()), string(codes[LAST]));
+}
 
-struct test_double {
-  bool equal(double x, double y) {
-    return round(x) == round(y);
+void lookup_code2isonum(size_t n)
+{
+  isonum_t num = 0;
+  for (size_t i = 0; i < n; ++i) {
+    num = 0;
+    keep(data::code2isonum(codes[i & MASK], &num));
+    keep(num);
   }
-};
+  isonum_out = num;
+}
+
+bool check_code2isonum()
+{
+  lookup_code2isonum(CHECK_N);
+  return same(string(data::isonum2code(isonum_out)), string(codes[LAST]));
+}
 
-struct test_money {
-  bool equal(money x, money y) {
-    return x == y;
+void lookup_isonum2code(size_t n)
+{
+  char const* code = 0;
+  for (size_t i = 0; i < n; ++i) {
+    code = data::isonum2code(isonums[i & MASK]);
+    keep(code);
   }
-};
+  code_out = code;
+}
 
-struct increment_double : test_double {
-  double calc(double d) { return d + 0.01; }
-};
+bool check_isonum2code()
+{
+  lookup_isonum2code(CHECK_N);
+  isonum_t num = 0;
+  return data::code2isonum(code_out, &num) && same(num, isonums[LAST]);
+}
 
-struct increment_money : test_money {
-  money calc(money m) { return nextafter(m); }
-};
+// money arithmetic
+
+void money_construct(size_t n)
+{
+  money m;
+  for (size_t i = 0; i < n; ++i) {
+    size_t j = i & MASK;
+    m = money(majors[j], minors[j], units[j]);
+    keep(m);
+  }
+  money_out = m;
+}
 
-struct interest_double : test_double {
-  double interest;
-  interest_double(double d) : interest(d) {}
+bool check_construct()
+{
+  money_construct(CHECK_N);
+  int64_t want = majors[LAST] * units[LAST].num_minors() + minors[LAST];
+  return same(money_out, money(0, want, units[LAST]));
+}
+
+void money_add(size_t n)
+{
+  money total(0, 0, eur);
+  for (size_t i = 0; i < n; ++i) total += values[i & MASK];
+  keep(total);
+  money_out = total;
+}
 
-  double calc(double d) {
-    double minors = round(d * 100);
-    return d + tr1::trunc(minors * interest)/100.0;
+int64_t sum_of_values(size_t n)
+{
+  int64_t sum = 0;
+  for (size_t i = 0; i < n; ++i) sum += values[i & MASK].total_minors();
+  return sum;
+}
+
+bool check_add()
+{
+  money_add(CHECK_N);
+  return same(money_out, eur_minors(sum_of_values(CHECK_N)));
+}
+
+void money_sub(size_t n)
+{
+  money total(0, 0, eur);
+  for (size_t i = 0; i < n; ++i) total -= values[i & MASK];
+  keep(total);
+  money_out = total;
+}
+
+bool check_sub()
+{
+  money_sub(CHECK_N);
+  return same(money_out, eur_minors(-sum_of_values(CHECK_N)));
+}
+
+void money_mul(size_t n)
+{
+  money m;
+  for (size_t i = 0; i < n; ++i) {
+    m = values[i & MASK] * factors[(i + 1) & MASK];
+    keep(m);
   }
-};
+  money_out = m;
+}
+
+bool check_mul()
+{
+  money_mul(CHECK_N);
+  int64_t want = values[LAST].total_minors() * factors[(LAST + 1) & MASK];
+  return same(money_out, eur_minors(want));
+}
+
+void money_value(size_t n)
+{
+  double x = 0;
+  for (size_t i = 0; i < n; ++i) {
+    x = values[i & MASK].value();
+    keep(x);
+  }
+  double_out = x;
+}
+
+bool check_value()
+{
+  money_value(CHECK_N);
+  return same(double_out, values[LAST].total_minors() / 100.0);
+}
+
+void money_increment(size_t n)
+{
+  money m(0, 0, eur);
+  for (size_t i = 0; i < n; ++i) m = nextafter(m);
+  keep(m);
+  money_out = m;
+}
+
+bool check_increment()
+{
+  money_increment(CHECK_N);
+  return same(money_out, eur_minors(CHECK_N));
+}
+
+double const daily_rate = 0.0005 / 365.0;
+
+void money_interest(size_t n)
+{
+  money m(10000, 0, "EUR");
+  for (size_t i = 0; i < n; ++i) m += trunc(m * daily_rate);
+  keep(m);
+  money_out = m;
+}
+
+// minors plus their interest for a day, truncated to a minor
+int64_t plus_interest(int64_t minors)
+{
+  return minors + int64_t(std::trunc(minors * daily_rate));
+}
+
+bool check_interest()
+{
+  money_interest(CHECK_N);
+  int64_t want = 1000000;
+  for (size_t i = 0; i < CHECK_N; ++i) want = plus_interest(want);
+  return same(money_out, eur_minors(want));
+}
+
+// days of interest on N accounts, timed per account and day
+money accounts[N];
+
+void accrue_interest(size_t n)
+{
+  copy(values, values + N, accounts);
+  accrue<rounding::trunc>(accounts, N, daily_rate, int(max(N, n) / N));
+  keep(accounts[0]);
+}
+
+bool check_accrue()
+{
+  accrue_interest(CHECK_N);
+  for (size_t i = 0; i < N; ++i) {
+    int64_t want = values[i].total_minors();
+    for (size_t day = 0; day < CHECK_N / N; ++day) want = plus_interest(want);
+    if (!same(accounts[i], eur_minors(want))) return false;
+  }
+  return true;
+}
+
+// conversion from double
+
+void convert_floor(size_t n)
+{
+  money m;
+  for (size_t i = 0; i < n; ++i) {
+    m = isomon::floor(reals[i & MASK], eur);
+    keep(m);
+  }
+  money_out = m;
+}
+
+void convert_ceil(size_t n)
+{
+  money m;
+  for (size_t i = 0; i < n; ++i) {
+    m = isomon::ceil(reals[i & MASK], eur);
+    keep(m);
+  }
+  money_out = m;
+}
+
+void convert_trunc(size_t n)
+{
+  money m;
+  for (size_t i = 0; i < n; ++i) {
+    m = isomon::trunc(reals[i & MASK], eur);
+    keep(m);
+  }
+  money_out = m;
+}
+
+void convert_round(size_t n)
+{
+  money m;
+  for (size_t i = 0; i < n; ++i) {
+    m = isomon::round(reals[i & MASK], eur);
+    keep(m);
+  }
+  money_out = m;
+}
+
+void convert_rounde(size_t n)
+{
+  money m;
+  for (size_t i = 0; i < n; ++i) {
+    m = isomon::rounde(reals[i & MASK], eur);
+    keep(m);
+  }
+  money_out = m;
+}
+
+void round_llrounde(size_t n)
+{
+  int64_t x = 0;
+  for (size_t i = 0; i < n; ++i) {
+    x = llrounde(reals[i & MASK] * 100);
+    keep(x);
+  }
+  int_out = x;
+}
+
+void convert_half_up(size_t n)
+{
+  money m;
+  for (size_t i = 0; i < n; ++i) {
+    m = convert<rounding::half_up>(reals[i & MASK], eur);
+    keep(m);
+  }
+  money_out = m;
+}
+
+void convert_half_toward_zero(size_t n)
+{
+  money m;
+  for (size_t i = 0; i < n; ++i) {
+    m = convert<rounding::half_toward_zero>(reals[i & MASK], eur);
+    keep(m);
+  }
+  money_out = m;
+}
+
+void convert_decimal_half_even(size_t n)
+{
+  money m;
+  for (size_t i = 0; i < n; ++i) {
+    m = convert_decimal<rounding::half_even>(mantissas[i & MASK], -3, eur);
+    keep(m);
+  }
+  money_out = m;
+}
+
+// rounding of minors with libm, for checks
+double ref_floor(double x) { return std::floor(x); }
+double ref_ceil(double x) { return std::ceil(x); }
+double ref_trunc(double x) { return std::trunc(x); }
+double ref_round(double x) { return std::round(x); }
+double ref_rounde(double x) { return std::nearbyint(x); }
+double ref_half_up(double x) { return std::floor(x + 0.5); }
+double ref_half_toward_zero(double x)
+{
+  return x < 0 ? std::floor(x + 0.5) : std::ceil(x - 0.5);
+}
+
+typedef double (*rounder)(double);
+
+// kernel k leaves in money_out the last real converted to EUR
+bool check_convert(kernel k, rounder round_minors)
+{
+  k(CHECK_N);
+  return same(money_out, eur_minors(round_minors(reals[LAST] * 100)));
+}
+
+bool check_floor() { return check_convert(convert_floor, ref_floor); }
+bool check_ceil() { return check_convert(convert_ceil, ref_ceil); }
+bool check_trunc() { return check_convert(convert_trunc, ref_trunc); }
+bool check_round() { return check_convert(convert_round, ref_round); }
+bool check_rounde() { return check_convert(convert_rounde, ref_rounde); }
+
+bool check_half_up()
+{
+  return check_convert(convert_half_up, ref_half_up);
+}
+
+bool check_half_toward_zero()
+{
+  return check_convert(convert_half_toward_zero, ref_half_toward_zero);
+}
+
+bool check_llrounde()
+{
+  round_llrounde(CHECK_N);
+  return same(int_out, int64_t(std::nearbyint(reals[LAST] * 100)));
+}
+
+bool check_convert_decimal()
+{
+  convert_decimal_half_even(CHECK_N);
+  return same(money_out, eur_minors(div_half_even(mantissas[LAST], 10)));
+}
+
+// batches of N conversions from double
+
+money batch_out[N];
+
+void batch_convert_floor(size_t n)
+{
+  for (size_t i = 0; i < n; i += N) {
+    batch_floor(reals, min(N, n - i), eur, batch_out);
+    keep(batch_out[0]);
+  }
+}
+
+void batch_convert_round(size_t n)
+{
+  for (size_t i = 0; i < n; i += N) {
+    batch_round(reals, min(N, n - i), eur, batch_out);
+    keep(batch_out[0]);
+  }
+}
+
+void batch_convert_rounde(size_t n)
+{
+  for (size_t i = 0; i < n; i += N) {
+    batch_rounde(reals, min(N, n - i), eur, batch_out);
+    keep(batch_out[0]);
+  }
+}
+
+void batch_convert_half_up(size_t n)
+{
+  for (size_t i = 0; i < n; i += N) {
+    batch_convert<rounding::half_up>(reals, min(N, n - i), eur, batch_out);
+    keep(batch_out[0]);
+  }
+}
+
+void batch_convert_decimal_half_even(size_t n)
+{
+  for (size_t i = 0; i < n; i += N) {
+    batch_convert_decimal<rounding::half_even>(mantissas, -3, min(N, n - i),
+                                               eur, batch_out);
+    keep(batch_out[0]);
+  }
+}
+
+void batch_convert_rounde_units(size_t n)
+{
+  for (size_t i = 0; i < n; i += N) {
+    batch_rounde(reals, units, min(N, n - i), batch_out);
+    keep(batch_out[0]);
+  }
+}
+
+// kernel k leaves in batch_out all reals converted to EUR, or to units
+bool check_batch(kernel k, rounder round_minors, bool in_units = false)
+{
+  k(CHECK_N);
+  for (size_t i = 0; i < N; ++i) {
+    currency unit = (in_units ? units[i] : eur);
+    double x = reals[i] * unit.num_minors();
+    if (!same(batch_out[i], money(0, int64_t(round_minors(x)), unit))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool check_batch_floor()
+{
+  return check_batch(batch_convert_floor, ref_floor);
+}
+
+bool check_batch_round()
+{
+  return check_batch(batch_convert_round, ref_round);
+}
+
+bool check_batch_rounde()
+{
+  return check_batch(batch_convert_rounde, ref_rounde);
+}
 
-struct interest_money : test_money {
-  double interest;
-  interest_money(double d) : interest(d) {}
+bool check_batch_half_up()
+{
+  return check_batch(batch_convert_half_up, ref_half_up);
+}
 
-  money calc(money m) {
-    m += trunc(m * interest);
-    return m;
+bool check_batch_rounde_units()
+{
+  return check_batch(batch_convert_rounde_units, ref_rounde, true);
+}
+
+bool check_batch_convert_decimal()
+{
+  batch_convert_decimal_half_even(CHECK_N);
+  for (size_t i = 0; i < N; ++i) {
+    if (!same(batch_out[i], eur_minors(div_half_even(mantissas[i], 10)))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// money_column against loops over arrays of money, N rows at a time
+
+void array_sum(size_t n)
+{
+  money total;
+  for (size_t i = 0; i < n; i += N) {
+    total = money(0, 0, eur);
+    for (size_t j = 0; j < N; ++j) total += values[j];
+    keep(total);
+  }
+  money_out = total;
+}
+
+void column_sum(size_t n)
+{
+  money total;
+  for (size_t i = 0; i < n; i += N) {
+    total = column.sum();
+    keep(total);
+  }
+  money_out = total;
+}
+
+bool check_array_sum()
+{
+  array_sum(CHECK_N);
+  return same(money_out, eur_minors(sum_of_values(N)));
+}
+
+bool check_column_sum()
+{
+  column_sum(CHECK_N);
+  return same(money_out, eur_minors(sum_of_values(N)));
+}
+
+void array_scale_rounde(size_t n)
+{
+  for (size_t i = 0; i < n; i += N) {
+    for (size_t j = 0; j < N; ++j) batch_out[j] = rounde(values[j] * 1.0125);
+    keep(batch_out[0]);
   }
+}
+
+money_column scaled;
+
+void column_scale_rounde(size_t n)
+{
+  for (size_t i = 0; i < n; i += N) {
+    scaled = column;
+    scaled.scale<rounding::half_even>(1.0125);
+    keep(scaled.minors()[0]);
+  }
+}
+
+int64_t scaled_minors(size_t i)
+{
+  return int64_t(std::nearbyint(values[i].total_minors() * 1.0125));
+}
+
+bool check_array_scale()
+{
+  array_scale_rounde(CHECK_N);
+  for (size_t i = 0; i < N; ++i) {
+    if (!same(batch_out[i], eur_minors(scaled_minors(i)))) return false;
+  }
+  return true;
+}
+
+bool check_column_scale()
+{
+  column_scale_rounde(CHECK_N);
+  for (size_t i = 0; i < N; ++i) {
+    if (!same(scaled.minors()[i], scaled_minors(i))) return false;
+  }
+  return true;
+}
+
+// splits of a total by 10 weights, timed per share
+
+int64_t const split_weights[10] = { 3, 1, 4, 1, 5, 9, 2, 6, 5, 3 };
+money split_out[10 * N];
+money shares_out[10];
+
+void split_rounde(size_t n)
+{
+  money shares[10];
+  for (size_t i = 0; i < n; i += 10) {
+    money total = values[(i / 10) & MASK];
+    for (size_t j = 0; j < 10; ++j) {
+      shares[j] = rounde(total * (split_weights[j] / 39.0));
+    }
+    keep(shares[0]);
+  }
+  copy(shares, shares + 10, shares_out);
+}
+
+void split_allocate(size_t n)
+{
+  money shares[10];
+  for (size_t i = 0; i < n; i += 10) {
+    allocate(values[(i / 10) & MASK], split_weights, 10, shares);
+    keep(shares[0]);
+  }
+  copy(shares, shares + 10, shares_out);
+}
+
+void split_batch_allocate(size_t n)
+{
+  for (size_t i = 0; i < n; i += 10 * N) {
+    batch_allocate(values, N, split_weights, 10, split_out);
+    keep(split_out[0]);
+  }
+}
+
+bool check_split_rounde()
+{
+  split_rounde(CHECK_N);
+  double total = values[LAST].total_minors();
+  for (size_t j = 0; j < 10; ++j) {
+    double share = std::nearbyint(total * (split_weights[j] / 39.0));
+    if (!same(shares_out[j], eur_minors(share))) return false;
+  }
+  return true;
+}
+
+// shares add up to the total and are less than a minor off their weight
+bool check_split_allocate()
+{
+  split_allocate(CHECK_N);
+  int64_t total = values[LAST].total_minors();
+  int64_t sum = 0;
+  for (size_t j = 0; j < 10; ++j) {
+    int64_t off = shares_out[j].total_minors() * 39 - total * split_weights[j];
+    if (!same(shares_out[j].unit(), eur) || off <= -39 || off >= 39) {
+      cerr << shares_out[j] << " is not " << split_weights[j] << "/39 of "
+           << values[LAST] << endl;
+      return false;
+    }
+    sum += shares_out[j].total_minors();
+  }
+  return same(sum, total);
+}
+
+bool check_split_batch_allocate()
+{
+  split_batch_allocate(CHECK_N);
+  money shares[10];
+  for (size_t i = 0; i < N; ++i) {
+    allocate(values[i], split_weights, 10, shares);
+    for (size_t j = 0; j < 10; ++j) {
+      if (!same(split_out[10 * i + j], shares[j])) return false;
+    }
+  }
+  return true;
+}
+
+// a marginal tax of 10% from EUR 1000 and 20% from EUR 5000, at least
+// EUR 2.50, as a chain of money_calc operations and as a fee_schedule
+
+void fee_calc_chain(size_t n)
+{
+  money fee;
+  for (size_t i = 0; i < n; ++i) {
+    money_calc<double> a(values[i & MASK]);
+    if (a.minors < 0) a = -a;
+    fee = money(0, 0, eur);
+    if (a > fee_t2) fee = rounde((a - fee_t2) * 0.2 + (fee_t2 - fee_t1) * 0.1);
+    else if (a > fee_t1) fee = rounde((a - fee_t1) * 0.1);
+    if (money_calc<double>(fee) < fee_min) fee = fee_min;
+    keep(fee);
+  }
+  money_out = fee;
+}
+
+void fee_schedule_fee(size_t n)
+{
+  money fee;
+  for (size_t i = 0; i < n; ++i) {
+    fee = tax.fee<rounding::half_even>(values[i & MASK]);
+    keep(fee);
+  }
+  money_out = fee;
+}
+
+void fee_schedule_fees(size_t n)
+{
+  for (size_t i = 0; i < n; i += N) {
+    tax.fees<rounding::half_even>(values, N, batch_out);
+    keep(batch_out[0]);
+  }
+}
+
+// the tax on values[i] in integers, in tenths of a cent before rounding
+money plain_tax(size_t i)
+{
+  int64_t minors = values[i].total_minors();
+  int64_t mag = (minors < 0 ? -minors : minors);
+  int64_t fee = 0;
+  if (mag >= 500000) {
+    fee = div_half_even(400000 + (mag - 500000) * 2, 10);
+  } else if (mag >= 100000) {
+    fee = div_half_even(mag - 100000, 10);
+  }
+  return eur_minors(mag == 0 ? 0 : max(fee, int64_t(250)));
+}
+
+bool check_fee_chain()
+{
+  fee_calc_chain(CHECK_N);
+  return same(money_out, plain_tax(LAST));
+}
+
+bool check_fee()
+{
+  fee_schedule_fee(CHECK_N);
+  return same(money_out, plain_tax(LAST));
+}
+
+bool check_fees()
+{
+  fee_schedule_fees(CHECK_N);
+  for (size_t i = 0; i < N; ++i) {
+    if (!same(batch_out[i], plain_tax(i))) return false;
+  }
+  return true;
+}
+
+// count, sum, min and max per currency of amounts in many currencies, as
+// a map rebuilt for every N amounts and as a money_aggregator
+
+struct map_stats
+{
+  int64_t count;
+  money sum;
+  money min;
+  money max;
 };
 
+void group_by_map(size_t n)
+{
+  size_t num_groups = 0;
+  for (size_t i = 0; i < n; i += N) {
+    map<isonum_t, map_stats> groups;
+    for (size_t j = 0; j < N; ++j) {
+      money m = mixed[j];
+      map<isonum_t, map_stats>::iterator it = groups.find(m.unit().isonum());
+      if (it == groups.end()) {
+        map_stats s = { 1, m, m, m };
+        groups.insert(make_pair(m.unit().isonum(), s));
+      } else {
+        ++it->second.count;
+        it->second.sum += m;
+        if (m < it->second.min) it->second.min = m;
+        if (m > it->second.max) it->second.max = m;
+      }
+    }
+    num_groups = groups.size();
+    keep(num_groups);
+  }
+  int_out = num_groups;
+}
 
-int main(int argc, char* argv[])
+bool check_group_by_map()
+{
+  group_by_map(CHECK_N);
+  return same(int_out, int64_t(set<isonum_t>(isonums, isonums + N).size()));
+}
+
+money_aggregator aggregator;
+
+void aggregator_push(size_t n)
+{
+  for (size_t i = 0; i < n; ++i) aggregator.push(mixed[i & MASK]);
+  keep(aggregator.no_currency_count());
+}
+
+void aggregator_push_array(size_t n)
+{
+  for (size_t i = 0; i < n; i += N) aggregator.push(mixed, N);
+  keep(aggregator.no_currency_count());
+}
+
+// statistics of the currency of mixed[0] after k pushes CHECK_N amounts
+bool check_aggregator(kernel k)
+{
+  aggregator.clear();
+  k(CHECK_N);
+  currency unit = units[0];
+  uint64_t count = 0;
+  int64_t sum = 0;
+  money lo = mixed[0], hi = mixed[0];
+  for (size_t i = 0; i < N; ++i) {
+    if (units[i] != unit) continue;
+    count += CHECK_N / N;
+    sum += mixed[i].total_minors() * int64_t(CHECK_N / N);
+    lo = min(lo, mixed[i]);
+    hi = max(hi, mixed[i]);
+  }
+  money_stats got = aggregator.stats(unit);
+  return same(got.count, count) && same(got.sum, money(0, sum, unit))
+         && same(got.min, lo) && same(got.max, hi);
+}
+
+bool check_aggregator_push()
+{
+  return check_aggregator(aggregator_push);
+}
+
+bool check_aggregator_push_array()
+{
+  return check_aggregator(aggregator_push_array);
+}
+
+// stream and text I/O
+
+void stream_write(size_t n)
+{
+  ostringstream os;
+  os.imbue(locale::classic());
+  for (size_t i = 0; i < n; ++i) {
+    os.seekp(0);
+    os << values[i & MASK];
+  }
+  keep(os.tellp());
+  text_out = os.str().substr(0, os.tellp());
+}
+
+bool check_stream_write()
+{
+  stream_write(CHECK_N);
+  return same(text_out, "EUR " + plain_decimal(values[LAST].total_minors()));
+}
+
+void stream_read_currency(size_t n)
+{
+  istringstream is;
+  currency c;
+  for (size_t i = 0; i < n; ++i) {
+    is.clear();
+    is.str(codes[i & MASK]);
+    is >> c;
+    keep(c);
+  }
+  unit_out = c;
+}
+
+bool check_stream_read_currency()
+{
+  stream_read_currency(CHECK_N);
+  return same(unit_out, units[LAST]);
+}
+
+void text_write_decimal(size_t n)
+{
+  char buf[decimal_max_size];
+  char * end = buf;
+  for (size_t i = 0; i < n; ++i) {
+    end = write_decimal(buf, values[i & MASK]);
+    keep(end);
+  }
+  text_out.assign(buf, end);
+}
+
+bool check_write_decimal()
+{
+  text_write_decimal(CHECK_N);
+  return same(text_out, plain_decimal(values[LAST].total_minors()));
+}
+
+void text_read_decimal(size_t n)
+{
+  money m;
+  for (size_t i = 0; i < n; ++i) {
+    char const* s = decimals[i & MASK];
+    keep(read_decimal(s, s + decimal_sizes[i & MASK], eur, m));
+    keep(m);
+  }
+  money_out = m;
+}
+
+bool check_read_decimal()
+{
+  text_read_decimal(CHECK_N);
+  return same(money_out, values[LAST]);
+}
+
+void text_format(size_t n)
+{
+  char buf[128];
+  char * end = buf;
+  for (size_t i = 0; i < n; ++i) {
+    end = formatter->format(buf, values[i & MASK]);
+    keep(end);
+  }
+  text_out.assign(buf, end);
+}
+
+bool check_format()
+{
+  text_format(CHECK_N);
+  return same(text_out, "EUR " + plain_decimal(values[LAST].total_minors()));
+}
+
+void text_parse(size_t n)
 {
-  long megs = 10;
-  if (argc > 1) {
-    megs = atoi(argv[1]);
+  money m;
+  for (size_t i = 0; i < n; ++i) {
+    char const* s = texts[i & MASK];
+    keep(parser->parse(s, s + text_sizes[i & MASK], m));
+    keep(m);
   }
-  long rep = megs*1e6;
+  money_out = m;
+}
+
+bool check_parse()
+{
+  text_parse(CHECK_N);
+  return same(money_out, values[LAST]);
+}
 
-  cout << fixed;
+// money_calc
 
-  CLOCKIT(rep, 0.0, 0.01*rep, increment_double());
+void calc_add(size_t n)
+{
+  money_calc<double> total(0.0, eur);
+  for (size_t i = 0; i < n; ++i) total += values[i & MASK];
+  keep(total.minors);
+  double_out = total.minors;
+}
 
-  CLOCKIT(rep, money(0,"EUR"), money(rep/100,"EUR"), increment_money());
+bool check_calc_add()
+{
+  calc_add(CHECK_N);
+  return same(double_out, double(sum_of_values(CHECK_N)));
+}
 
-  double dr = 0.0005/365.0;
+void calc_mul(size_t n)
+{
+  money_calc<double> x;
+  for (size_t i = 0; i < n; ++i) {
+    x = calcs[i & MASK] * 1.0125;
+    keep(x);
+  }
+  double_out = x.minors;
+}
 
-  CLOCKIT(rep, 10000.0, 5278454643.71, interest_double(dr));
+bool check_calc_mul()
+{
+  calc_mul(CHECK_N);
+  return same(double_out, values[LAST].total_minors() * 1.0125);
+}
 
-  CLOCKIT(rep, money(10000, 0, "EUR"), money(5278454643, 71, "EUR"), interest_money(dr));
+void calc_round(size_t n)
+{
+  money m;
+  for (size_t i = 0; i < n; ++i) {
+    m = isomon::round(calcs[i & MASK] * 0.97);
+    keep(m);
+  }
+  money_out = m;
+}
 
-  CLOCKIT(rep, -10000.0, -5278454643.71, interest_double(dr));
+bool check_calc_round()
+{
+  calc_round(CHECK_N);
+  double want = std::round(values[LAST].total_minors() * 0.97);
+  return same(money_out, eur_minors(want));
+}
 
-  CLOCKIT(rep, money(-10000, 0, "EUR"), money(-5278454643, -71, "EUR"), interest_money(dr));
+void calc_compare(size_t n)
+{
+  bool lt = false;
+  for (size_t i = 0; i < n; ++i) {
+    lt = calcs[i & MASK] < calcs[(i + 1) & MASK];
+    keep(lt);
+  }
+  int_out = lt;
+}
 
-  return 0;
+bool check_calc_compare()
+{
+  calc_compare(CHECK_N);
+  return same(int_out, int64_t(values[LAST] < values[0]));
 }
 
+int main(int argc, char* argv[])
+{
+  bench::runner r(argc, argv);
+  money_formatter f;
+  money_parser p(amount_format('.', ',', amount_format::minus_before,
+                               amount_format::unit_before));
+  formatter = &f;
+  parser = &p;
+  init_inputs();
+
+  r.run("currency(code)", currency_from_code, check_currency_from_code);
+  r.run("code2isonum", lookup_code2isonum, check_code2isonum);
+  r.run("isonum2code", lookup_isonum2code, check_isonum2code);
+
+  r.run("money(major, minor, unit)", money_construct, check_construct);
+  r.run("money += money", money_add, check_add);
+  r.run("money -= money", money_sub, check_sub);
+  r.run("money * int32", money_mul, check_mul);
+  r.run("money.value()", money_value, check_value);
+  r.run("nextafter(money)", money_increment, check_increment);
+  r.run("money += trunc(money * x)", money_interest, check_interest);
+  r.run("accrue<trunc>", accrue_interest, check_accrue);
+
+  r.run("floor(double, unit)", convert_floor, check_floor);
+  r.run("ceil(double, unit)", convert_ceil, check_ceil);
+  r.run("trunc(double, unit)", convert_trunc, check_trunc);
+  r.run("round(double, unit)", convert_round, check_round);
+  r.run("rounde(double, unit)", convert_rounde, check_rounde);
+  r.run("llrounde(double)", round_llrounde, check_llrounde);
+  r.run("convert<half_up>", convert_half_up, check_half_up);
+  r.run("convert<half_toward_zero>", convert_half_toward_zero,
+        check_half_toward_zero);
+  r.run("convert_decimal<half_even>", convert_decimal_half_even,
+        check_convert_decimal);
+  r.run("batch_floor", batch_convert_floor, check_batch_floor);
+  r.run("batch_round", batch_convert_round, check_batch_round);
+  r.run("batch_rounde", batch_convert_rounde, check_batch_rounde);
+  r.run("batch_convert<half_up>", batch_convert_half_up, check_batch_half_up);
+  r.run("batch_convert_decimal", batch_convert_decimal_half_even,
+        check_batch_convert_decimal);
+  r.run("batch_rounde, many units", batch_convert_rounde_units,
+        check_batch_rounde_units);
+
+  r.run("money[] sum", array_sum, check_array_sum);
+  r.run("money_column::sum", column_sum, check_column_sum);
+  r.run("money[] rounde(m * x)", array_scale_rounde, check_array_scale);
+  r.run("money_column::scale", column_scale_rounde, check_column_scale);
+
+  r.run("rounde(m * w / sum), 10 ways", split_rounde, check_split_rounde);
+  r.run("allocate, 10 ways", split_allocate, check_split_allocate);
+  r.run("batch_allocate, 10 ways", split_batch_allocate,
+        check_split_batch_allocate);
+
+  r.run("money_calc fee chain", fee_calc_chain, check_fee_chain);
+  r.run("fee_schedule::fee", fee_schedule_fee, check_fee);
+  r.run("fee_schedule::fees", fee_schedule_fees, check_fees);
+
+  r.run("group by currency, map", group_by_map, check_group_by_map);
+  r.run("money_aggregator::push", aggregator_push, check_aggregator_push);
+  r.run("money_aggregator::push array", aggregator_push_array,
+        check_aggregator_push_array);
+
+  r.run("ostream << money", stream_write, check_stream_write);
+  r.run("istream >> currency", stream_read_currency,
+        check_stream_read_currency);
+  r.run("write_decimal", text_write_decimal, check_write_decimal);
+  r.run("read_decimal", text_read_decimal, check_read_decimal);
+  r.run("money_formatter::format", text_format, check_format);
+  r.run("money_parser::parse", text_parse, check_parse);
+
+  r.run("money_calc += money", calc_add, check_calc_add);
+  r.run("money_calc * double", calc_mul, check_calc_mul);
+  r.run("round(money_calc)", calc_round, check_calc_round);
+  r.run("money_calc < money_calc", calc_compare, check_calc_compare);
+
+  return r.finish();
+}
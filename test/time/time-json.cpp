@@ -0,0 +1,94 @@
+#include "money_json.hpp"
+
+#include <tr1/ctime>
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+using namespace isomon;
+
+double seconds_since(clock_t t0)
+{
+  return double(clock() - t0) / CLOCKS_PER_SEC;
+}
+
+void report(char const* name, size_t count, size_t bytes, double secs)
+{
+  cout << name << " | " << count / secs / 1e6 << " M values/s | "
+       << bytes / secs / (1 << 20) << " MiB/s" << endl;
+}
+
+void time_style(vector<money> const& values, json_style style,
+                char const* write_name, char const* read_name)
+{
+  stringstream ss;
+  clock_t t0 = clock();
+  {
+    json_writer w(ss, style);
+    w.write(&values[0], values.size());
+  }
+  double secs = seconds_since(t0);
+  string text = ss.str();
+  report(write_name, values.size(), text.size(), secs);
+
+  vector<money> got(values.size());
+  t0 = clock();
+  json_reader r(text.data(), text.data() + text.size());
+  size_t n = r.read(&got[0], got.size());
+  secs = seconds_since(t0);
+  report(read_name, n, text.size(), secs);
+  if (n != values.size() || got != values) {
+    cout << "MISMATCH after reading " << n << " values" << endl;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  long megs = 4;
+  if (argc > 1) {
+    megs = atoi(argv[1]);
+  }
+  size_t count = megs * 1000000;
+
+  char const* codes[] = { "USD", "EUR", "JPY", "GBP", "CHF", "KWD" };
+  vector<money> values;
+  values.reserve(count);
+  srand(42);
+  for (size_t i = 0; i < count; ++i) {
+    int64_t minors = (int64_t(rand()) << 8) - (int64_t(RAND_MAX) << 7);
+    values.push_back(money(0, minors >> (rand() % 32), codes[i % 6]));
+  }
+
+  cout << fixed;
+  time_style(values, json_minors, "write minors", "read minors");
+  time_style(values, json_decimal, "write decimal", "read decimal");
+
+  // baseline: operator<< and strtod + round for comparison
+  stringstream ss;
+  clock_t t0 = clock();
+  for (size_t i = 0; i < count; ++i) {
+    ss << values[i] << '\n';
+  }
+  double secs = seconds_since(t0);
+  report("operator<<", count, ss.str().size(), secs);
+
+  string text = ss.str();
+  t0 = clock();
+  char const* p = text.c_str();
+  size_t bad = 0;
+  for (size_t i = 0; i < count; ++i) {
+    char * end;
+    currency unit(string(p, 3));
+    double x = strtod(p + 4, &end);
+    bad += (round(x, unit) != values[i]);
+    p = end + 1;
+  }
+  secs = seconds_since(t0);
+  report("strtod + round", count, text.size(), secs);
+  if (bad) cout << bad << " strtod + round MISMATCHES" << endl;
+
+  return 0;
+}
@@ -0,0 +1,136 @@
+#include "bench.hpp"
+
+#include "money_ledger.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+
+using namespace std;
+using namespace isomon;
+
+// Postings to accounts picked at random, mostly in the four dense
+// currencies, one in a hundred in others, with a limit on every tenth
+// account. With a million accounts the balances are far larger than the
+// caches, so most postings miss. Each way of posting starts from the same
+// ledger and must end with the same balances.
+
+currency const common[] = { "EUR", "USD", "GBP", "JPY" };
+char const* const rare[] = { "CHF", "SEK", "NOK", "DKK" };
+
+vector<money_ledger::posting> postings;
+
+vector<money_ledger::posting> make_postings(size_t n, size_t num_accounts)
+{
+  mt19937_64 gen(12345);
+  vector<money_ledger::posting> v(n);
+  for (size_t i = 0; i < n; ++i) {
+    currency unit = common[gen() % 4];
+    if (gen() % 100 == 0) unit = currency(rare[gen() % 4]);
+    v[i].account = gen() % num_accounts;
+    v[i].amount = money(0, int64_t(gen() % 200001) - 100000, unit);
+  }
+  return v;
+}
+
+// map of balances keyed by account and currency, the usual first ledger
+void post_map(map<pair<size_t, isonum_t>, money> & book)
+{
+  for (size_t i = 0; i < postings.size(); ++i) {
+    money amount = postings[i].amount;
+    pair<size_t, isonum_t> key(postings[i].account, amount.unit().isonum());
+    map<pair<size_t, isonum_t>, money>::iterator it = book.find(key);
+    if (it == book.end()) book.insert(make_pair(key, amount));
+    else it->second += amount;
+  }
+}
+
+void post_in_order(money_ledger & book)
+{
+  for (size_t i = 0; i < postings.size(); ++i) {
+    book.post(postings[i].account, postings[i].amount);
+  }
+}
+
+size_t batch_size;
+
+void post_batches(money_ledger & book)
+{
+  for (size_t i = 0; i < postings.size(); i += batch_size) {
+    book.post(&postings[i], min(batch_size, postings.size() - i));
+  }
+}
+
+bool by_account(money_ledger::posting const& a,
+                money_ledger::posting const& b)
+{
+  return a.account < b.account;
+}
+
+// rows in order of address, at the cost of a sort, which keeps the order
+// of postings to the same account and so their outcome
+void post_sorted_batches(money_ledger & book)
+{
+  vector<money_ledger::posting> batch;
+  for (size_t i = 0; i < postings.size(); i += batch_size) {
+    size_t n = min(batch_size, postings.size() - i);
+    batch.assign(&postings[i], &postings[i] + n);
+    stable_sort(batch.begin(), batch.end(), by_account);
+    book.post(&batch[0], n);
+  }
+}
+
+template <class _Post>
+void row(string const& name, _Post post)
+{
+  double t0 = bench::now_ns();
+  post();
+  double t1 = bench::now_ns();
+  cout << setw(28) << left << name << right
+       << setw(10) << (t1 - t0) / postings.size() << endl;
+}
+
+bool same_balances(money_ledger const& a, money_ledger const& b)
+{
+  for (size_t i = 0; i < a.num_accounts(); ++i) {
+    if (a.balances(i) != b.balances(i)) return false;
+  }
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  // default 10 million postings to 1 million accounts
+  size_t count = (argc > 1 ? atof(argv[1]) : 10) * 1e6;
+  size_t num_accounts = (argc > 2 ? atof(argv[2]) : 1) * 1e6;
+
+  money_ledger start(num_accounts, common, 4);
+  for (size_t a = 0; a < num_accounts; a += 10) {
+    start.set_limit(a, money(-500, 0, common[a / 10 % 4]));
+  }
+  postings = make_postings(count, num_accounts);
+
+  cout << count << " postings to " << num_accounts << " accounts, "
+       << "ns per posting" << endl << fixed << setprecision(2);
+
+  map<pair<size_t, isonum_t>, money> map_book;
+  row("map<account, currency>", [&]() { post_map(map_book); });
+
+  money_ledger in_order(start);
+  row("post, in arrival order", [&]() { post_in_order(in_order); });
+
+  size_t const sizes[] = { 1024, 65536 };
+  for (size_t s = 0; s < 2; ++s) {
+    batch_size = sizes[s];
+    money_ledger batched(start);
+    row("post, batches of " + to_string(sizes[s]),
+        [&]() { post_batches(batched); });
+    if (!same_balances(batched, in_order)) cout << "  WRONG BALANCES" << endl;
+  }
+  money_ledger sorted(start);
+  row("sort, post batches of 65536", [&]() { post_sorted_batches(sorted); });
+  if (!same_balances(sorted, in_order)) cout << "  WRONG BALANCES" << endl;
+  return 0;
+}